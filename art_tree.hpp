@@ -0,0 +1,1156 @@
+#ifndef ART_TREE_H
+#define ART_TREE_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "util.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#define AddressOf (::std::addressof)
+
+namespace container_test {
+
+// Byte strings of keys, they compare as the keys do.
+template <typename K>
+struct ArtKeyTraits;
+
+template <std::integral K>
+struct ArtKeyTraits<K> {
+    // Big endian, signed keys get the sign bit flipped.
+    static auto Bytes(K key) noexcept -> std::array<std::uint8_t, sizeof(K)>
+    {
+        using U = std::make_unsigned_t<K>;
+        auto value = U(key);
+        if constexpr (std::is_signed_v<K>) {
+            value ^= U(U(1) << (sizeof(K) * 8 - 1));
+        }
+        std::array<std::uint8_t, sizeof(K)> bytes;
+        for (auto i = sizeof(K); i-- != 0; value = U(value >> 8)) {
+            bytes[i] = std::uint8_t(value);
+        }
+        return bytes;
+    }
+};
+
+template <>
+struct ArtKeyTraits<std::string_view> {
+    static auto Bytes(std::string_view key) noexcept
+        -> std::span<const std::uint8_t>
+    {
+        return { ptr_cast<const std::uint8_t*>(key.data()), key.size() };
+    }
+};
+
+template <>
+struct ArtKeyTraits<std::string> : ArtKeyTraits<std::string_view> {};
+
+// Adaptive radix tree (ART) ordered map. Keys are split into bytes, an
+// inner node holds up to 4, 16, 48 or 256 children for the next byte and
+// grows or shrinks between these layouts. Bytes shared by all the keys of
+// a subtree are kept once in its node as a prefix, up to MaxPrefix of
+// them are stored and the rest is read from a leaf when needed. A key
+// that ends at a node, being a prefix of the others, is its terminal
+// leaf. Lookups compare bytes, not keys, and take as many steps as keys
+// have distinct bytes, regardless of the number of elements.
+// Leaves are linked in order, so iteration needs no stack and iterators
+// stay valid until their element is erased. Keys are unique.
+template <
+    typename K,
+    typename V,
+    typename KeyTraits = ArtKeyTraits<K>,
+    typename Allocator = std::allocator<V>
+>
+class ArtTree {
+public:
+    struct Element {
+        const K key;
+        V value;
+    };
+private:
+    struct Link {
+        Link* prev;
+        Link* next;
+    };
+
+    struct Leaf : Link, Element {
+        Leaf(K&& key, V&& value) :
+            Link(),
+            Element{ std::move(key), std::move(value) }
+        {}
+    };
+
+    enum class Kind : std::uint8_t {
+        Node4,
+        Node16,
+        Node48,
+        Node256
+    };
+
+    static constexpr std::size_t MaxPrefix = 8;
+
+    // Children are nodes or leaves, leaf pointers are tagged by the lowest
+    // bit.
+    struct Node {
+        Kind kind;
+        std::uint16_t count;
+        std::uint32_t prefixLength;
+        std::uint8_t prefix[MaxPrefix];
+        Leaf* terminal;
+    };
+
+    struct Node4 : Node {
+        static constexpr Kind Type = Kind::Node4;
+        std::uint8_t keys[4];
+        Node* children[4];
+    };
+
+    struct Node16 : Node {
+        static constexpr Kind Type = Kind::Node16;
+        std::uint8_t keys[16];
+        Node* children[16];
+    };
+
+    // index holds a position in children plus one, 0 for absent bytes.
+    struct Node48 : Node {
+        static constexpr Kind Type = Kind::Node48;
+        std::uint8_t index[256];
+        Node* children[48];
+    };
+
+    struct Node256 : Node {
+        static constexpr Kind Type = Kind::Node256;
+        Node* children[256];
+    };
+
+    using Bytes = decltype(KeyTraits::Bytes(std::declval<const K&>()));
+public:
+    template <typename E>
+    class IteratorImpl {
+        friend class ArtTree;
+        template <typename>
+        friend class IteratorImpl;
+        IteratorImpl(Link* link) noexcept :
+            link(link)
+        {}
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = std::remove_const_t<E>;
+        using difference_type = std::ptrdiff_t;
+        using reference = E&;
+        using pointer = E*;
+
+        IteratorImpl() noexcept :
+            link(nullptr)
+        {}
+
+        template <typename U>
+        requires std::same_as<E, const U>
+        IteratorImpl(const IteratorImpl<U>& oth) noexcept :
+            link(oth.link)
+        {}
+
+        auto operator++() noexcept -> IteratorImpl&
+        {
+            link = link->next;
+            return *this;
+        }
+
+        auto operator--() noexcept -> IteratorImpl&
+        {
+            link = link->prev;
+            return *this;
+        }
+
+        auto operator++(int) noexcept -> IteratorImpl
+        {
+            auto it = *this;
+            ++*this;
+            return it;
+        }
+
+        auto operator--(int) noexcept -> IteratorImpl
+        {
+            auto it = *this;
+            --*this;
+            return it;
+        }
+
+        auto operator*() const noexcept -> E&
+        {
+            return *static_cast<Leaf*>(link);
+        }
+
+        auto operator->() const noexcept -> E*
+        {
+            return static_cast<Leaf*>(link);
+        }
+
+        bool operator==(const IteratorImpl& oth) const noexcept
+        {
+            return link == oth.link;
+        }
+    private:
+        Link* link;
+    };
+
+    using Iterator = IteratorImpl<Element>;
+    using ConstIterator = IteratorImpl<const Element>;
+
+    ArtTree() noexcept(noexcept(Allocator())) :
+        ArtTree(Allocator())
+    {}
+
+    explicit ArtTree(const Allocator& allocator) noexcept :
+        root(nullptr),
+        size(0),
+        allocator(allocator)
+    {
+        sentinel.prev = sentinel.next = AddressOf(sentinel);
+    }
+
+    ArtTree(ArtTree&& oth) noexcept :
+        ArtTree(oth.allocator)
+    {
+        TakeOver(oth);
+    }
+
+    auto operator=(ArtTree&& oth) noexcept -> ArtTree&
+    {
+        if (this != AddressOf(oth)) {
+            Clear();
+            TakeOver(oth);
+        }
+        return *this;
+    }
+
+    ~ArtTree()
+    {
+        Clear();
+    }
+
+    // Does nothing if there is an element with the key already, returns
+    // it then.
+    auto Insert(K key, V value) -> std::pair<Iterator, bool>
+    {
+        auto bytes = KeyTraits::Bytes(key);
+        auto length = bytes.size();
+        Node** ref = AddressOf(root);
+        std::size_t depth = 0;
+        auto newLeaf = [&] {
+            auto leaf = New<Leaf>(std::move(key), std::move(value));
+            bytes = KeyTraits::Bytes(leaf->key);
+            ++size;
+            return leaf;
+        };
+        for (;;) {
+            auto node = *ref;
+            if (node == nullptr) {
+                auto leaf = newLeaf();
+                *ref = Tag(leaf);
+                LinkBefore(AddressOf(sentinel), leaf);
+                return { Iterator(leaf), true };
+            }
+            if (IsLeaf(node)) {
+                auto other = AsLeaf(node);
+                auto otherBytes = KeyTraits::Bytes(other->key);
+                auto common = depth;
+                while (
+                    common < length && common < otherBytes.size() &&
+                    bytes[common] == otherBytes[common]
+                ) {
+                    ++common;
+                }
+                if (common == length && common == otherBytes.size()) {
+                    return { Iterator(other), false };
+                }
+                auto leaf = newLeaf();
+                auto inner = NewNode<Node4>();
+                inner->prefixLength = std::uint32_t(common - depth);
+                for (std::size_t i = 0; i != inner->prefixLength && i != MaxPrefix; ++i) {
+                    inner->prefix[i] = bytes[depth + i];
+                }
+                Attach(inner, otherBytes, common, other);
+                Attach(inner, bytes, common, leaf);
+                *ref = inner;
+                if (common == length || (
+                    common != otherBytes.size() &&
+                    bytes[common] < otherBytes[common]
+                )) {
+                    LinkBefore(other, leaf);
+                } else {
+                    LinkBefore(other->next, leaf);
+                }
+                return { Iterator(leaf), true };
+            }
+            auto mismatch = PrefixMismatch(node, bytes, depth);
+            if (mismatch != node->prefixLength) {
+                auto inner = NewNode<Node4>();
+                inner->prefixLength = std::uint32_t(mismatch);
+                for (std::size_t i = 0; i != mismatch && i != MaxPrefix; ++i) {
+                    inner->prefix[i] = bytes[depth + i];
+                }
+                auto nodeByte = PrefixByte(node, depth, mismatch);
+                auto rest = node->prefixLength - mismatch - 1;
+                std::uint8_t prefix[MaxPrefix];
+                for (std::size_t i = 0; i != rest && i != MaxPrefix; ++i) {
+                    prefix[i] = PrefixByte(node, depth, mismatch + 1 + i);
+                }
+                std::copy(prefix, prefix + std::min(rest, MaxPrefix), node->prefix);
+                node->prefixLength = rest;
+                auto first = Min(node);
+                auto last = Max(node);
+                auto leaf = newLeaf();
+                *ref = inner;
+                auto byte = depth + mismatch;
+                if (byte == length) {
+                    inner->terminal = leaf;
+                    AddChild(ref, inner, nodeByte, node);
+                    LinkBefore(first, leaf);
+                    return { Iterator(leaf), true };
+                }
+                AddChild(ref, inner, nodeByte, node);
+                AddChild(ref, inner, bytes[byte], Tag(leaf));
+                LinkBefore(bytes[byte] < nodeByte ? first : last->next, leaf);
+                return { Iterator(leaf), true };
+            }
+            depth += node->prefixLength;
+            if (depth == length) {
+                if (node->terminal != nullptr) {
+                    return { Iterator(node->terminal), false };
+                }
+                auto next = Min(node);
+                auto leaf = newLeaf();
+                node->terminal = leaf;
+                LinkBefore(next, leaf);
+                return { Iterator(leaf), true };
+            }
+            auto slot = FindChild(node, bytes[depth]);
+            if (slot != nullptr) {
+                ref = slot;
+                ++depth;
+                continue;
+            }
+            auto nextChild = NextChild(node, bytes[depth]);
+            Link* next = nextChild != nullptr ? Min(nextChild) : Max(node)->next;
+            auto leaf = newLeaf();
+            AddChild(ref, node, bytes[depth], Tag(leaf));
+            LinkBefore(next, leaf);
+            return { Iterator(leaf), true };
+        }
+    }
+
+    auto Erase(Iterator it) -> Iterator
+    {
+        auto leaf = static_cast<Leaf*>(it.link);
+        auto next = leaf->next;
+        auto bytes = KeyTraits::Bytes(leaf->key);
+        Node** ref = AddressOf(root);
+        std::size_t depth = 0;
+        for (;;) {
+            auto node = *ref;
+            if (IsLeaf(node)) {
+                *ref = nullptr;
+                break;
+            }
+            auto nodeDepth = depth;
+            depth += node->prefixLength;
+            if (depth == bytes.size()) {
+                node->terminal = nullptr;
+                Collapse(ref, nodeDepth);
+                break;
+            }
+            auto slot = FindChild(node, bytes[depth]);
+            if (IsLeaf(*slot)) {
+                RemoveChild(ref, node, bytes[depth]);
+                Collapse(ref, nodeDepth);
+                break;
+            }
+            ref = slot;
+            ++depth;
+        }
+        Unlink(leaf);
+        Delete(leaf);
+        --size;
+        return next;
+    }
+
+    auto Erase(const K& key) -> std::size_t
+    {
+        auto it = Find(key);
+        if (it == End()) {
+            return 0;
+        }
+        Erase(it);
+        return 1;
+    }
+
+    auto Find(const K& key) -> Iterator
+    {
+        auto bytes = KeyTraits::Bytes(key);
+        auto node = root;
+        std::size_t depth = 0;
+        // Prefixes are skipped, the leaf reached is compared in full.
+        while (node != nullptr) {
+            if (IsLeaf(node)) {
+                auto leaf = AsLeaf(node);
+                return Equal(KeyTraits::Bytes(leaf->key), bytes) ?
+                    Iterator(leaf) : End();
+            }
+            depth += node->prefixLength;
+            if (depth >= bytes.size()) {
+                auto leaf = node->terminal;
+                return depth == bytes.size() && leaf != nullptr &&
+                    Equal(KeyTraits::Bytes(leaf->key), bytes) ?
+                    Iterator(leaf) : End();
+            }
+            auto slot = FindChild(node, bytes[depth]);
+            if (slot == nullptr) {
+                break;
+            }
+            node = *slot;
+            ++depth;
+        }
+        return End();
+    }
+
+    auto Find(const K& key) const -> ConstIterator
+    {
+        return Mutable().Find(key);
+    }
+
+    auto LowerBound(const K& key) -> Iterator
+    {
+        return Bound<false>(key);
+    }
+
+    auto LowerBound(const K& key) const -> ConstIterator
+    {
+        return Mutable().LowerBound(key);
+    }
+
+    auto UpperBound(const K& key) -> Iterator
+    {
+        return Bound<true>(key);
+    }
+
+    auto UpperBound(const K& key) const -> ConstIterator
+    {
+        return Mutable().UpperBound(key);
+    }
+
+    auto Begin() noexcept -> Iterator
+    {
+        return sentinel.next;
+    }
+
+    auto Begin() const noexcept -> ConstIterator
+    {
+        return Mutable().Begin();
+    }
+
+    friend auto begin(ArtTree& tree) noexcept -> Iterator
+    {
+        return tree.Begin();
+    }
+
+    friend auto begin(const ArtTree& tree) noexcept -> ConstIterator
+    {
+        return tree.Begin();
+    }
+
+    auto End() noexcept -> Iterator
+    {
+        return AddressOf(sentinel);
+    }
+
+    auto End() const noexcept -> ConstIterator
+    {
+        return Mutable().End();
+    }
+
+    friend auto end(ArtTree& tree) noexcept -> Iterator
+    {
+        return tree.End();
+    }
+
+    friend auto end(const ArtTree& tree) noexcept -> ConstIterator
+    {
+        return tree.End();
+    }
+
+    bool Empty() const noexcept
+    {
+        return size == 0;
+    }
+
+    auto Size() const noexcept -> std::size_t
+    {
+        return size;
+    }
+
+    void Clear() noexcept
+    {
+        if (root != nullptr) {
+            FreeSubtree(root);
+        }
+        for (auto link = sentinel.next; link != AddressOf(sentinel);) {
+            auto leaf = static_cast<Leaf*>(link);
+            link = link->next;
+            Delete(leaf);
+        }
+        root = nullptr;
+        size = 0;
+        sentinel.prev = sentinel.next = AddressOf(sentinel);
+    }
+private:
+    auto Mutable() const noexcept -> ArtTree&
+    {
+        return const_cast<ArtTree&>(*this);
+    }
+
+    void TakeOver(ArtTree& oth) noexcept
+    {
+        root = std::exchange(oth.root, nullptr);
+        size = std::exchange(oth.size, 0);
+        if (oth.sentinel.next != AddressOf(oth.sentinel)) {
+            sentinel = oth.sentinel;
+            sentinel.next->prev = AddressOf(sentinel);
+            sentinel.prev->next = AddressOf(sentinel);
+            oth.sentinel.prev = oth.sentinel.next = AddressOf(oth.sentinel);
+        }
+    }
+
+    static bool IsLeaf(Node* node) noexcept
+    {
+        return ptr_cast(node) & 1;
+    }
+
+    static auto AsLeaf(Node* node) noexcept -> Leaf*
+    {
+        return ptr_cast<Leaf*>(ptr_cast(node) & ~std::uintptr_t(1));
+    }
+
+    static auto Tag(Leaf* leaf) noexcept -> Node*
+    {
+        return ptr_cast<Node*>(ptr_cast(leaf) | 1);
+    }
+
+    template <typename A, typename B>
+    static bool Equal(const A& a, const B& b) noexcept
+    {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end());
+    }
+
+    template <typename A, typename B>
+    static auto Compare(const A& a, const B& b) noexcept
+    {
+        return std::lexicographical_compare_three_way(
+            a.begin(), a.end(), b.begin(), b.end()
+        );
+    }
+
+    static void LinkBefore(Link* next, Leaf* leaf) noexcept
+    {
+        leaf->next = next;
+        leaf->prev = next->prev;
+        next->prev->next = leaf;
+        next->prev = leaf;
+    }
+
+    static void Unlink(Leaf* leaf) noexcept
+    {
+        leaf->prev->next = leaf->next;
+        leaf->next->prev = leaf->prev;
+    }
+
+    // Byte i of the prefix of node, which starts at depth of the key.
+    static auto PrefixByte(
+        Node* node, std::size_t depth, std::size_t i
+    ) -> std::uint8_t {
+        if (i < MaxPrefix) {
+            return node->prefix[i];
+        }
+        return KeyTraits::Bytes(Min(node)->key)[depth + i];
+    }
+
+    // Length of the prefix of node matched by bytes from depth on.
+    static auto PrefixMismatch(
+        Node* node, const Bytes& bytes, std::size_t depth
+    ) -> std::size_t {
+        std::size_t length = node->prefixLength;
+        auto end = std::min(length, bytes.size() - depth);
+        std::size_t i = 0;
+        for (; i != end && i != MaxPrefix; ++i) {
+            if (node->prefix[i] != bytes[depth + i]) {
+                return i;
+            }
+        }
+        if (i != end) {
+            auto leafBytes = KeyTraits::Bytes(Min(node)->key);
+            for (; i != end; ++i) {
+                if (leafBytes[depth + i] != bytes[depth + i]) {
+                    return i;
+                }
+            }
+        }
+        return i;
+    }
+
+    // Puts leaf into a new node whose children are indexed at depth.
+    template <typename B>
+    static void Attach(Node4* node, const B& bytes, std::size_t depth, Leaf* leaf)
+    {
+        if (depth == bytes.size()) {
+            node->terminal = leaf;
+            return;
+        }
+        auto i = node->count++;
+        if (i != 0 && node->keys[0] > bytes[depth]) {
+            node->keys[1] = node->keys[0];
+            node->children[1] = node->children[0];
+            i = 0;
+        }
+        node->keys[i] = bytes[depth];
+        node->children[i] = Tag(leaf);
+    }
+
+    template <bool upper>
+    auto Bound(const K& key) -> Iterator
+    {
+        auto bytes = KeyTraits::Bytes(key);
+        auto node = root;
+        std::size_t depth = 0;
+        if (node == nullptr) {
+            return End();
+        }
+        for (;;) {
+            if (IsLeaf(node)) {
+                auto leaf = AsLeaf(node);
+                auto order = Compare(KeyTraits::Bytes(leaf->key), bytes);
+                return upper ? order > 0 ? leaf : leaf->next :
+                    order >= 0 ? leaf : leaf->next;
+            }
+            auto mismatch = PrefixMismatch(node, bytes, depth);
+            if (mismatch != node->prefixLength) {
+                // The subtree is either entirely greater or entirely less.
+                if (
+                    depth + mismatch == bytes.size() ||
+                    PrefixByte(node, depth, mismatch) > bytes[depth + mismatch]
+                ) {
+                    return Min(node);
+                }
+                return Max(node)->next;
+            }
+            depth += node->prefixLength;
+            if (depth == bytes.size()) {
+                auto leaf = node->terminal;
+                return upper && leaf != nullptr ? leaf->next : Min(node);
+            }
+            auto slot = FindChild(node, bytes[depth]);
+            if (slot == nullptr) {
+                auto next = NextChild(node, bytes[depth]);
+                return next != nullptr ? Min(next) : Max(node)->next;
+            }
+            node = *slot;
+            ++depth;
+        }
+    }
+
+    // Index of byte among the count sorted keys, count if it is absent.
+    static auto Find16(
+        const std::uint8_t* keys, unsigned count, std::uint8_t byte
+    ) noexcept -> unsigned {
+#if defined(__SSE2__) || defined(_M_X64)
+        auto equal = _mm_cmpeq_epi8(
+            _mm_set1_epi8(char(byte)),
+            _mm_loadu_si128(ptr_cast<const __m128i*>(keys))
+        );
+        auto mask = unsigned(_mm_movemask_epi8(equal)) & ((1u << count) - 1);
+        return mask != 0 ? unsigned(std::countr_zero(mask)) : count;
+#else
+        unsigned i = 0;
+        while (i != count && keys[i] != byte) {
+            ++i;
+        }
+        return i;
+#endif
+    }
+
+    // Number of the count sorted keys that are less than byte.
+    static auto Rank16(
+        const std::uint8_t* keys, unsigned count, std::uint8_t byte
+    ) noexcept -> unsigned {
+#if defined(__SSE2__) || defined(_M_X64)
+        // Bytes compare signed, flipping the sign bits makes it unsigned.
+        auto flip = _mm_set1_epi8(char(0x80));
+        auto less = _mm_cmplt_epi8(
+            _mm_xor_si128(_mm_loadu_si128(ptr_cast<const __m128i*>(keys)), flip),
+            _mm_xor_si128(_mm_set1_epi8(char(byte)), flip)
+        );
+        auto mask = unsigned(_mm_movemask_epi8(less)) & ((1u << count) - 1);
+        return unsigned(std::countr_one(mask));
+#else
+        unsigned i = 0;
+        while (i != count && keys[i] < byte) {
+            ++i;
+        }
+        return i;
+#endif
+    }
+
+    // Slot of the child for byte, nullptr if there is none.
+    static auto FindChild(Node* node, std::uint8_t byte) noexcept -> Node**
+    {
+        switch (node->kind) {
+        case Kind::Node4: {
+            auto n = static_cast<Node4*>(node);
+            for (unsigned i = 0; i != n->count; ++i) {
+                if (n->keys[i] == byte) {
+                    return n->children + i;
+                }
+            }
+            return nullptr;
+        }
+        case Kind::Node16: {
+            auto n = static_cast<Node16*>(node);
+            auto i = Find16(n->keys, n->count, byte);
+            return i != n->count ? n->children + i : nullptr;
+        }
+        case Kind::Node48: {
+            auto n = static_cast<Node48*>(node);
+            auto i = n->index[byte];
+            return i != 0 ? n->children + i - 1 : nullptr;
+        }
+        case Kind::Node256: {
+            auto n = static_cast<Node256*>(node);
+            return n->children[byte] != nullptr ? n->children + byte : nullptr;
+        }
+        }
+        return nullptr;
+    }
+
+    // First child for a byte greater than byte, nullptr if there is none.
+    static auto NextChild(Node* node, std::uint8_t byte) noexcept -> Node*
+    {
+        switch (node->kind) {
+        case Kind::Node4: {
+            auto n = static_cast<Node4*>(node);
+            for (unsigned i = 0; i != n->count; ++i) {
+                if (n->keys[i] > byte) {
+                    return n->children[i];
+                }
+            }
+            return nullptr;
+        }
+        case Kind::Node16: {
+            auto n = static_cast<Node16*>(node);
+            auto i = Rank16(n->keys, n->count, byte);
+            i += i != n->count && n->keys[i] == byte;
+            return i != n->count ? n->children[i] : nullptr;
+        }
+        case Kind::Node48: {
+            auto n = static_cast<Node48*>(node);
+            for (unsigned b = byte + 1u; b < 256; ++b) {
+                if (n->index[b] != 0) {
+                    return n->children[n->index[b] - 1];
+                }
+            }
+            return nullptr;
+        }
+        case Kind::Node256: {
+            auto n = static_cast<Node256*>(node);
+            for (unsigned b = byte + 1u; b < 256; ++b) {
+                if (n->children[b] != nullptr) {
+                    return n->children[b];
+                }
+            }
+            return nullptr;
+        }
+        }
+        return nullptr;
+    }
+
+    static auto FirstChild(Node* node) noexcept -> Node*
+    {
+        switch (node->kind) {
+        case Kind::Node4:
+            return node->count != 0 ? static_cast<Node4*>(node)->children[0] : nullptr;
+        case Kind::Node16:
+            return static_cast<Node16*>(node)->children[0];
+        case Kind::Node48: {
+            auto n = static_cast<Node48*>(node);
+            for (unsigned b = 0; b != 256; ++b) {
+                if (n->index[b] != 0) {
+                    return n->children[n->index[b] - 1];
+                }
+            }
+            return nullptr;
+        }
+        case Kind::Node256: {
+            auto n = static_cast<Node256*>(node);
+            for (unsigned b = 0; b != 256; ++b) {
+                if (n->children[b] != nullptr) {
+                    return n->children[b];
+                }
+            }
+            return nullptr;
+        }
+        }
+        return nullptr;
+    }
+
+    static auto LastChild(Node* node) noexcept -> Node*
+    {
+        switch (node->kind) {
+        case Kind::Node4: {
+            auto n = static_cast<Node4*>(node);
+            return n->count != 0 ? n->children[n->count - 1] : nullptr;
+        }
+        case Kind::Node16: {
+            auto n = static_cast<Node16*>(node);
+            return n->children[n->count - 1];
+        }
+        case Kind::Node48: {
+            auto n = static_cast<Node48*>(node);
+            for (unsigned b = 256; b-- != 0;) {
+                if (n->index[b] != 0) {
+                    return n->children[n->index[b] - 1];
+                }
+            }
+            return nullptr;
+        }
+        case Kind::Node256: {
+            auto n = static_cast<Node256*>(node);
+            for (unsigned b = 256; b-- != 0;) {
+                if (n->children[b] != nullptr) {
+                    return n->children[b];
+                }
+            }
+            return nullptr;
+        }
+        }
+        return nullptr;
+    }
+
+    static auto Min(Node* node) noexcept -> Leaf*
+    {
+        while (!IsLeaf(node)) {
+            if (node->terminal != nullptr) {
+                return node->terminal;
+            }
+            node = FirstChild(node);
+        }
+        return AsLeaf(node);
+    }
+
+    static auto Max(Node* node) noexcept -> Leaf*
+    {
+        while (!IsLeaf(node)) {
+            auto child = LastChild(node);
+            if (child == nullptr) {
+                return node->terminal;
+            }
+            node = child;
+        }
+        return AsLeaf(node);
+    }
+
+    // Moves the header and the children of from into a node of another
+    // layout, which replaces it in *ref.
+    template <typename To, typename From>
+    auto Resize(Node** ref, From* from) -> To*
+    {
+        auto to = NewNode<To>();
+        static_cast<Node&>(*to) = static_cast<Node&>(*from);
+        to->kind = To::Type;
+        to->count = 0;
+        ForEachChild(from, [&](std::uint8_t byte, Node* child) {
+            Append(to, byte, child);
+        });
+        *ref = to;
+        Delete(from);
+        return to;
+    }
+
+    // Adds a child for a byte greater than all the present ones.
+    template <typename N>
+    static void Append(N* node, std::uint8_t byte, Node* child) noexcept
+    {
+        auto i = node->count++;
+        if constexpr (N::Type == Kind::Node48) {
+            node->index[byte] = std::uint8_t(i + 1);
+            node->children[i] = child;
+        } else if constexpr (N::Type == Kind::Node256) {
+            node->children[byte] = child;
+        } else {
+            node->keys[i] = byte;
+            node->children[i] = child;
+        }
+    }
+
+    template <typename N>
+    static void InsertSorted(N* node, std::uint8_t byte, Node* child) noexcept
+    {
+        unsigned i = 0;
+        if constexpr (N::Type == Kind::Node16) {
+            i = Rank16(node->keys, node->count, byte);
+        } else {
+            while (i != node->count && node->keys[i] < byte) {
+                ++i;
+            }
+        }
+        std::copy_backward(
+            node->keys + i, node->keys + node->count,
+            node->keys + node->count + 1
+        );
+        std::copy_backward(
+            node->children + i, node->children + node->count,
+            node->children + node->count + 1
+        );
+        node->keys[i] = byte;
+        node->children[i] = child;
+        ++node->count;
+    }
+
+    // Adds child for byte to node, *ref gets the grown node if it is full.
+    void AddChild(Node** ref, Node* node, std::uint8_t byte, Node* child)
+    {
+        switch (node->kind) {
+        case Kind::Node4: {
+            auto n = static_cast<Node4*>(node);
+            if (n->count != 4) {
+                InsertSorted(n, byte, child);
+                return;
+            }
+            InsertSorted(Resize<Node16>(ref, n), byte, child);
+            return;
+        }
+        case Kind::Node16: {
+            auto n = static_cast<Node16*>(node);
+            if (n->count != 16) {
+                InsertSorted(n, byte, child);
+                return;
+            }
+            node = Resize<Node48>(ref, n);
+            [[fallthrough]];
+        }
+        case Kind::Node48: {
+            auto n = static_cast<Node48*>(node);
+            if (n->count == 48) {
+                node = Resize<Node256>(ref, n);
+                static_cast<Node256*>(node)->children[byte] = child;
+                ++node->count;
+                return;
+            }
+            unsigned i = 0;
+            while (n->children[i] != nullptr) {
+                ++i;
+            }
+            n->index[byte] = std::uint8_t(i + 1);
+            n->children[i] = child;
+            ++n->count;
+            return;
+        }
+        case Kind::Node256:
+            static_cast<Node256*>(node)->children[byte] = child;
+            ++node->count;
+            return;
+        }
+    }
+
+    // Removes the child for byte, the node shrinks if it gets sparse
+    // enough, with some slack against growing back at once.
+    void RemoveChild(Node** ref, Node* node, std::uint8_t byte)
+    {
+        auto removeSorted = [](auto n, std::uint8_t byte) {
+            unsigned i = 0;
+            while (n->keys[i] != byte) {
+                ++i;
+            }
+            std::copy(n->keys + i + 1, n->keys + n->count, n->keys + i);
+            std::copy(n->children + i + 1, n->children + n->count, n->children + i);
+            --n->count;
+        };
+        switch (node->kind) {
+        case Kind::Node4:
+            removeSorted(static_cast<Node4*>(node), byte);
+            return;
+        case Kind::Node16: {
+            auto n = static_cast<Node16*>(node);
+            removeSorted(n, byte);
+            if (n->count == 3) {
+                Resize<Node4>(ref, n);
+            }
+            return;
+        }
+        case Kind::Node48: {
+            auto n = static_cast<Node48*>(node);
+            n->children[n->index[byte] - 1] = nullptr;
+            n->index[byte] = 0;
+            if (--n->count == 12) {
+                Resize<Node16>(ref, n);
+            }
+            return;
+        }
+        case Kind::Node256: {
+            auto n = static_cast<Node256*>(node);
+            n->children[byte] = nullptr;
+            if (--n->count == 40) {
+                Resize<Node48>(ref, n);
+            }
+            return;
+        }
+        }
+    }
+
+    // Replaces a node left with a single entry by that entry, a child node
+    // takes over the prefix of the node and the byte leading to it.
+    void Collapse(Node** ref, std::size_t depth)
+    {
+        auto node = *ref;
+        if (node->kind != Kind::Node4 ||
+            node->count + (node->terminal != nullptr) != 1
+        ) {
+            return;
+        }
+        auto n = static_cast<Node4*>(node);
+        if (n->count == 0) {
+            *ref = Tag(n->terminal);
+            Delete(n);
+            return;
+        }
+        auto child = n->children[0];
+        if (!IsLeaf(child)) {
+            std::size_t length = n->prefixLength;
+            std::size_t total = length + 1 + child->prefixLength;
+            std::uint8_t prefix[MaxPrefix];
+            for (std::size_t i = 0; i != total && i != MaxPrefix; ++i) {
+                prefix[i] = i < length ? PrefixByte(n, depth, i) :
+                    i == length ? n->keys[0] :
+                    PrefixByte(child, depth + length + 1, i - length - 1);
+            }
+            std::copy(prefix, prefix + std::min(total, MaxPrefix), child->prefix);
+            child->prefixLength = std::uint32_t(total);
+        }
+        *ref = child;
+        Delete(n);
+    }
+
+    template <typename F>
+    static void ForEachChild(Node* node, F f)
+    {
+        switch (node->kind) {
+        case Kind::Node4: {
+            auto n = static_cast<Node4*>(node);
+            for (unsigned i = 0; i != n->count; ++i) {
+                f(n->keys[i], n->children[i]);
+            }
+            return;
+        }
+        case Kind::Node16: {
+            auto n = static_cast<Node16*>(node);
+            for (unsigned i = 0; i != n->count; ++i) {
+                f(n->keys[i], n->children[i]);
+            }
+            return;
+        }
+        case Kind::Node48: {
+            auto n = static_cast<Node48*>(node);
+            for (unsigned b = 0; b != 256; ++b) {
+                if (n->index[b] != 0) {
+                    f(std::uint8_t(b), n->children[n->index[b] - 1]);
+                }
+            }
+            return;
+        }
+        case Kind::Node256: {
+            auto n = static_cast<Node256*>(node);
+            for (unsigned b = 0; b != 256; ++b) {
+                if (n->children[b] != nullptr) {
+                    f(std::uint8_t(b), n->children[b]);
+                }
+            }
+            return;
+        }
+        }
+    }
+
+    // Frees the inner nodes, leaves are freed through their links.
+    void FreeSubtree(Node* node) noexcept
+    {
+        if (IsLeaf(node)) {
+            return;
+        }
+        ForEachChild(node, [this](std::uint8_t, Node* child) {
+            FreeSubtree(child);
+        });
+        switch (node->kind) {
+        case Kind::Node4:
+            Delete(static_cast<Node4*>(node));
+            return;
+        case Kind::Node16:
+            Delete(static_cast<Node16*>(node));
+            return;
+        case Kind::Node48:
+            Delete(static_cast<Node48*>(node));
+            return;
+        case Kind::Node256:
+            Delete(static_cast<Node256*>(node));
+            return;
+        }
+    }
+
+    template <typename T, typename... Args>
+    auto New(Args&&... args) -> T*
+    {
+        using A = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+        using Tr = std::allocator_traits<A>;
+        A alloc(allocator);
+        auto ptr = Tr::allocate(alloc, 1);
+        Tr::construct(alloc, ptr, std::forward<Args>(args)...);
+        return ptr;
+    }
+
+    template <typename N>
+    auto NewNode() -> N*
+    {
+        auto node = New<N>();
+        node->kind = N::Type;
+        return node;
+    }
+
+    template <typename T>
+    void Delete(T* ptr) noexcept
+    {
+        using A = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+        using Tr = std::allocator_traits<A>;
+        A alloc(allocator);
+        Tr::destroy(alloc, ptr);
+        Tr::deallocate(alloc, ptr, 1);
+    }
+
+    Node* root;
+    Link sentinel;
+    std::size_t size;
+    [[no_unique_address]] Allocator allocator;
+};
+
+}
+
+#undef AddressOf
+
+#endif // ART_TREE_H
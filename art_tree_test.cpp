@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "art_tree.hpp"
+#include "test.hpp"
+
+using container_test::ArtTree;
+using container_test::test::Check;
+
+namespace {
+
+template <typename Tree, typename Expected>
+void CheckEqual(Tree& tree, const Expected& expected)
+{
+    Check(tree.Size() == expected.size() && tree.Empty() == expected.empty());
+    auto entry = expected.begin();
+    for (auto& elem : tree) {
+        Check(entry != expected.end() && elem.key == entry->first && elem.value == entry->second);
+        ++entry;
+    }
+    Check(entry == expected.end());
+    auto it = tree.End();
+    for (auto rentry = expected.rbegin(); rentry != expected.rend(); ++rentry) {
+        --it;
+        Check(it->key == rentry->first);
+    }
+    Check(it == tree.Begin());
+}
+
+template <typename Tree, typename Expected>
+bool Same(Tree& tree, typename Tree::Iterator it, const Expected& expected, typename Expected::const_iterator entry)
+{
+    if (it == tree.End() || entry == expected.end()) {
+        return (it == tree.End()) == (entry == expected.end());
+    }
+    return it->key == entry->first && it->value == entry->second;
+}
+
+template <typename Tree, typename Expected, typename Key>
+void CheckLookups(Tree& tree, const Expected& expected, const Key& key)
+{
+    Check(Same(tree, tree.Find(key), expected, expected.find(key)));
+    Check(Same(tree, tree.LowerBound(key), expected, expected.lower_bound(key)));
+    Check(Same(tree, tree.UpperBound(key), expected, expected.upper_bound(key)));
+}
+
+// Keys around key, just before and after it in the order of bytes.
+template <std::integral K>
+auto Around(K key) -> std::vector<K>
+{
+    return { K(key - 1), K(key + 1) };
+}
+
+auto Around(const std::string& key) -> std::vector<std::string>
+{
+    return { key.substr(0, key.size() - 1), key + '\0', key + "\xff" };
+}
+
+// Keys that differ in a single byte make a node gain children one by one
+// up to 256 and lose them again, passing every layout both ways. Lookups
+// of the keys around each present one go through the layout in use.
+template <typename K>
+void TestFanout(unsigned seed, std::vector<K> keys)
+{
+    using Tree = ArtTree<K, int>;
+    std::mt19937 random(seed);
+    std::shuffle(keys.begin(), keys.end(), random);
+    Tree tree;
+    std::map<K, int> expected;
+    auto probe = [&] {
+        CheckEqual(tree, expected);
+        for (auto& key : keys) {
+            CheckLookups(tree, expected, key);
+            for (auto& around : Around(key)) {
+                CheckLookups(tree, expected, around);
+            }
+        }
+    };
+    for (std::size_t i = 0; i != keys.size(); ++i) {
+        auto [it, inserted] = tree.Insert(keys[i], int(i));
+        Check(inserted && it->key == keys[i]);
+        expected[keys[i]] = int(i);
+        probe();
+    }
+    std::shuffle(keys.begin(), keys.end(), random);
+    for (auto& key : keys) {
+        auto next = expected.upper_bound(key);
+        Check(Same(tree, tree.Erase(tree.Find(key)), expected, next));
+        expected.erase(key);
+        probe();
+    }
+}
+
+// Every value of the byte at position, the others are random.
+template <typename K>
+auto IntegerFanout(unsigned seed, std::size_t position) -> std::vector<K>
+{
+    std::mt19937 random(seed);
+    auto shift = (sizeof(K) - 1 - position) * 8;
+    auto base = K(K(random()) & K(~(K(0xff) << shift)));
+    std::vector<K> keys;
+    for (unsigned byte = 0; byte != 256; ++byte) {
+        keys.push_back(K(base | K(K(byte) << shift)));
+    }
+    return keys;
+}
+
+// Every value of the byte after a head longer than the stored prefix,
+// followed by a tail or by nothing.
+auto StringFanout(const std::string& tail) -> std::vector<std::string>
+{
+    std::vector<std::string> keys;
+    for (unsigned byte = 0; byte != 256; ++byte) {
+        keys.push_back("a head longer than a prefix" + std::string(1, char(byte)) + tail);
+    }
+    return keys;
+}
+
+// Random operations against a map. Keys are drawn from a few clusters
+// that share leading bytes, so prefixes are compressed and split, some
+// of them longer than the stored part. Iterators kept from insertion stay
+// valid until their element is erased.
+template <typename K, typename MakeKey>
+void TestRandom(unsigned seed, int steps, MakeKey makeKey)
+{
+    using Tree = ArtTree<K, int>;
+    std::mt19937 random(seed);
+    Tree tree;
+    std::map<K, int> expected;
+    std::map<K, typename Tree::Iterator> kept;
+    for (int step = 0; step != steps; ++step) {
+        K key = makeKey(random);
+        switch (random() % 6) {
+        case 0: case 1: {
+            auto [it, inserted] = tree.Insert(key, step);
+            auto [entry, expectedInserted] = expected.insert({ key, step });
+            Check(inserted == expectedInserted && Same(tree, it, expected, entry));
+            kept.insert({ key, it });
+            break;
+        }
+        case 2:
+            if (auto it = tree.LowerBound(key); it != tree.End()) {
+                auto entry = expected.lower_bound(key);
+                Check(Same(tree, it, expected, entry));
+                kept.erase(entry->first);
+                Check(Same(tree, tree.Erase(it), expected, expected.erase(entry)));
+            }
+            break;
+        case 3:
+            kept.erase(key);
+            Check(tree.Erase(key) == expected.erase(key));
+            break;
+        default:
+            CheckLookups(tree, expected, key);
+        }
+        if (step % 32 == 0) {
+            CheckEqual(tree, expected);
+            for (auto& [key, it] : kept) {
+                Check(it->key == key && it->value == expected.at(key));
+            }
+        }
+    }
+    CheckEqual(tree, expected);
+    auto moved = std::move(tree);
+    CheckEqual(moved, expected);
+    CheckEqual(tree, std::map<K, int>());
+    moved.Clear();
+    CheckEqual(moved, std::map<K, int>());
+}
+
+template <typename K>
+auto ClusteredKey(std::mt19937& random) -> K
+{
+    static const K clusters[] = {
+        K(0), K(-1), K(0x12345678u), K(0x12345600u), K(0x80000000u), K(0x7f00ff00u)
+    };
+    auto key = clusters[random() % std::size(clusters)];
+    auto bits = random() % (sizeof(K) * 8);
+    return K(key ^ K(random() & ((std::uint64_t(1) << bits) - 1)));
+}
+
+// Strings over a small alphabet with shared long heads, including the
+// empty one and ones that are prefixes of others.
+auto StringKey(std::mt19937& random) -> std::string
+{
+    static const std::string heads[] = {
+        "", "a", "ab", "abcdefghijklmnopqrstuvwxyz/", "abcdefghijklmnopqrstuvwxzz/",
+        "\xff\x80", std::string(3, '\0')
+    };
+    auto key = heads[random() % std::size(heads)];
+    for (auto length = random() % 6; length != 0; --length) {
+        key += "ab\xfe"[random() % 3];
+    }
+    return key;
+}
+
+}
+
+int main(int, char*[])
+{
+    TestFanout(1, IntegerFanout<std::uint32_t>(1, 0));
+    TestFanout(2, IntegerFanout<std::int32_t>(2, 0));
+    TestFanout(3, IntegerFanout<std::uint64_t>(3, 5));
+    TestFanout(4, IntegerFanout<std::int16_t>(4, 1));
+    TestFanout(5, StringFanout(""));
+    TestFanout(6, StringFanout("tail"));
+    TestRandom<std::uint32_t>(1, 20000, ClusteredKey<std::uint32_t>);
+    TestRandom<std::int32_t>(2, 20000, ClusteredKey<std::int32_t>);
+    TestRandom<std::int64_t>(3, 20000, ClusteredKey<std::int64_t>);
+    TestRandom<std::string>(4, 20000, StringKey);
+    return 0;
+}
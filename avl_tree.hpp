@@ -1,79 +1,102 @@
 #ifndef AVL_TREE_H
 #define AVL_TREE_H
 
+#include <algorithm>
 #include <cstddef>
+#include <optional>
+#include <type_traits>
 #include <utility>
 #include <stdexcept>
+#include <vector>
+#include "comparator.hpp"
 #include "node.hpp"
 #include "avl_tree_node.hpp"
+#include "instrumentation.hpp"
 
 #define AddressOf (::std::addressof)
 
 namespace container_test::intrusive {
 
-namespace detail {
-
-template <typename Comp, typename Key>
-concept Comparator = requires (const Key t1, const Key t2, Comp c)
-{
-    { c(t1, t2) } -> std::same_as<bool>;
-};
-
-}
+template <
+    typename T,
+    detail::Comparator<T> Comp,
+    typename Reclaimer,
+    typename CastPolicyGen
+>
+class SeqlockAVLTree;
 
 template <
     typename T,
     detail::Comparator<T> Comp,
-        typename CastPolicyGen = BaseClassCastPolicy<AVLTreeNode<>, T>
+        typename CastPolicyGen = BaseClassCastPolicy<AVLTreeNode<>, T>,
+    typename InstrumentationGen = NullInstrumentation
 >
 class AVLTree : detail::ContainerNodeRequirments<T, CastPolicyGen> {
+    template <typename U, detail::Comparator<U> C, typename R, typename P>
+    friend class SeqlockAVLTree;
 public:
     using CastPolicy = CastPolicyGen;
     using NodeType = typename CastPolicyGen::NodeType;
     using NodeTraits = AVLTreeNodeTraits<NodeType>;
     using TraitsHelper = AVLTreeNodeTraitsHelper<NodeType>;
-    AVLTree()
+    using Less = typename ComparatorTraits<Comp>::Less;
+    using ThreeWay = typename ComparatorTraits<Comp>::ThreeWay;
+    using Instrumentation = InstrumentationGen;
+    static constexpr bool Augmented =
+        avl_tree_detail::AugmentedTraits<NodeTraits, NodeType>;
+    static constexpr bool Sized =
+        avl_tree_detail::SizedTraits<NodeTraits, NodeType>;
+    static constexpr bool Interval =
+        avl_tree_detail::IntervalTraits<NodeTraits, NodeType>;
+    static constexpr bool Gapped =
+        avl_tree_detail::GapTraits<NodeTraits, NodeType>;
+
+    constexpr AVLTree()
     {
-        using Tr = NodeTraits;
-        Tr::SetParent(sentinel, nullptr);
-        Tr::SetChild(sentinel, 0, AddressOf(sentinel));
-        Tr::SetChild(sentinel, 1, AddressOf(sentinel));
+        Clear();
     }
 
-    class Iterator : public detail::BasicIterator<Iterator, T> {
+    template <typename V>
+    class IteratorImpl : public detail::BasicIterator<IteratorImpl<V>, V> {
         friend class AVLTree;
-        Iterator(NodeType* current) noexcept :
+        template <typename>
+        friend class IteratorImpl;
+        constexpr IteratorImpl(NodeType* current) noexcept :
             current(current)
         {}
 
-        auto next(bool right) noexcept -> Iterator&
+        constexpr auto next(bool right) noexcept -> IteratorImpl&
         {
-            using Tr = NodeTraits;
-            auto possibleNext = Tr::GetChild(*current, right);
-            if (Tr::GetParent(*possibleNext) != current) {
-                current = possibleNext;
-                return *this;
-            }
-            current = FindNeighbour(current, right);
+            current = Neighbour(current, right);
             return *this;
         }
     public:
-        auto operator++() noexcept -> Iterator&
+        constexpr IteratorImpl() noexcept :
+            current(nullptr)
+        {}
+
+        template <typename U>
+        requires std::same_as<V, const U>
+        constexpr IteratorImpl(const IteratorImpl<U>& oth) noexcept :
+            current(oth.current)
+        {}
+
+        constexpr auto operator++() noexcept -> IteratorImpl&
         {
             return next(true);
         }
 
-        auto operator--() noexcept -> Iterator&
+        constexpr auto operator--() noexcept -> IteratorImpl&
         {
             return next(false);
         }
 
-        T* operator->() const noexcept
+        constexpr V* operator->() const noexcept
         {
             return CastPolicy::FromNode(current);
         }
 
-        bool operator==(const Iterator& oth) const noexcept
+        constexpr bool operator==(const IteratorImpl& oth) const noexcept
         {
             return current == oth.current;
         }
@@ -81,33 +104,74 @@ public:
         NodeType* current;
     };
 
-    AVLTree(AVLTree&& oth) :
-        sentinel(oth.sentinel)
+    using Iterator = IteratorImpl<T>;
+    using ConstIterator = IteratorImpl<const T>;
+
+    constexpr AVLTree(AVLTree&& oth) :
+        AVLTree()
     {
-        using Tr = NodeTraits;
-        auto first = oth.begin().current;
-        Tr::SetChild(*first, 0, AddressOf(sentinel));
-        auto last = (--oth.end()).current;
-        Tr::SetChild(*last, 1, AddressOf(sentinel));
-        auto root = Tr::GetChild(sentinel, 0);
-        Tr::SetParent(*root, AddressOf(sentinel));
+        TakeOver(oth);
     }
 
-    Iterator Insert(T& elem)
+    constexpr Iterator Insert(T& elem)
     {
         return InsertUnrestricted(UpperBound(elem), elem);
     }
 
-    Iterator Insert(Iterator hint, T& elem)
+    // Inserts before hint if the order allows, elsewhere otherwise.
+    constexpr Iterator Insert(Iterator hint, T& elem)
     {
-        Comp comp;
-        if (!comp(elem, *hint) || comp(elem, *--hint)) {
+        Less comp;
+        if (hint != End() && !comp(elem, *hint)) {
+            return Insert(elem);
+        }
+        if (auto prev = hint; hint != Begin() && comp(elem, *--prev)) {
             return Insert(elem);
         }
         return InsertUnrestricted(hint, elem);
     }
 
-    Iterator Erase(Iterator it)
+    // Inserts elements of [first, last) sorting them first. A batch that
+    // goes entirely before or after the tree is built into a balanced
+    // subtree and joined in O(k + log n), the rest is inserted in order
+    // searching from the previous insertion point, which takes amortized
+    // O(1) comparisons per element for batches of close keys.
+    template <typename InputIt>
+    void InsertRange(InputIt first, InputIt last)
+    {
+        Less comp;
+        auto less = [&comp](const T* a, const T* b) { return comp(*a, *b); };
+        std::vector<T*> batch;
+        for (; first != last; ++first) {
+            batch.push_back(AddressOf(*first));
+        }
+        if (batch.empty()) {
+            return;
+        }
+        if (!std::is_sorted(batch.begin(), batch.end(), less)) {
+            std::stable_sort(batch.begin(), batch.end(), less);
+        }
+        if (Empty() || !comp(*batch.front(), *--End())) {
+            AVLTree tail;
+            tail.AdoptSorted(batch);
+            Join(tail);
+            return;
+        }
+        if (comp(*batch.back(), *Begin())) {
+            AVLTree head;
+            head.AdoptSorted(batch);
+            head.Join(*this);
+            TakeOver(head);
+            return;
+        }
+        NodeType* prev = nullptr;
+        for (auto elem : batch) {
+            auto pos = prev ? UpperBoundFrom(prev, *elem) : UpperBound(*elem);
+            prev = InsertUnrestricted(pos, *elem).current;
+        }
+    }
+
+    constexpr Iterator Erase(Iterator it)
     {
         using Tr = AVLTreeNodeTraits<NodeType>;
         using H = TraitsHelper;
@@ -125,12 +189,13 @@ public:
                 erasedNode.Parent().Children(c) = erasedNode.Children(c);
             } else {
                 children[b].Parent() = erasedNode.Parent();
-                children[b].Parent().Children(a) = children[b];
+                children[b].Parent().Children(!c) = children[b];
                 children[b].Children(a) = children[a];
             }
             if (!a && erasedNode.Children(0) == AddressOf(sentinel)) {
                 Tr::SetChild(sentinel, 1, erasedNode.Children(1));
             }
+            UpdatePath(erasedNode.Parent(), AddressOf(sentinel));
             RebalanceTreeE(erasedNode.Parent(), c);
             return it;
         }
@@ -142,7 +207,8 @@ public:
         auto lowerNode = H(neighbours[c]);
         auto parent = H(lowerNode.Parent());
         H(neighbours[!c]).Children(c) = lowerNode;
-        if (lowerNode.Children(c) != parent) {
+        bool direct = parent == erasedNode;
+        if (!direct && lowerNode.Children(c).Parent() == lowerNode) {
             lowerNode.Children(c).Parent() = parent;
             parent.Children(!c) = lowerNode.Children(c);
         }
@@ -162,45 +228,237 @@ public:
 
         lowerNode.Balance() = erasedNode.Balance();
 
-        RebalanceTreeE(parent, c);
+        UpdatePath(direct ? +lowerNode : +parent, AddressOf(sentinel));
+        if (direct) {
+            RebalanceTreeE(lowerNode, !c);
+        } else {
+            RebalanceTreeE(parent, c);
+        }
         return it;
     }
 
-    Iterator Erase(Iterator b, Iterator e)
+    constexpr Iterator Erase(Iterator b, Iterator e)
     {
-        EraseInternal(b, e);
+        if (b == e) {
+            return e;
+        }
+        if (auto next = b; ++next == e) {
+            return Erase(b);
+        }
+        AVLTree erased, tail;
+        Split(e, tail);
+        Split(b, erased);
+        Join(tail);
         return e;
     }
 
-    std::size_t Erase(T& elem)
+    constexpr std::size_t Erase(T& elem)
     {
         Erase(IteratorTo(elem));
         return 1;
     }
 
     template <typename KeyType>
-    std::size_t Erase(const KeyType& elem)
+    constexpr std::size_t Erase(const KeyType& elem)
     {
         return EraseInternal(LowerBound(elem), UpperBound(elem));
     }
 
-    Iterator Begin()
+    // Appends pivot and then all elements of right to this tree in
+    // O(log n). Every element of this tree must not be greater than pivot
+    // and pivot must not be greater than any element of right. right is
+    // left empty.
+    constexpr void Join(T& pivot, AVLTree& right)
+    {
+        using Tr = NodeTraits;
+        using H = TraitsHelper;
+        using cp = CastPolicy;
+        auto node = H(cp::ToNode(AddressOf(pivot)));
+        auto l = RootSubtree();
+        auto r = right.RootSubtree();
+        NodeType* first = node;
+        NodeType* last = node;
+        if (!Empty()) {
+            first = Begin().current;
+            Tr::SetChild(*(--End()).current, 1, node);
+        }
+        if (!right.Empty()) {
+            last = (--right.End()).current;
+            Tr::SetChild(*right.Begin().current, 0, node);
+        }
+        right.Clear();
+        auto joined = JoinSubtrees(
+            AddressOf(sentinel), l, node, r,
+            AddressOf(sentinel), AddressOf(sentinel)
+        );
+        Adopt(joined.root, first, last);
+    }
+
+    // Concatenates right to the end of this tree in O(log n). No element
+    // of right may be less than any element of this tree.
+    constexpr void Join(AVLTree& right)
+    {
+        if (right.Empty()) {
+            return;
+        }
+        if (Empty()) {
+            TakeOver(right);
+            return;
+        }
+        auto it = right.Begin();
+        auto& pivot = *it;
+        right.Erase(it);
+        Join(pivot, right);
+    }
+
+    // Moves [at, End()) to tail in O(log n), elements previously linked
+    // into tail are dropped from it.
+    constexpr void Split(Iterator at, AVLTree& tail)
+    {
+        tail.Clear();
+        auto node = at.current;
+        if (node == AddressOf(sentinel)) {
+            return;
+        }
+        NodeType* first = Begin().current;
+        NodeType* last = (--End()).current;
+        NodeType* prev = (node == first) ? nullptr : (--at).current;
+        auto [head, rest] = SplitSubtree(
+            AddressOf(sentinel), node, AddressOf(tail.sentinel),
+            AddressOf(sentinel), AddressOf(tail.sentinel)
+        );
+        Adopt(head.root, first, prev);
+        tail.Adopt(rest.root, node, last);
+    }
+
+    template <typename KeyType>
+    constexpr void Split(const KeyType& key, AVLTree& tail)
+    {
+        Split(LowerBound(key), tail);
+    }
+
+    // Join based set operations, O(m log(n / m + 1)) for trees of m <= n
+    // elements with unique keys. The result is left in this tree, oth is
+    // left empty, elements that do not make it to the result are unlinked.
+    // Independent halves are passed to executor.Invoke(f, g) which may run
+    // them in parallel, see ThreadPool.
+    void Union(AVLTree& oth)
+    {
+        SequentialExecutor executor;
+        Union(oth, executor);
+    }
+
+    template <typename Executor>
+    void Union(AVLTree& oth, Executor& executor)
+    {
+        Combine(oth, executor, SetOperation::Union);
+    }
+
+    void Intersection(AVLTree& oth)
+    {
+        SequentialExecutor executor;
+        Intersection(oth, executor);
+    }
+
+    template <typename Executor>
+    void Intersection(AVLTree& oth, Executor& executor)
+    {
+        Combine(oth, executor, SetOperation::Intersection);
+    }
+
+    void Difference(AVLTree& oth)
+    {
+        SequentialExecutor executor;
+        Difference(oth, executor);
+    }
+
+    template <typename Executor>
+    void Difference(AVLTree& oth, Executor& executor)
+    {
+        Combine(oth, executor, SetOperation::Difference);
+    }
+
+    // Calls f for every element in unspecified order. Subtrees near the
+    // root are passed to executor.Invoke(f, g) as independent tasks, so
+    // f has to be safe to call concurrently and must not modify the tree.
+    template <typename F>
+    void ParallelForEach(F&& f)
+    {
+        SequentialExecutor executor;
+        ParallelForEach(f, executor);
+    }
+
+    template <typename F, typename Executor>
+    void ParallelForEach(F&& f, Executor& executor)
+    {
+        if (!Empty()) {
+            auto root = NodeTraits::GetChild(sentinel, 0);
+            ForEachIn(root, Height(root), f, executor);
+        }
+    }
+
+    // Returns op(init, transform(e1), ..., transform(en)) over elements in
+    // order grouped in an unspecified way, op has to be associative. Tasks
+    // are run like in ParallelForEach.
+    template <typename V, typename Op, typename Transform>
+    auto ParallelReduce(V init, Op&& op, Transform&& transform) -> V
+    {
+        SequentialExecutor executor;
+        return ParallelReduce(std::move(init), op, transform, executor);
+    }
+
+    template <typename V, typename Op, typename Transform, typename Executor>
+    auto ParallelReduce(
+        V init, Op&& op, Transform&& transform, Executor& executor
+    ) -> V
+    {
+        if (Empty()) {
+            return init;
+        }
+        auto root = NodeTraits::GetChild(sentinel, 0);
+        return op(
+            std::move(init),
+            ReduceIn<V>(root, Height(root), op, transform, executor)
+        );
+    }
+
+    constexpr Iterator Begin()
     {
         using Tr = AVLTreeNodeTraits<NodeType>;
         return Tr::GetChild(sentinel, 1);
     }
 
-    friend Iterator begin(AVLTree& tree)
+    constexpr ConstIterator Begin() const
+    {
+        return Mutable().Begin();
+    }
+
+    friend constexpr Iterator begin(AVLTree& tree)
     {
         return tree.Begin();
     }
 
-    Iterator End()
+    friend constexpr ConstIterator begin(const AVLTree& tree)
+    {
+        return tree.Begin();
+    }
+
+    constexpr Iterator End()
     {
         return AddressOf(sentinel);
     }
 
-    friend Iterator end(AVLTree& tree)
+    constexpr ConstIterator End() const
+    {
+        return Mutable().End();
+    }
+
+    friend constexpr Iterator end(AVLTree& tree)
+    {
+        return tree.End();
+    }
+
+    friend constexpr ConstIterator end(const AVLTree& tree)
     {
         return tree.End();
     }
@@ -210,22 +468,51 @@ public:
         bool increased;
     };
 
-    auto IteratorTo(T& elem) -> Iterator
+    constexpr auto IteratorTo(T& elem) -> Iterator
     {
         using cp = CastPolicy;
         return cp::ToNode(AddressOf(elem));
     }
 
-    auto Find(const T& key) -> Iterator {
+    // Recomputes the augmentation above it after the members it depends
+    // on have changed in place. The element has to keep its position.
+    constexpr void Refresh(Iterator it)
+    requires Augmented
+    {
+        UpdatePath(it.current, AddressOf(sentinel));
+    }
+
+    constexpr auto Find(const T& key) -> Iterator {
         return Find<T>(key);
     }
 
+    constexpr auto Find(const T& key) const -> ConstIterator {
+        return Find<T>(key);
+    }
+
+    // Lookups of a const tree, e.g. of one built at compile time.
     template <typename KeyType = T>
-    requires(requires (const T& t, const KeyType& k, Comp comp) {
-        comp(k, t);
-        comp(t, k);
-    })
-    auto Find(const KeyType& key) -> Iterator
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    constexpr auto Find(const KeyType& key) const -> ConstIterator
+    {
+        return Mutable().Find(key);
+    }
+
+    template <typename KeyType>
+    constexpr auto UpperBound(const KeyType& key) const -> ConstIterator
+    {
+        return Mutable().UpperBound(key);
+    }
+
+    template <typename KeyType>
+    constexpr auto LowerBound(const KeyType& key) const -> ConstIterator
+    {
+        return Mutable().LowerBound(key);
+    }
+
+    template <typename KeyType = T>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    constexpr auto Find(const KeyType& key) -> Iterator
     {
         using Tr = AVLTreeNodeTraits<NodeType>;
         using H = TraitsHelper;
@@ -235,12 +522,17 @@ public:
             return AddressOf(sentinel);
         }
         NodeType* range[2] = { AddressOf(sentinel), AddressOf(sentinel) };
-        while (true) {
-            Comp comp;
-            bool a = comp(key, *cp::FromNode(subtree));
-            bool b = comp(*cp::FromNode(subtree), key);
-            if (a == b) return { subtree };
+        for (std::size_t depth = 1;; ++depth) {
+            ThreeWay comp;
+            auto order = comp(key, *cp::FromNode(subtree));
+            if (order == 0) {
+                instrumentation.OnSearch(depth);
+                return { subtree };
+            }
+            bool b = order > 0;
+            bool a = !b;
             if (subtree.Children(b) == range[b]) {
+                instrumentation.OnSearch(depth);
                 return AddressOf(sentinel);
             }
             range[a] = subtree;
@@ -250,7 +542,7 @@ public:
     }
 
     template <typename KeyType>
-    auto UpperBound(const KeyType& key) -> Iterator
+    constexpr auto UpperBound(const KeyType& key) -> Iterator
     {
         using Tr = AVLTreeNodeTraits<NodeType>;
         using H = TraitsHelper;
@@ -260,10 +552,11 @@ public:
             return AddressOf(sentinel);
         }
         NodeType* range[2] = { AddressOf(sentinel), AddressOf(sentinel) };
-        while (true) {
-            Comp comp;
+        for (std::size_t depth = 1;; ++depth) {
+            Less comp;
             bool a = comp(key, *cp::FromNode(subtree));
             if (subtree.Children(!a) == range[!a]) {
+                instrumentation.OnSearch(depth);
                 return a ? subtree : subtree.Children(1);
             }
             range[a] = subtree;
@@ -273,7 +566,7 @@ public:
     }
 
     template <typename KeyType>
-    auto LowerBound(const KeyType& key) -> Iterator
+    constexpr auto LowerBound(const KeyType& key) -> Iterator
     {
         using Tr = AVLTreeNodeTraits<NodeType>;
         using H = TraitsHelper;
@@ -283,10 +576,11 @@ public:
             return AddressOf(sentinel);
         }
         NodeType* range[2] = { AddressOf(sentinel), AddressOf(sentinel) };
-        while (true) {
-            Comp comp;
+        for (std::size_t depth = 1;; ++depth) {
+            Less comp;
             bool a = comp(*cp::FromNode(subtree), key);
             if (subtree.Children(a) == range[a]) {
+                instrumentation.OnSearch(depth);
                 return a ? subtree.Children(1) : subtree;
             }
             range[!a] = subtree;
@@ -295,12 +589,821 @@ public:
         return AddressOf(sentinel);
     }
 
-    bool Empty()
+    // Batched lookups, out[i] is set to the result for keys[i]. Searches
+    // of a group advance one level at a time and prefetch the next node of
+    // each, so cache misses of different searches overlap.
+    template <typename KeyType>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    void FindBatch(const KeyType* keys, std::size_t count, Iterator* out)
+    {
+        SearchBatch(keys, count, out, [](
+            const KeyType& key, NodeType*& nodeRef, NodeType** range,
+            NodeType*& result
+        ) {
+            using H = TraitsHelper;
+            using cp = CastPolicy;
+            auto node = H(nodeRef);
+            ThreeWay comp;
+            auto order = comp(key, *cp::FromNode(node));
+            if (order == 0) {
+                result = node;
+                return true;
+            }
+            bool b = order > 0;
+            if (node.Children(b) == range[b]) {
+                return true;
+            }
+            range[!b] = node;
+            nodeRef = node.Children(b);
+            return false;
+        });
+    }
+
+    template <typename KeyType>
+    void LowerBoundBatch(const KeyType* keys, std::size_t count, Iterator* out)
+    {
+        SearchBatch(keys, count, out, [](
+            const KeyType& key, NodeType*& nodeRef, NodeType** range,
+            NodeType*& result
+        ) {
+            using H = TraitsHelper;
+            using cp = CastPolicy;
+            auto node = H(nodeRef);
+            Less comp;
+            bool a = comp(*cp::FromNode(node), key);
+            if (node.Children(a) == range[a]) {
+                result = a ? +node.Children(1) : +node;
+                return true;
+            }
+            range[!a] = node;
+            nodeRef = node.Children(a);
+            return false;
+        });
+    }
+
+    constexpr bool Empty() const
     {
         return Begin() == End();
     }
+
+    // Order statistics, available for nodes with sized traits, see
+    // AVLTreeSizedNode. All of them are O(log n) except O(1) Size.
+    constexpr auto Size() const -> std::size_t
+    requires Sized
+    {
+        return Empty() ? 0 : SubtreeSize(AddressOf(Mutable().sentinel), 0);
+    }
+
+    // Position of it in the tree, Size() for End().
+    constexpr auto IndexOf(Iterator it) -> std::size_t
+    requires Sized
+    {
+        using H = TraitsHelper;
+        if (it == End()) {
+            return Size();
+        }
+        auto node = H(it.current);
+        std::size_t index = SubtreeSize(node, 0);
+        while (node.Parent() != AddressOf(sentinel)) {
+            auto parent = H(node.Parent());
+            if (parent.Children(1) == node) {
+                index += SubtreeSize(parent, 0) + 1;
+            }
+            node = +parent;
+        }
+        return index;
+    }
+
+    // Number of elements less than key.
+    template <typename KeyType>
+    constexpr auto Rank(const KeyType& key) -> std::size_t
+    requires Sized
+    {
+        return IndexOf(LowerBound(key));
+    }
+
+    // Element at position index, End() if index is out of range.
+    constexpr auto Select(std::size_t index) -> Iterator
+    requires Sized
+    {
+        using H = TraitsHelper;
+        if (index >= Size()) {
+            return End();
+        }
+        auto node = H(NodeTraits::GetChild(sentinel, 0));
+        while (true) {
+            auto left = SubtreeSize(node, 0);
+            if (index == left) {
+                return { node };
+            }
+            bool right = index > left;
+            if (right) {
+                index -= left + 1;
+            }
+            node = node.Children(right);
+        }
+    }
+
+    // Number of elements in [lo, hi).
+    template <typename KeyType>
+    constexpr auto CountRange(const KeyType& lo, const KeyType& hi) -> std::size_t
+    requires Sized
+    {
+        auto b = Rank(lo);
+        auto e = Rank(hi);
+        return e > b ? e - b : 0;
+    }
+
+    // Interval queries, available for nodes with interval traits, see
+    // AVLTreeIntervalNode. Intervals are half open.
+
+    // First element by begin that overlaps [lo, hi), End() if there is
+    // none. O(log n).
+    template <typename KeyType>
+    constexpr auto FindOverlapping(const KeyType& lo, const KeyType& hi) -> Iterator
+    requires Interval
+    {
+        using Tr = NodeTraits;
+        if (Empty()) {
+            return End();
+        }
+        auto node = Tr::GetChild(sentinel, 0);
+        while (true) {
+            auto left = RealChild(node, 0);
+            if (left && lo < Tr::GetMaxEnd(*left)) {
+                node = left;
+                continue;
+            }
+            if (!(Tr::GetBegin(*node) < hi)) {
+                return End();
+            }
+            if (lo < Tr::GetEnd(*node)) {
+                return { node };
+            }
+            auto right = RealChild(node, 1);
+            if (!right || !(lo < Tr::GetMaxEnd(*right))) {
+                return End();
+            }
+            node = right;
+        }
+    }
+
+    // First element followed by a gap of at least length before the next
+    // one, the last element if there is no such gap, End() for an empty
+    // tree. Available for nodes with gap traits, see AVLTreeGapNode.
+    // O(log n).
+    template <typename KeyType>
+    constexpr auto FirstGap(const KeyType& length) -> Iterator
+    requires Gapped
+    {
+        using Tr = NodeTraits;
+        if (Empty()) {
+            return End();
+        }
+        auto node = Tr::GetChild(sentinel, 0);
+        while (true) {
+            auto left = RealChild(node, 0);
+            if (left && !(Tr::GetMaxGap(*left) < length)) {
+                node = left;
+                continue;
+            }
+            if (left && !(Tr::GetBegin(*node) - Tr::GetMaxEnd(*left) < length)) {
+                while (auto right = RealChild(left, 1)) {
+                    left = right;
+                }
+                return { left };
+            }
+            auto right = RealChild(node, 1);
+            if (!right || !(Tr::GetMinBegin(*right) - Tr::GetEnd(*node) < length)) {
+                return { node };
+            }
+            node = right;
+        }
+    }
+
+    // Calls f for each element overlapping [lo, hi) in order, subtrees
+    // without a match are skipped. f must not modify the tree.
+    template <typename KeyType, typename F>
+    constexpr void ForEachOverlapping(const KeyType& lo, const KeyType& hi, F&& f)
+    requires Interval
+    {
+        if (!Empty()) {
+            VisitOverlapping(NodeTraits::GetChild(sentinel, 0), lo, hi, false, f);
+        }
+    }
+
+    // Stabbing query, calls f for each element containing point in order.
+    template <typename KeyType, typename F>
+    constexpr void ForEachContaining(const KeyType& point, F&& f)
+    requires Interval
+    {
+        if (!Empty()) {
+            VisitOverlapping(NodeTraits::GetChild(sentinel, 0), point, point, true, f);
+        }
+    }
+
+    constexpr void Clear()
+    {
+        using Tr = NodeTraits;
+        Tr::SetParent(sentinel, nullptr);
+        Tr::SetBalance(sentinel, 0);
+        Tr::SetChild(sentinel, 0, AddressOf(sentinel));
+        Tr::SetChild(sentinel, 1, AddressOf(sentinel));
+    }
+
+    // Lookups through Find, LowerBound and UpperBound, including the ones
+    // done by Insert, are reported with their depth, modifications with
+    // their rotations and rebalance paths.
+    constexpr auto GetInstrumentation() noexcept -> Instrumentation&
+    {
+        return instrumentation;
+    }
 private:
-    Iterator InsertUnrestricted(Iterator hint, T& elem)
+    // Detached subtree used by join and split, root is nullptr for an
+    // empty one.
+    struct Subtree {
+        NodeType* root = nullptr;
+        int height = 0;
+    };
+
+    // The const lookups reuse the non-const ones, which do not modify the
+    // tree.
+    constexpr auto Mutable() const -> AVLTree&
+    {
+        return const_cast<AVLTree&>(*this);
+    }
+
+    static constexpr int Abs(int value)
+    {
+        return value < 0 ? -value : value;
+    }
+
+    static constexpr int Height(NodeType* rootArg)
+    {
+        using H = TraitsHelper;
+        auto node = H(rootArg);
+        int height = 1;
+        while (true) {
+            auto child = node.Children(node.Balance() < 0);
+            if (child.Parent() != node) {
+                return height;
+            }
+            node = +child;
+            ++height;
+        }
+    }
+
+    static constexpr auto ChildSubtree(NodeType* nodeArg, bool right) -> Subtree
+    {
+        using H = TraitsHelper;
+        auto node = H(nodeArg);
+        auto child = node.Children(right);
+        if (child.Parent() != node) {
+            return {};
+        }
+        return { child, Height(child) };
+    }
+
+    constexpr auto RootSubtree() -> Subtree
+    {
+        if (Empty()) {
+            return {};
+        }
+        return ChildSubtree(AddressOf(sentinel), 0);
+    }
+
+    // Links l, pivot and r into a single subtree hung from head in
+    // O(|l.height - r.height| + 1). Threads of pivot towards an empty side
+    // are set to lthread and rthread, threads of the extreme nodes of l and
+    // r are expected to already point to pivot.
+    constexpr auto JoinSubtrees(
+        NodeType* head, Subtree l, NodeType* pivot, Subtree r,
+        NodeType* lthread, NodeType* rthread
+    ) -> Subtree
+    {
+        using H = TraitsHelper;
+        auto node = H(pivot);
+        int diff = l.height - r.height;
+        if (Abs(diff) <= 1) {
+            node.Children(0) = l.root ? l.root : lthread;
+            node.Children(1) = r.root ? r.root : rthread;
+            if (l.root) {
+                H(l.root).Parent() = node;
+            }
+            if (r.root) {
+                H(r.root).Parent() = node;
+            }
+            node.Balance() = diff;
+            node.Parent() = head;
+            UpdateNode(node);
+            H(head).Children(0) = node;
+            return { node, std::max(l.height, r.height) + 1 };
+        }
+        bool right = diff > 0;
+        auto tall = right ? l : r;
+        auto low = right ? r : l;
+        auto parent = H(head);
+        parent.Children(0) = tall.root;
+        H(tall.root).Parent() = parent;
+        auto current = H(tall.root);
+        int height = tall.height;
+        while (height > low.height + 1) {
+            int balance = current.Balance();
+            int childHeight = height - 1;
+            if ((balance > 0) == right && balance != 0) {
+                childHeight -= Abs(balance);
+            }
+            parent = +current;
+            current = childHeight != 0 ? +current.Children(right) : nullptr;
+            height = childHeight;
+        }
+        if (+current != nullptr) {
+            current.Parent() = node;
+            node.Children(!right) = current;
+        } else {
+            node.Children(!right) = parent;
+        }
+        if (low.root) {
+            H(low.root).Parent() = node;
+            node.Children(right) = low.root;
+        } else {
+            node.Children(right) = right ? rthread : lthread;
+        }
+        node.Balance() = right ? height - low.height : low.height - height;
+        node.Parent() = parent;
+        parent.Children(right) = node;
+        UpdatePath(node, head);
+        bool grown = RebalanceTreeI(head, parent, right);
+        return { H(head).Children(0), tall.height + grown };
+    }
+
+    // Splits the subtree hung from top into the nodes before at and the
+    // rest. The first piece reuses top as its head, the second one is
+    // hung from restTop. The greatest node of the first piece and at keep
+    // their outer threads and are to be fixed by the caller, headBound and
+    // restBound are used for the other threads leading out of the pieces.
+    constexpr auto SplitSubtree(
+        NodeType* top, NodeType* at, NodeType* restTop,
+        NodeType* headBound, NodeType* restBound
+    ) -> std::pair<Subtree, Subtree>
+    {
+        using H = TraitsHelper;
+        auto node = H(at);
+        auto head = ChildSubtree(node, 0);
+        auto rest = ChildSubtree(node, 1);
+        int height = std::max(head.height, rest.height) + 1;
+        auto parent = H(node.Parent());
+        bool fromRight = parent.Children(0) != node;
+        rest = JoinSubtrees(
+            restTop, {}, node, rest, restBound, node.Children(1)
+        );
+        // Walk to the root joining every ancestor with its other subtree
+        // to the piece it belongs to. Heights of the other subtrees are
+        // restored from balances, the sum of join costs telescopes to
+        // O(log n).
+        while (parent != top) {
+            auto next = H(parent.Parent());
+            bool nextFromRight = next.Children(0) != parent;
+            int balance = parent.Balance();
+            int siblingHeight = height + (fromRight ? balance : -balance);
+            Subtree sibling = {
+                siblingHeight != 0 ? +parent.Children(!fromRight) : nullptr,
+                siblingHeight
+            };
+            height = std::max(height, siblingHeight) + 1;
+            if (fromRight) {
+                head = JoinSubtrees(
+                    top, sibling, parent, head,
+                    parent.Children(0), headBound
+                );
+            } else {
+                rest = JoinSubtrees(
+                    restTop, rest, parent, sibling,
+                    restBound, parent.Children(1)
+                );
+            }
+            parent = +next;
+            fromRight = nextFromRight;
+        }
+        return { head, rest };
+    }
+
+    // Builds a perfectly balanced subtree of the sorted nodes, threads
+    // leading out of it are set to lthread and rthread.
+    auto BuildSubtree(
+        T* const* elems, std::size_t count,
+        NodeType* lthread, NodeType* rthread
+    ) -> Subtree
+    {
+        using H = TraitsHelper;
+        using cp = CastPolicy;
+        if (count == 0) {
+            return {};
+        }
+        auto mid = count / 2;
+        auto node = H(cp::ToNode(elems[mid]));
+        auto l = BuildSubtree(elems, mid, lthread, node);
+        auto r = BuildSubtree(elems + mid + 1, count - mid - 1, node, rthread);
+        node.Children(0) = l.root ? l.root : lthread;
+        node.Children(1) = r.root ? r.root : rthread;
+        if (l.root) {
+            H(l.root).Parent() = node;
+        }
+        if (r.root) {
+            H(r.root).Parent() = node;
+        }
+        node.Balance() = l.height - r.height;
+        // The parent of node is not set yet, RealChild cannot tell its
+        // threads from children.
+        if constexpr (Augmented) {
+            NodeTraits::Update(*node, l.root, r.root);
+        }
+        return { node, l.height + 1 };
+    }
+
+    void AdoptSorted(const std::vector<T*>& elems)
+    {
+        using cp = CastPolicy;
+        auto tree = BuildSubtree(
+            elems.data(), elems.size(),
+            AddressOf(sentinel), AddressOf(sentinel)
+        );
+        Adopt(tree.root, cp::ToNode(elems.front()), cp::ToNode(elems.back()));
+    }
+
+    // UpperBound of key not less than the element of from. Climbs to the
+    // lowest ancestor whose subtree bounds key and searches down from it.
+    template <typename KeyType>
+    constexpr auto UpperBoundFrom(NodeType* from, const KeyType& key) -> Iterator
+    {
+        using H = TraitsHelper;
+        using cp = CastPolicy;
+        Less comp;
+        auto node = H(from);
+        while (true) {
+            auto parent = H(node.Parent());
+            while (parent != AddressOf(sentinel) && parent.Children(1) == node) {
+                node = +parent;
+                parent = node.Parent();
+            }
+            if (parent == AddressOf(sentinel) || comp(key, *cp::FromNode(parent))) {
+                break;
+            }
+            node = +parent;
+        }
+        NodeType* result = node.Parent();
+        while (true) {
+            bool right = !comp(key, *cp::FromNode(node));
+            if (!right) {
+                result = node;
+            }
+            auto child = node.Children(right);
+            if (child.Parent() != node) {
+                return { result };
+            }
+            node = +child;
+        }
+    }
+
+    // Makes the subtree at root the content of the tree, first and last are
+    // its extreme nodes.
+    constexpr void Adopt(NodeType* root, NodeType* first, NodeType* last)
+    {
+        using Tr = NodeTraits;
+        if (root == nullptr) {
+            Clear();
+            return;
+        }
+        Tr::SetParent(*root, AddressOf(sentinel));
+        Tr::SetChild(sentinel, 0, root);
+        Tr::SetChild(sentinel, 1, first);
+        Tr::SetChild(*first, 0, AddressOf(sentinel));
+        Tr::SetChild(*last, 1, AddressOf(sentinel));
+    }
+
+    enum class SetOperation {
+        Union,
+        Intersection,
+        Difference
+    };
+
+    struct SequentialExecutor {
+        template <typename F, typename G>
+        void Invoke(F&& f, G&& g)
+        {
+            f();
+            g();
+        }
+    };
+
+    // Pieces lower than that are not worth to be forked.
+    static constexpr int ParallelGrainHeight = 12;
+
+    // Searches advanced together by the batched lookups.
+    static constexpr std::size_t BatchGroupSize = 16;
+
+    // step(key, node, range, result) does one level of a search and
+    // returns true once result is set, result is End() unless set.
+    template <typename KeyType, typename Step>
+    void SearchBatch(
+        const KeyType* keys, std::size_t count, Iterator* out, Step step
+    )
+    {
+        auto root = NodeTraits::GetChild(sentinel, 0);
+        for (std::size_t base = 0; base < count; base += BatchGroupSize) {
+            auto size = std::min(BatchGroupSize, count - base);
+            NodeType* nodes[BatchGroupSize] = {};
+            NodeType* ranges[BatchGroupSize][2];
+            NodeType* results[BatchGroupSize];
+            std::size_t active = 0;
+            for (std::size_t i = 0; i < size; ++i) {
+                results[i] = AddressOf(sentinel);
+                ranges[i][0] = ranges[i][1] = AddressOf(sentinel);
+                if (root != AddressOf(sentinel)) {
+                    nodes[i] = root;
+                    ++active;
+                }
+            }
+            while (active != 0) {
+                for (std::size_t i = 0; i < size; ++i) {
+                    if (nodes[i] == nullptr) {
+                        continue;
+                    }
+                    if (step(keys[base + i], nodes[i], ranges[i], results[i])) {
+                        nodes[i] = nullptr;
+                        --active;
+                    } else {
+                        Prefetch(ptr_cast(nodes[i]));
+                    }
+                }
+            }
+            for (std::size_t i = 0; i < size; ++i) {
+                out[base + i] = results[i];
+            }
+        }
+    }
+
+    // Subtree detached for a set operation along with its extreme nodes.
+    // Threads leading out of a piece point to the sentinel, which is never
+    // written while the operation runs.
+    struct Piece {
+        Subtree tree;
+        NodeType* first = nullptr;
+        NodeType* last = nullptr;
+    };
+
+    // Heights of the children of a node of the given height.
+    static auto ChildHeights(NodeType* node, int height) -> std::pair<int, int>
+    {
+        int balance = NodeTraits::GetBalance(*node);
+        return {
+            height - 1 - std::max(0, -balance),
+            height - 1 - std::max(0, balance)
+        };
+    }
+
+    // Sequential in order walk, the right child is prefetched to be ready
+    // once the left subtree is done.
+    template <typename F>
+    static void VisitSubtree(NodeType* node, F& f)
+    {
+        using cp = CastPolicy;
+        while (node) {
+            auto right = RealChild(node, 1);
+            if (right) {
+                Prefetch(ptr_cast(right));
+            }
+            if (auto left = RealChild(node, 0)) {
+                VisitSubtree(left, f);
+            }
+            f(*cp::FromNode(node));
+            node = right;
+        }
+    }
+
+    // Subtrees higher than ParallelGrainHeight have both children.
+    template <typename F, typename Executor>
+    static void ForEachIn(NodeType* node, int height, F& f, Executor& executor)
+    {
+        using cp = CastPolicy;
+        if (height <= ParallelGrainHeight) {
+            VisitSubtree(node, f);
+            return;
+        }
+        auto [lheight, rheight] = ChildHeights(node, height);
+        auto left = RealChild(node, 0);
+        auto right = RealChild(node, 1);
+        executor.Invoke(
+            [&] {
+                ForEachIn(left, lheight, f, executor);
+                f(*cp::FromNode(node));
+            },
+            [&] { ForEachIn(right, rheight, f, executor); }
+        );
+    }
+
+    template <typename V, typename Op, typename Transform, typename Executor>
+    static auto ReduceIn(
+        NodeType* node, int height, Op& op, Transform& transform,
+        Executor& executor
+    ) -> V
+    {
+        using cp = CastPolicy;
+        if (height <= ParallelGrainHeight) {
+            std::optional<V> result;
+            auto accumulate = [&](T& elem) {
+                if (result) {
+                    result = op(std::move(*result), transform(elem));
+                } else {
+                    result = transform(elem);
+                }
+            };
+            VisitSubtree(node, accumulate);
+            return std::move(*result);
+        }
+        auto [lheight, rheight] = ChildHeights(node, height);
+        auto left = RealChild(node, 0);
+        auto right = RealChild(node, 1);
+        std::optional<V> head, tail;
+        executor.Invoke(
+            [&] {
+                head = op(
+                    ReduceIn<V>(left, lheight, op, transform, executor),
+                    transform(*cp::FromNode(node))
+                );
+            },
+            [&] { tail = ReduceIn<V>(right, rheight, op, transform, executor); }
+        );
+        return op(std::move(*head), std::move(*tail));
+    }
+
+    auto TakePiece(NodeType* bound) -> Piece
+    {
+        using Tr = NodeTraits;
+        if (Empty()) {
+            return {};
+        }
+        Piece piece = { RootSubtree(), Begin().current, (--End()).current };
+        Clear();
+        Tr::SetChild(*piece.first, 0, bound);
+        Tr::SetChild(*piece.last, 1, bound);
+        return piece;
+    }
+
+    template <typename Executor>
+    void Combine(AVLTree& oth, Executor& executor, SetOperation op)
+    {
+        auto a = TakePiece(AddressOf(sentinel));
+        auto b = oth.TakePiece(AddressOf(sentinel));
+        auto result = CombinePieces(a, b, executor, op);
+        Adopt(result.tree.root, result.first, result.last);
+    }
+
+    template <typename Executor>
+    auto CombinePieces(
+        Piece a, Piece b, Executor& executor, SetOperation op
+    ) -> Piece
+    {
+        using Tr = NodeTraits;
+        using cp = CastPolicy;
+        if (a.tree.root == nullptr) {
+            return op == SetOperation::Union ? b : Piece{};
+        }
+        if (b.tree.root == nullptr) {
+            return op == SetOperation::Intersection ? Piece{} : a;
+        }
+        auto bound = AddressOf(sentinel);
+        auto pivot = a.tree.root;
+        Piece aHead = { ChildSubtree(pivot, 0) };
+        Piece aTail = { ChildSubtree(pivot, 1) };
+        if (aHead.tree.root != nullptr) {
+            aHead.first = a.first;
+            aHead.last = Neighbour(pivot, false);
+            Tr::SetChild(*aHead.last, 1, bound);
+        }
+        if (aTail.tree.root != nullptr) {
+            aTail.first = Neighbour(pivot, true);
+            aTail.last = a.last;
+            Tr::SetChild(*aTail.first, 0, bound);
+        }
+        auto& key = *cp::FromNode(pivot);
+        auto lower = SplitPiece(b, BoundIn(b, key, false));
+        auto upper = SplitPiece(lower.second, BoundIn(lower.second, key, true));
+        bool found = upper.first.tree.root != nullptr;
+        Piece head, tail;
+        auto runHead = [&] {
+            head = CombinePieces(aHead, lower.first, executor, op);
+        };
+        auto runTail = [&] {
+            tail = CombinePieces(aTail, upper.second, executor, op);
+        };
+        if (std::min(a.tree.height, b.tree.height) > ParallelGrainHeight) {
+            executor.Invoke(runHead, runTail);
+        } else {
+            runHead();
+            runTail();
+        }
+        if (op == SetOperation::Union || (op == SetOperation::Intersection) == found) {
+            return JoinPieces(head, pivot, tail);
+        }
+        return ConcatPieces(head, tail);
+    }
+
+    // First node of the piece not less than key, or greater than key when
+    // upper is set, nullptr if there is none.
+    template <typename KeyType>
+    auto BoundIn(const Piece& piece, const KeyType& key, bool upper) -> NodeType*
+    {
+        using H = TraitsHelper;
+        using cp = CastPolicy;
+        if (piece.tree.root == nullptr) {
+            return nullptr;
+        }
+        NodeType* result = nullptr;
+        auto node = H(piece.tree.root);
+        while (true) {
+            Less comp;
+            auto& elem = *cp::FromNode(node);
+            bool right = upper ? !comp(key, elem) : comp(elem, key);
+            if (!right) {
+                result = node;
+            }
+            auto child = node.Children(right);
+            if (child.Parent() != node) {
+                return result;
+            }
+            node = +child;
+        }
+    }
+
+    auto SplitPiece(Piece piece, NodeType* at) -> std::pair<Piece, Piece>
+    {
+        using Tr = NodeTraits;
+        if (at == nullptr) {
+            return { piece, {} };
+        }
+        if (at == piece.first) {
+            return { {}, piece };
+        }
+        auto bound = AddressOf(sentinel);
+        NodeType top, restTop;
+        Tr::SetParent(top, nullptr);
+        Tr::SetChild(top, 0, piece.tree.root);
+        Tr::SetParent(*piece.tree.root, AddressOf(top));
+        auto prev = Neighbour(at, false);
+        auto [head, rest] = SplitSubtree(
+            AddressOf(top), at, AddressOf(restTop), bound, bound
+        );
+        Tr::SetChild(*prev, 1, bound);
+        return { { head, piece.first, prev }, { rest, at, piece.last } };
+    }
+
+    auto JoinPieces(Piece l, NodeType* pivot, Piece r) -> Piece
+    {
+        using Tr = NodeTraits;
+        auto bound = AddressOf(sentinel);
+        if (l.tree.root != nullptr) {
+            Tr::SetChild(*l.last, 1, pivot);
+        }
+        if (r.tree.root != nullptr) {
+            Tr::SetChild(*r.first, 0, pivot);
+        }
+        NodeType top;
+        Tr::SetParent(top, nullptr);
+        auto tree = JoinSubtrees(AddressOf(top), l.tree, pivot, r.tree, bound, bound);
+        return {
+            tree,
+            l.tree.root != nullptr ? l.first : pivot,
+            r.tree.root != nullptr ? r.last : pivot
+        };
+    }
+
+    auto ConcatPieces(Piece l, Piece r) -> Piece
+    {
+        if (l.tree.root == nullptr) {
+            return r;
+        }
+        if (r.tree.root == nullptr) {
+            return l;
+        }
+        auto last = l.last;
+        return JoinPieces(SplitPiece(l, last).first, last, r);
+    }
+
+    constexpr void TakeOver(AVLTree& oth)
+    {
+        if (oth.Empty()) {
+            Clear();
+            return;
+        }
+        auto root = NodeTraits::GetChild(oth.sentinel, 0);
+        auto first = oth.Begin().current;
+        auto last = (--oth.End()).current;
+        oth.Clear();
+        Adopt(root, first, last);
+    }
+
+    constexpr Iterator InsertUnrestricted(Iterator hint, T& elem)
     {
         using Tr = AVLTreeNodeTraits<NodeType>;
         using H = TraitsHelper;
@@ -319,69 +1422,87 @@ private:
             Tr::SetChild(sentinel, 1, node);
         } // TODO: sentinel update without branch
         parentNode.Children(rightInsert) = node;
-        RebalanceTreeI(parentNode, rightInsert);
+        UpdatePath(node, AddressOf(sentinel));
+        RebalanceTreeI(AddressOf(sentinel), parentNode, rightInsert);
         return { node };
     }
 
-    void RebalanceTreeI(NodeType* fromArg, bool balanceSign)
+    // Returns true when the height of the whole tree hung from head has
+    // grown.
+    constexpr bool RebalanceTreeI(NodeType* head, NodeType* fromArg, bool balanceSign)
     {
         using H = TraitsHelper;
         auto from = H(fromArg);
-        while (from != AddressOf(sentinel)) {
+        std::size_t length = 0;
+        while (from != head) {
+            ++length;
             int balanceDiff = 1 - 2 * balanceSign;
             from.Balance() = from.Balance() + balanceDiff;
             auto nextNode = H(from.Parent());
             bool chInd = nextNode.Children(0) != from;
             if (
                 from.Balance() == 0 ||
-                (std::abs(from.Balance()) == 2 &&
+                (Abs(from.Balance()) == 2 &&
                 RotateSubtree(nextNode, chInd, from.Balance() > 0))
             ) {
-                return;
+                instrumentation.OnRebalance(length);
+                return false;
             }
             balanceSign = chInd;
             from = +nextNode;
         }
+        instrumentation.OnRebalance(length);
+        return true;
     }
 
-    std::size_t EraseInternal(Iterator b, Iterator e)
+    constexpr std::size_t EraseInternal(Iterator b, Iterator e)
     {
         std::size_t count = 0;
-        for (auto i = b; i != e; i = Erase(i)) { ++count; }
+        if constexpr (Sized) {
+            count = IndexOf(e) - IndexOf(b);
+        } else {
+            for (auto i = b; i != e; ++i) { ++count; }
+        }
+        Erase(b, e);
         return count;
     }
 
-    void RebalanceTreeE(NodeType* fromArg, bool balanceSign)
+    constexpr void RebalanceTreeE(NodeType* fromArg, bool balanceSign)
     {
         using H = TraitsHelper;
         auto from = H(fromArg);
+        std::size_t length = 0;
         while (from != AddressOf(sentinel)) {
+            ++length;
             int balanceDiff = 1 - 2 * balanceSign;
             from.Balance() = from.Balance() + balanceDiff;
             auto nextNode = H(from.Parent());
             bool chInd = nextNode.Children(0) != from;
             if (
-                from.Balance() != 0 &&
-                std::abs(from.Balance()) == 2 &&
-                !RotateSubtree(nextNode, chInd, from.Balance() > 0)
+                Abs(from.Balance()) == 1 ||
+                (Abs(from.Balance()) == 2 &&
+                !RotateSubtree(nextNode, chInd, from.Balance() > 0))
             ) {
-                return;
+                break;
             }
             balanceSign = !chInd;
             from = +nextNode;
         }
+        instrumentation.OnRebalance(length);
     }
 
-    bool RotateSubtree(NodeType* parent, bool parentRight, bool right)
+    constexpr bool RotateSubtree(NodeType* parent, bool parentRight, bool right)
     {
         using H = TraitsHelper;
         auto subtree = H(parent).Children(parentRight);
         auto a = H(subtree), b = H(subtree.Children(!right));
         int dirSign = right * 2 - 1;
         if (b.Balance() * dirSign < 0) {
+            instrumentation.OnRotation(true);
             subtree = RotateSubtreeBig(a, b, right);
             return true;
         }
+        instrumentation.OnRotation(false);
         bool result = (b.Balance() != 0);
         if (b.Children(right) != a) {
             a.Children(!right) = b.Children(right);
@@ -393,10 +1514,12 @@ private:
         a.Parent() = b;
         a.Balance() = dirSign - b.Balance();
         b.Balance() = -dirSign + b.Balance();
+        UpdateNode(a);
+        UpdateNode(b);
         return result;
     }
 
-    auto RotateSubtreeBig(NodeType* aArg, NodeType* bArg, bool right) -> NodeType*
+    constexpr auto RotateSubtreeBig(NodeType* aArg, NodeType* bArg, bool right) -> NodeType*
     {
         using H = TraitsHelper;
         auto a = H(aArg), b = H(bArg), c = H(b.Children(right));
@@ -415,13 +1538,86 @@ private:
         c.Parent() = a.Parent();
         a.Parent() = c;
         b.Parent() = c;
-        a.Balance() = ((c.Balance() < 0) ? -(c.Balance()) : 0);
-        b.Balance() = ((c.Balance() > 0) ? -(c.Balance()) : 0);
+        int dirSign = right * 2 - 1;
+        a.Balance() = ((c.Balance() * dirSign > 0) ? -(c.Balance()) : 0);
+        b.Balance() = ((c.Balance() * dirSign < 0) ? -(c.Balance()) : 0);
         c.Balance() = 0;
+        UpdateNode(a);
+        UpdateNode(b);
+        UpdateNode(c);
         return c;
     }
 
-    static NodeType* FindNeighbour(NodeType* nodeArg, bool right)
+    static constexpr auto RealChild(NodeType* nodeArg, bool right) -> NodeType*
+    {
+        using H = TraitsHelper;
+        auto node = H(nodeArg);
+        auto child = node.Children(right);
+        return child.Parent() == node ? +child : nullptr;
+    }
+
+    static constexpr void UpdateNode(NodeType* node)
+    {
+        if constexpr (Augmented) {
+            NodeTraits::Update(*node, RealChild(node, 0), RealChild(node, 1));
+        }
+    }
+
+    // Updates augmentation of node and all its ancestors below head.
+    static constexpr void UpdatePath(NodeType* node, NodeType* head)
+    {
+        if constexpr (Augmented) {
+            for (; node != head; node = NodeTraits::GetParent(*node)) {
+                UpdateNode(node);
+            }
+        }
+    }
+
+    static constexpr auto SubtreeSize(NodeType* node, bool right) -> std::size_t
+    {
+        auto child = RealChild(node, right);
+        return child ? NodeTraits::GetSize(*child) : 0;
+    }
+
+    // Visits elements with begin < hi (begin <= hi if closed) and end > lo
+    // in the subtree of node.
+    template <typename KeyType, typename F>
+    static constexpr void VisitOverlapping(
+        NodeType* node, const KeyType& lo, const KeyType& hi, bool closed,
+        F& f
+    )
+    {
+        using Tr = NodeTraits;
+        using cp = CastPolicy;
+        while (node) {
+            auto left = RealChild(node, 0);
+            if (left && lo < Tr::GetMaxEnd(*left)) {
+                VisitOverlapping(left, lo, hi, closed, f);
+            }
+            auto& begin = Tr::GetBegin(*node);
+            if (closed ? hi < begin : !(begin < hi)) {
+                return;
+            }
+            if (lo < Tr::GetEnd(*node)) {
+                f(*cp::FromNode(node));
+            }
+            auto right = RealChild(node, 1);
+            node = (right && lo < Tr::GetMaxEnd(*right)) ? right : nullptr;
+        }
+    }
+
+    static constexpr NodeType* Neighbour(NodeType* nodeArg, bool right)
+    {
+        using H = TraitsHelper;
+        auto node = H(nodeArg);
+        auto next = node.Children(right);
+        if (next.Parent() != node) {
+            return next;
+        }
+        return FindNeighbour(node, right);
+    }
+
+    static constexpr NodeType* FindNeighbour(NodeType* nodeArg, bool right)
     {
         using H = TraitsHelper;
         auto node = H(nodeArg);
@@ -433,6 +1629,7 @@ private:
     }
 
     NodeType sentinel;
+    [[no_unique_address]] Instrumentation instrumentation;
 };
 
 }
@@ -1,7 +1,13 @@
 #ifndef AVL_TREE_NODE_H
 #define AVL_TREE_NODE_H
 
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
 #include <type_traits>
+#include "util.hpp"
 
 namespace container_test::intrusive {
 
@@ -13,45 +19,377 @@ struct AVLTreeNode<void> {
     AVLTreeNode* parent;
     AVLTreeNode* children[2];
     int balance;
-    AVLTreeNode() {};
+    constexpr AVLTreeNode() {};
 };
 
 template <typename Tag>
 struct AVLTreeNode : AVLTreeNode<> {};
 
+// Node with balance kept in the low bits of the parent pointer, three
+// pointers in size. Balance reaches +-2 while rebalancing, so three bits
+// are used.
+template <typename Tag = void>
+struct AVLTreeCompactNode;
+
+template <>
+struct alignas(8) AVLTreeCompactNode<void> {
+    std::uintptr_t parentAndBalance;
+    AVLTreeCompactNode* children[2];
+    // The traits update parent and balance separately, so the word they
+    // share starts out defined.
+    constexpr AVLTreeCompactNode() :
+        parentAndBalance(0)
+    {};
+};
+
+template <typename Tag>
+struct AVLTreeCompactNode : AVLTreeCompactNode<> {};
+
+// Node with atomic links for trees read concurrently with a writer, see
+// SeqlockAVLTree. Children are published with release stores, so a reader
+// that reaches a node sees it initialized.
+template <typename Tag = void>
+struct AVLTreeAtomicNode;
+
+template <>
+struct AVLTreeAtomicNode<void> {
+    std::atomic<AVLTreeAtomicNode*> parent;
+    std::atomic<AVLTreeAtomicNode*> children[2];
+    std::atomic<int> balance;
+    AVLTreeAtomicNode() {};
+};
+
+template <typename Tag>
+struct AVLTreeAtomicNode : AVLTreeAtomicNode<> {};
+
+// Node with self-relative links, a tree of such nodes stays valid when the
+// memory holding the tree and its elements is mapped at another address.
+template <typename Tag = void>
+struct AVLTreeRelativeNode;
+
+template <>
+struct AVLTreeRelativeNode<void> {
+    RelativePtr<AVLTreeRelativeNode> parent;
+    RelativePtr<AVLTreeRelativeNode> children[2];
+    int balance;
+    AVLTreeRelativeNode() {};
+};
+
+template <typename Tag>
+struct AVLTreeRelativeNode : AVLTreeRelativeNode<> {};
+
+// Subtree size augmented node, enables order statistics of AVLTree.
+template <typename Tag = void>
+struct AVLTreeSizedNode;
+
+template <>
+struct AVLTreeSizedNode<void> {
+    AVLTreeSizedNode* parent;
+    AVLTreeSizedNode* children[2];
+    int balance;
+    std::size_t size;
+    constexpr AVLTreeSizedNode() {};
+};
+
+template <typename Tag>
+struct AVLTreeSizedNode : AVLTreeSizedNode<> {};
+
+// Half open interval [begin, end) augmented with the greatest end in the
+// subtree, enables overlap queries of AVLTree. Elements have to be ordered
+// by begin.
+template <typename Key, typename Tag = void>
+struct AVLTreeIntervalNode;
+
+template <typename Key>
+struct AVLTreeIntervalNode<Key, void> {
+    AVLTreeIntervalNode* parent;
+    AVLTreeIntervalNode* children[2];
+    int balance;
+    Key begin;
+    Key end;
+    Key maxEnd;
+    constexpr AVLTreeIntervalNode() {};
+};
+
+template <typename Key, typename Tag>
+struct AVLTreeIntervalNode : AVLTreeIntervalNode<Key> {};
+
+// Disjoint half open range [begin, end) augmented with the bounds of the
+// subtree and the widest gap between its consecutive ranges, enables gap
+// search of AVLTree. Elements have to be ordered by begin.
+template <typename Key, typename Tag = void>
+struct AVLTreeGapNode;
+
+template <typename Key>
+struct AVLTreeGapNode<Key, void> {
+    AVLTreeGapNode* parent;
+    AVLTreeGapNode* children[2];
+    int balance;
+    Key begin;
+    Key end;
+    Key minBegin;
+    Key maxEnd;
+    Key maxGap;
+    constexpr AVLTreeGapNode() {};
+};
+
+template <typename Key, typename Tag>
+struct AVLTreeGapNode : AVLTreeGapNode<Key> {};
+
+namespace avl_tree_detail {
+
+// Traits of nodes that keep links in parent, children and balance members.
+template <typename Node>
+struct MemberNodeTraits {
+    static constexpr auto GetParent(Node& node) -> Node*
+    {
+        return static_cast<Node*>(node.parent);
+    }
+    static constexpr void SetParent(Node& node, Node* parent)
+    {
+        node.parent = parent;
+    }
+    static constexpr auto GetChild(Node& node, bool right) -> Node*
+    {
+        return static_cast<Node*>(node.children[right]);
+    }
+    static constexpr void SetChild(Node& node, bool right, Node* child)
+    {
+        node.children[right] = child;
+    }
+    static constexpr int GetBalance(Node& node)
+    {
+        return node.balance;
+    }
+    static constexpr void SetBalance(Node& node, int balance)
+    {
+        node.balance = balance;
+    }
+};
+
+}
+
 template <typename T>
 struct AVLTreeNodeTraits;
 
 template <typename T>
-struct AVLTreeNodeTraits<AVLTreeNode<T>> {
-    static auto GetParent(AVLTreeNode<T>& node) -> AVLTreeNode<T>*
+struct AVLTreeNodeTraits<AVLTreeNode<T>> :
+    avl_tree_detail::MemberNodeTraits<AVLTreeNode<T>>
+{};
+
+template <typename T>
+struct AVLTreeNodeTraits<AVLTreeCompactNode<T>> {
+    using NodeType = AVLTreeCompactNode<T>;
+    static constexpr std::uintptr_t BalanceMask = 7;
+    static auto GetParent(NodeType& node) -> NodeType*
+    {
+        return ptr_cast<NodeType*>(node.parentAndBalance & ~BalanceMask);
+    }
+    static void SetParent(NodeType& node, NodeType* parent)
+    {
+        node.parentAndBalance =
+            ptr_cast(parent) | (node.parentAndBalance & BalanceMask);
+    }
+    static auto GetChild(NodeType& node, bool right) -> NodeType*
     {
-        return node.parent;
+        return static_cast<NodeType*>(node.children[right]);
     }
-    static void SetParent(AVLTreeNode<T>& node, AVLTreeNode<T>* parent)
+    static void SetChild(NodeType& node, bool right, NodeType* child)
+    {
+        node.children[right] = child;
+    }
+    static int GetBalance(NodeType& node)
+    {
+        return int(node.parentAndBalance & BalanceMask) - 2;
+    }
+    static void SetBalance(NodeType& node, int balance)
+    {
+        node.parentAndBalance = (node.parentAndBalance & ~BalanceMask) |
+            std::uintptr_t(balance + 2);
+    }
+};
+
+template <typename T>
+struct AVLTreeNodeTraits<AVLTreeAtomicNode<T>> {
+    using NodeType = AVLTreeAtomicNode<T>;
+    static auto GetParent(NodeType& node) -> NodeType*
+    {
+        return static_cast<NodeType*>(
+            node.parent.load(std::memory_order_relaxed)
+        );
+    }
+    static void SetParent(NodeType& node, NodeType* parent)
+    {
+        node.parent.store(parent, std::memory_order_relaxed);
+    }
+    static auto GetChild(NodeType& node, bool right) -> NodeType*
+    {
+        return static_cast<NodeType*>(
+            node.children[right].load(std::memory_order_acquire)
+        );
+    }
+    static void SetChild(NodeType& node, bool right, NodeType* child)
+    {
+        node.children[right].store(child, std::memory_order_release);
+    }
+    static int GetBalance(NodeType& node)
+    {
+        return node.balance.load(std::memory_order_relaxed);
+    }
+    static void SetBalance(NodeType& node, int balance)
+    {
+        node.balance.store(balance, std::memory_order_relaxed);
+    }
+};
+
+template <typename T>
+struct AVLTreeNodeTraits<AVLTreeRelativeNode<T>> {
+    using NodeType = AVLTreeRelativeNode<T>;
+    static auto GetParent(NodeType& node) -> NodeType*
+    {
+        return static_cast<NodeType*>(node.parent.Get());
+    }
+    static void SetParent(NodeType& node, NodeType* parent)
     {
         node.parent = parent;
     }
-    static auto GetChild(AVLTreeNode<T>& node, bool right) -> AVLTreeNode<T>*
+    static auto GetChild(NodeType& node, bool right) -> NodeType*
     {
-        return node.children[right];
+        return static_cast<NodeType*>(node.children[right].Get());
     }
-    static void SetChild(AVLTreeNode<T>& node, bool right, AVLTreeNode<T>* child)
+    static void SetChild(NodeType& node, bool right, NodeType* child)
     {
         node.children[right] = child;
     }
-    static  int GetBalance(AVLTreeNode<T>& node)
+    static int GetBalance(NodeType& node)
     {
         return node.balance;
     }
-    static void SetBalance(AVLTreeNode<T>& node, int balance)
+    static void SetBalance(NodeType& node, int balance)
     {
         node.balance = balance;
     }
 };
 
+// Augmented traits provide Update(node, left, right), it is called with
+// the real children of node (nullptr for a thread) whenever the content of
+// its subtree may have changed, children are already up to date.
+template <typename T>
+struct AVLTreeNodeTraits<AVLTreeSizedNode<T>> :
+    avl_tree_detail::MemberNodeTraits<AVLTreeSizedNode<T>>
+{
+    using NodeType = AVLTreeSizedNode<T>;
+    static constexpr auto GetSize(NodeType& node) -> std::size_t
+    {
+        return node.size;
+    }
+    static constexpr void Update(NodeType& node, NodeType* left, NodeType* right)
+    {
+        node.size = 1 + (left ? left->size : 0) + (right ? right->size : 0);
+    }
+};
+
+template <typename Key, typename Tag>
+struct AVLTreeNodeTraits<AVLTreeIntervalNode<Key, Tag>> :
+    avl_tree_detail::MemberNodeTraits<AVLTreeIntervalNode<Key, Tag>>
+{
+    using NodeType = AVLTreeIntervalNode<Key, Tag>;
+    static constexpr auto GetBegin(NodeType& node) -> const Key&
+    {
+        return node.begin;
+    }
+    static constexpr auto GetEnd(NodeType& node) -> const Key&
+    {
+        return node.end;
+    }
+    static constexpr auto GetMaxEnd(NodeType& node) -> const Key&
+    {
+        return node.maxEnd;
+    }
+    static constexpr void Update(NodeType& node, NodeType* left, NodeType* right)
+    {
+        node.maxEnd = node.end;
+        if (left && node.maxEnd < left->maxEnd) {
+            node.maxEnd = left->maxEnd;
+        }
+        if (right && node.maxEnd < right->maxEnd) {
+            node.maxEnd = right->maxEnd;
+        }
+    }
+};
+
+template <typename Key, typename Tag>
+struct AVLTreeNodeTraits<AVLTreeGapNode<Key, Tag>> :
+    avl_tree_detail::MemberNodeTraits<AVLTreeGapNode<Key, Tag>>
+{
+    using NodeType = AVLTreeGapNode<Key, Tag>;
+    static constexpr auto GetBegin(NodeType& node) -> const Key&
+    {
+        return node.begin;
+    }
+    static constexpr auto GetEnd(NodeType& node) -> const Key&
+    {
+        return node.end;
+    }
+    static constexpr auto GetMinBegin(NodeType& node) -> const Key&
+    {
+        return node.minBegin;
+    }
+    static constexpr auto GetMaxEnd(NodeType& node) -> const Key&
+    {
+        return node.maxEnd;
+    }
+    static constexpr auto GetMaxGap(NodeType& node) -> const Key&
+    {
+        return node.maxGap;
+    }
+    // Ranges are disjoint, so the bounds are those of the outermost ones.
+    static constexpr void Update(NodeType& node, NodeType* left, NodeType* right)
+    {
+        node.minBegin = left ? left->minBegin : node.begin;
+        node.maxEnd = right ? right->maxEnd : node.end;
+        node.maxGap = Key();
+        if (left) {
+            node.maxGap = std::max({
+                node.maxGap, left->maxGap, Key(node.begin - left->maxEnd)
+            });
+        }
+        if (right) {
+            node.maxGap = std::max({
+                node.maxGap, right->maxGap, Key(right->minBegin - node.end)
+            });
+        }
+    }
+};
+
 namespace avl_tree_detail {
 
+template <typename Traits, typename Node>
+concept AugmentedTraits = requires (Node& node, Node* child) {
+    Traits::Update(node, child, child);
+};
+
+template <typename Traits, typename Node>
+concept SizedTraits = AugmentedTraits<Traits, Node> &&
+requires (Node& node) {
+    { Traits::GetSize(node) } -> std::convertible_to<std::size_t>;
+};
+
+template <typename Traits, typename Node>
+concept IntervalTraits = AugmentedTraits<Traits, Node> &&
+requires (Node& node) {
+    Traits::GetBegin(node);
+    Traits::GetEnd(node);
+    Traits::GetMaxEnd(node);
+};
+
+template <typename Traits, typename Node>
+concept GapTraits = IntervalTraits<Traits, Node> &&
+requires (Node& node) {
+    Traits::GetMinBegin(node);
+    Traits::GetMaxGap(node);
+};
+
 struct MoveConstructible {
     MoveConstructible() = default;
     MoveConstructible(const MoveConstructible&) = delete;
@@ -63,7 +401,7 @@ struct MoveConstructible {
 template <typename Drvd, typename T>
 struct Comparable : MoveConstructible {
     using ValueType = T;
-    operator ValueType() const
+    constexpr operator ValueType() const
     {
         return +*Get();
     }
@@ -76,11 +414,11 @@ struct Comparable : MoveConstructible {
 //        return +*one.Get() == oth;
 //    }
 private:
-    Drvd* Get()
+    constexpr Drvd* Get()
     {
         return static_cast<Drvd*>(this);
     }
-    auto Get() const -> const Drvd*
+    constexpr auto Get() const -> const Drvd*
     {
         return static_cast<const Drvd*>(this);
     }
@@ -96,19 +434,19 @@ template <typename T>
 struct BalanceHelper : Comparable<BalanceHelper<T>, int> {
     using NodeType = T;
     using NodeTraits = AVLTreeNodeTraits<NodeType>;
-    BalanceHelper(NodeType* node) : node(node)
+    constexpr BalanceHelper(NodeType* node) : node(node)
     {}
-    auto operator=(int newBalance) -> int
+    constexpr auto operator=(int newBalance) -> int
     {
         NodeTraits::SetBalance(*node, newBalance);
         return newBalance;
     }
-    auto operator=(const BalanceHelper& hlp) -> BalanceHelper&
+    constexpr auto operator=(const BalanceHelper& hlp) -> BalanceHelper&
     {
         *this = +hlp;
         return *this;
     }
-    auto operator+() const -> int
+    constexpr auto operator+() const -> int
     {
         return NodeTraits::GetBalance(*node);
     }
@@ -123,20 +461,20 @@ template <template <typename> typename P, typename N>
 struct RecoursiveHelper<P<N>> {
     using Derived = P<N>;
     using NodeType = N;
-    auto Children(bool right) -> ChildrenHelper<NodeType>
+    constexpr auto Children(bool right) -> ChildrenHelper<NodeType>
     {
         return { (NodeType*)(*Get()), right };
     }
-    auto Balance() -> BalanceHelper<NodeType>
+    constexpr auto Balance() -> BalanceHelper<NodeType>
     {
         return { (NodeType*)(*Get()) };
     }
-    auto Parent() -> ParentHelper<NodeType>
+    constexpr auto Parent() -> ParentHelper<NodeType>
     {
         return { (NodeType*)(*Get()) };
     }
 private:
-    Derived* Get()
+    constexpr Derived* Get()
     {
         return static_cast<Derived*>(this);
     }
@@ -149,21 +487,21 @@ struct ChildrenHelper :
 {
     using NodeType = T;
     using NodeTraits = AVLTreeNodeTraits<NodeType>;
-    ChildrenHelper(NodeType* node, bool right) :
+    constexpr ChildrenHelper(NodeType* node, bool right) :
         node(node),
         right(right)
     {}
-    auto operator=(NodeType* newNode) -> NodeType*
+    constexpr auto operator=(NodeType* newNode) -> NodeType*
     {
         NodeTraits::SetChild(*node, right, newNode);
         return newNode;
     }
-    auto operator=(const ChildrenHelper& hlp) -> ChildrenHelper&
+    constexpr auto operator=(const ChildrenHelper& hlp) -> ChildrenHelper&
     {
         *this = +hlp;
         return *this;
     }
-    auto operator+() const -> NodeType*
+    constexpr auto operator+() const -> NodeType*
     {
         return NodeTraits::GetChild(*node, right);
     }
@@ -180,20 +518,20 @@ struct ParentHelper :
 public:
     using NodeType = T;
     using NodeTraits = AVLTreeNodeTraits<NodeType>;
-    ParentHelper(NodeType* node) :
+    constexpr ParentHelper(NodeType* node) :
         node(node)
     {}
-    auto operator=(NodeType* newNode) -> NodeType*
+    constexpr auto operator=(NodeType* newNode) -> NodeType*
     {
         NodeTraits::SetParent(*node, newNode);
         return newNode;
     }
-    auto operator=(const ParentHelper& hlp) -> ParentHelper&
+    constexpr auto operator=(const ParentHelper& hlp) -> ParentHelper&
     {
         *this = +hlp;
         return *this;
     }
-    auto operator+() const -> NodeType*
+    constexpr auto operator+() const -> NodeType*
     {
         return NodeTraits::GetParent(*node);
     }
@@ -210,13 +548,13 @@ struct AVLTreeNodeTraitsHelper :
 {
 public:
     using NodeType = T;
-    AVLTreeNodeTraitsHelper(NodeType* node) : node(node)
+    constexpr AVLTreeNodeTraitsHelper(NodeType* node) : node(node)
     {}
-    auto operator=(NodeType* newNode) -> NodeType*
+    constexpr auto operator=(NodeType* newNode) -> NodeType*
     {
         return node = newNode;
     }
-    auto operator+() const -> NodeType*
+    constexpr auto operator+() const -> NodeType*
     {
         return node;
     }
@@ -0,0 +1,480 @@
+#include <algorithm>
+#include <atomic>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+#include "avl_tree.hpp"
+#include "test.hpp"
+#include "thread_pool.hpp"
+
+using namespace container_test::intrusive;
+using container_test::ThreadPool;
+using container_test::test::Check;
+
+namespace {
+
+struct Elem : AVLTreeSizedNode<> {
+    int key;
+    std::size_t index;
+};
+
+struct Comp {
+    constexpr auto operator()(const Elem& a, const Elem& b) const
+    {
+        return a.key <=> b.key;
+    }
+    constexpr auto operator()(const Elem& a, int b) const
+    {
+        return a.key <=> b;
+    }
+};
+
+using Tree = AVLTree<Elem, Comp, BaseClassCastPolicy<AVLTreeSizedNode<>, Elem>>;
+using Expected = std::multiset<int>;
+
+// Nothing on the paths of Insert, Erase and Find may stop being constexpr.
+constexpr bool FindInConstantExpression()
+{
+    Elem elems[16]{};
+    Tree tree;
+    for (int i = 0; i != 16; ++i) {
+        elems[i].key = i * 7 % 16;
+        tree.Insert(elems[i]);
+    }
+    tree.Erase(tree.Find(3));
+    return tree.Find(5) != tree.End() && tree.Find(5)->key == 5
+        && tree.Find(3) == tree.End() && tree.Find(16) == tree.End();
+}
+
+static_assert(FindInConstantExpression());
+
+// Checks balance and augmentation of the subtree of node, returns its
+// height. Nodes are collected in order of the links, so the threads the
+// iterators follow can be compared against them.
+template <typename AnyTree>
+auto Walk(typename AnyTree::NodeType* node, std::vector<typename AnyTree::NodeType*>& nodes) -> int
+{
+    using Tr = typename AnyTree::NodeTraits;
+    using NodeType = typename AnyTree::NodeType;
+    auto child = [node](bool right) -> NodeType* {
+        auto child = Tr::GetChild(*node, right);
+        return Tr::GetParent(*child) == node ? child : nullptr;
+    };
+    auto left = child(0);
+    auto right = child(1);
+    auto lheight = left ? Walk<AnyTree>(left, nodes) : 0;
+    nodes.push_back(node);
+    auto rheight = right ? Walk<AnyTree>(right, nodes) : 0;
+    Check(Tr::GetBalance(*node) == lheight - rheight);
+    Check(lheight - rheight >= -1 && lheight - rheight <= 1);
+    if constexpr (AnyTree::Sized) {
+        auto size = 1 + (left ? Tr::GetSize(*left) : 0) + (right ? Tr::GetSize(*right) : 0);
+        Check(Tr::GetSize(*node) == size);
+    }
+    if constexpr (AnyTree::Interval) {
+        auto maxEnd = Tr::GetEnd(*node);
+        for (auto each : { left, right }) {
+            if (each && maxEnd < Tr::GetMaxEnd(*each)) {
+                maxEnd = Tr::GetMaxEnd(*each);
+            }
+        }
+        Check(Tr::GetMaxEnd(*node) == maxEnd);
+    }
+    return std::max(lheight, rheight) + 1;
+}
+
+// Walks the whole tree, its root is the node whose parent is the sentinel,
+// the only node without a parent.
+template <typename AnyTree>
+void CheckInvariants(AnyTree& tree)
+{
+    using Tr = typename AnyTree::NodeTraits;
+    using cp = typename AnyTree::CastPolicy;
+    std::vector<typename AnyTree::NodeType*> nodes;
+    if (!tree.Empty()) {
+        auto root = cp::ToNode(&*tree.Begin());
+        while (Tr::GetParent(*Tr::GetParent(*root)) != nullptr) {
+            root = Tr::GetParent(*root);
+        }
+        Walk<AnyTree>(root, nodes);
+    }
+    auto node = nodes.begin();
+    for (auto& elem : tree) {
+        Check(node != nodes.end() && *node == cp::ToNode(&elem));
+        ++node;
+    }
+    Check(node == nodes.end());
+}
+
+void CheckTree(Tree& tree, const Expected& expected)
+{
+    CheckInvariants(tree);
+    Check(tree.Size() == expected.size());
+    Check(tree.Empty() == expected.empty());
+    auto key = expected.begin();
+    std::size_t index = 0;
+    for (auto it = tree.Begin(); it != tree.End(); ++it, ++key, ++index) {
+        Check(key != expected.end() && it->key == *key);
+        Check(tree.IndexOf(it) == index);
+    }
+    Check(key == expected.end());
+    auto rkey = expected.rbegin();
+    for (auto it = tree.End(); it != tree.Begin(); ++rkey) {
+        --it;
+        Check(it->key == *rkey);
+    }
+}
+
+// Batches that go after the tree, before it and into it, of elements
+// never linked before and of ones reused after Clear.
+void TestInsertRange(unsigned seed)
+{
+    std::mt19937 random(seed);
+    {
+        std::vector<Elem> elems(3);
+        Tree tree;
+        for (int i = 0; i != 3; ++i) {
+            elems[i].key = i;
+            tree.Insert(elems[i]);
+        }
+        tree.Clear();
+        Tree reused;
+        reused.InsertRange(elems.begin(), elems.end());
+        CheckTree(reused, { 0, 1, 2 });
+    }
+    for (std::size_t size = 0; size <= 130; size += 1 + size / 4) {
+        std::vector<Elem> elems(size * 4);
+        for (int reuse = 0; reuse != 2; ++reuse) {
+            Tree tree;
+            Expected expected;
+            auto batch = [&](std::size_t first, int lo, int hi) {
+                for (auto i = first; i != first + size; ++i) {
+                    elems[i].key = lo + int(random() % unsigned(hi - lo));
+                    expected.insert(elems[i].key);
+                }
+                tree.InsertRange(elems.begin() + first, elems.begin() + first + size);
+                CheckTree(tree, expected);
+            };
+            batch(0, 1000, 2000);
+            batch(size, 2000, 3000);
+            batch(size * 2, 0, 1000);
+            batch(size * 3, 0, 3000);
+            tree.Clear();
+        }
+    }
+}
+
+
+// Elements of a vector, linked or not, with the tree and a multiset of
+// their keys kept in step.
+struct Fixture {
+    explicit Fixture(std::size_t count) :
+        elems(count),
+        linked(count)
+    {
+        for (std::size_t i = 0; i != count; ++i) {
+            elems[i].index = i;
+        }
+    }
+
+    void Link(Elem& elem)
+    {
+        expected.insert(elem.key);
+        linked[elem.index] = true;
+    }
+
+    // Forgets [b, e) of tree, before they are unlinked.
+    void Unlink(Tree::Iterator b, Tree::Iterator e)
+    {
+        for (; b != e; ++b) {
+            expected.erase(expected.find(b->key));
+            linked[b->index] = false;
+        }
+    }
+
+    std::vector<Elem> elems;
+    std::vector<bool> linked;
+    Tree tree;
+    Expected expected;
+};
+
+void CheckLookups(Tree& tree, const Expected& expected, int key)
+{
+    auto lower = tree.LowerBound(key);
+    auto expectedLower = expected.lower_bound(key);
+    auto rank = std::size_t(std::distance(expected.begin(), expectedLower));
+    Check(tree.Rank(key) == rank && tree.IndexOf(lower) == rank);
+    Check(lower == tree.Select(rank));
+    Check(tree.UpperBound(key) == tree.Select(
+        std::size_t(std::distance(expected.begin(), expected.upper_bound(key)))
+    ));
+    auto found = tree.Find(key);
+    Check((found != tree.End()) == (expected.count(key) != 0));
+    Check(found == tree.End() || found->key == key);
+    for (int width : { 0, 1, 7 }) {
+        auto count = std::size_t(std::distance(
+            expectedLower, expected.lower_bound(key + width)
+        ));
+        Check(tree.CountRange(key, key + width) == count);
+    }
+    Check(tree.CountRange(key + 1, key) == 0);
+}
+
+// The batch searches give what the single ones do, for groups longer and
+// shorter than a batch.
+void CheckBatches(Tree& tree, std::mt19937& random, int keyCount)
+{
+    std::vector<int> keys(random() % 40);
+    for (auto& key : keys) {
+        key = int(random() % unsigned(keyCount + 2)) - 1;
+    }
+    std::vector<Tree::Iterator> found(keys.size());
+    std::vector<Tree::Iterator> lower(keys.size());
+    tree.FindBatch(keys.data(), keys.size(), found.data());
+    tree.LowerBoundBatch(keys.data(), keys.size(), lower.data());
+    for (std::size_t i = 0; i != keys.size(); ++i) {
+        auto single = tree.Find(keys[i]);
+        Check((found[i] == tree.End()) == (single == tree.End()));
+        Check(found[i] == tree.End() || found[i]->key == keys[i]);
+        Check(lower[i] == tree.LowerBound(keys[i]));
+    }
+}
+
+// Random modifications against a multiset of keys, a small key range keeps
+// runs of equal keys. Erasures rebalance on the way up, Split and Join
+// cut the tree and glue it back at random keys.
+void TestRandom(unsigned seed, std::size_t elemCount, int keyCount)
+{
+    std::mt19937 random(seed);
+    Fixture fixture(elemCount);
+    auto& [elems, linked, tree, expected] = fixture;
+    auto randomKey = [&] { return int(random() % unsigned(keyCount)); };
+    for (int step = 0; step != 10000; ++step) {
+        auto& elem = elems[random() % elems.size()];
+        auto key = randomKey();
+        switch (random() % 10) {
+        case 0: case 1: case 2:
+            if (!linked[elem.index]) {
+                elem.key = key;
+                if (step % 2 == 0) {
+                    tree.Insert(elem);
+                } else {
+                    tree.Insert(tree.LowerBound(randomKey()), elem);
+                }
+                fixture.Link(elem);
+            }
+            break;
+        case 3:
+            if (linked[elem.index]) {
+                auto it = tree.IteratorTo(elem);
+                auto next = it;
+                fixture.Unlink(it, ++next);
+                Check(tree.Erase(it) == next);
+            }
+            break;
+        case 4: {
+            auto count = expected.count(key);
+            fixture.Unlink(tree.LowerBound(key), tree.UpperBound(key));
+            Check(tree.Erase(key) == count);
+            break;
+        }
+        case 5: {
+            auto b = tree.LowerBound(key);
+            auto e = tree.LowerBound(key + int(random() % 8));
+            fixture.Unlink(b, e);
+            Check(tree.Erase(b, e) == e);
+            break;
+        }
+        case 6: {
+            Tree tail;
+            tree.Split(key, tail);
+            Expected expectedTail(expected.lower_bound(key), expected.end());
+            Expected expectedHead(expected.begin(), expected.lower_bound(key));
+            CheckTree(tree, expectedHead);
+            CheckTree(tail, expectedTail);
+            if (!linked[elem.index] && (tree.Empty() || (--tree.End())->key <= key)
+                && (tail.Empty() || key <= tail.Begin()->key)
+            ) {
+                elem.key = key;
+                tree.Join(elem, tail);
+                fixture.Link(elem);
+            } else {
+                tree.Join(tail);
+            }
+            Check(tail.Empty());
+            break;
+        }
+        case 7:
+            CheckBatches(tree, random, keyCount);
+            break;
+        default:
+            for (int probe = -1; probe <= keyCount; probe += 1 + keyCount / 8) {
+                CheckLookups(tree, expected, probe);
+            }
+            Check(tree.Select(expected.size()) == tree.End());
+        }
+        CheckTree(tree, expected);
+    }
+}
+
+// Two trees of unique keys combined by every set operation, sequentially
+// and on a pool. The result keeps the elements of the tree it is left in,
+// the other tree is left empty.
+void TestSetOperations(unsigned seed, std::size_t size, ThreadPool& pool)
+{
+    enum class Operation { Union, Intersection, Difference };
+    std::mt19937 random(seed);
+    for (auto operation : { Operation::Union, Operation::Intersection, Operation::Difference }) {
+        for (bool parallel : { false, true }) {
+            std::vector<Elem> elems(size * 2);
+            std::set<int> keys[2];
+            Tree trees[2];
+            for (std::size_t i = 0; i != elems.size(); ++i) {
+                auto side = i % 2;
+                auto key = int(random() % (size * 3));
+                if (keys[side].insert(key).second) {
+                    elems[i].key = key;
+                    elems[i].index = side;
+                    trees[side].Insert(elems[i]);
+                }
+            }
+            std::vector<int> result;
+            auto out = std::back_inserter(result);
+            auto& [a, b] = keys;
+            switch (operation) {
+            case Operation::Union:
+                std::set_union(a.begin(), a.end(), b.begin(), b.end(), out);
+                parallel ? trees[0].Union(trees[1], pool) : trees[0].Union(trees[1]);
+                break;
+            case Operation::Intersection:
+                std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), out);
+                parallel ? trees[0].Intersection(trees[1], pool) : trees[0].Intersection(trees[1]);
+                break;
+            case Operation::Difference:
+                std::set_difference(a.begin(), a.end(), b.begin(), b.end(), out);
+                parallel ? trees[0].Difference(trees[1], pool) : trees[0].Difference(trees[1]);
+            }
+            CheckTree(trees[0], Expected(result.begin(), result.end()));
+            CheckTree(trees[1], {});
+            for (auto& elem : trees[0]) {
+                Check(elem.index == 0 || a.count(elem.key) == 0);
+            }
+        }
+    }
+}
+
+// ParallelForEach visits every element once, ParallelReduce of an
+// associative but not commutative operation gives them in order.
+void TestParallel(std::size_t size, ThreadPool& pool)
+{
+    std::vector<Elem> elems(size);
+    Tree tree;
+    std::vector<int> keys;
+    std::mt19937 random(1);
+    for (auto& elem : elems) {
+        elem.key = int(random() % 1000);
+        tree.Insert(elem);
+        keys.push_back(elem.key);
+    }
+    std::sort(keys.begin(), keys.end());
+    std::atomic<long> sum = 0;
+    std::atomic<std::size_t> count = 0;
+    tree.ParallelForEach([&](Elem& elem) {
+        sum += elem.key;
+        ++count;
+    }, pool);
+    Check(count == size);
+    long expectedSum = 0;
+    for (auto key : keys) {
+        expectedSum += key;
+    }
+    Check(sum == expectedSum);
+    auto concat = [](std::vector<int> a, std::vector<int> b) {
+        a.insert(a.end(), b.begin(), b.end());
+        return a;
+    };
+    auto single = [](Elem& elem) { return std::vector<int>{ elem.key }; };
+    Check(tree.ParallelReduce(std::vector<int>(), concat, single, pool) == keys);
+    Check(tree.ParallelReduce(std::vector<int>(), concat, single) == keys);
+    Tree empty;
+    Check(empty.ParallelReduce(std::vector<int>{ 1 }, concat, single, pool) == std::vector<int>{ 1 });
+}
+
+struct Span : AVLTreeIntervalNode<int> {
+    std::size_t index;
+};
+
+struct SpanComp {
+    auto operator()(const Span& a, const Span& b) const
+    {
+        return a.begin <=> b.begin;
+    }
+};
+
+using SpanTree = AVLTree<Span, SpanComp, BaseClassCastPolicy<AVLTreeIntervalNode<int>, Span>>;
+
+// Interval queries against a scan of the tree in order, for random spans
+// inserted and erased.
+void TestInterval(unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::vector<Span> spans(200);
+    std::vector<bool> linked(spans.size());
+    SpanTree tree;
+    for (std::size_t i = 0; i != spans.size(); ++i) {
+        spans[i].index = i;
+    }
+    for (int step = 0; step != 20000; ++step) {
+        auto& span = spans[random() % spans.size()];
+        if (!linked[span.index]) {
+            span.begin = int(random() % 1000);
+            span.end = span.begin + 1 + int(random() % 100);
+            tree.Insert(span);
+        } else {
+            tree.Erase(span);
+        }
+        linked[span.index] = !linked[span.index];
+        CheckInvariants(tree);
+        auto lo = int(random() % 1100) - 50;
+        auto hi = lo + 1 + int(random() % 60);
+        std::vector<Span*> overlapping, containing;
+        for (auto& each : tree) {
+            if (each.begin < hi && lo < each.end) {
+                overlapping.push_back(&each);
+            }
+            if (each.begin <= lo && lo < each.end) {
+                containing.push_back(&each);
+            }
+        }
+        auto first = tree.FindOverlapping(lo, hi);
+        Check(overlapping.empty()
+            ? first == tree.End()
+            : first != tree.End() && &*first == overlapping.front());
+        std::vector<Span*> visited;
+        tree.ForEachOverlapping(lo, hi, [&](Span& each) { visited.push_back(&each); });
+        Check(visited == overlapping);
+        visited.clear();
+        tree.ForEachContaining(lo, [&](Span& each) { visited.push_back(&each); });
+        Check(visited == containing);
+    }
+}
+
+}
+
+int main(int, char*[])
+{
+    TestInsertRange(1);
+    TestInsertRange(2);
+    TestRandom(1, 200, 50);
+    TestRandom(2, 200, 5);
+    TestRandom(3, 400, 100000);
+    TestInterval(1);
+    ThreadPool pool(4);
+    TestSetOperations(1, 100, pool);
+    TestSetOperations(2, 20000, pool);
+    TestParallel(30000, pool);
+    return 0;
+}
@@ -0,0 +1,1322 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+#include "art_tree.hpp"
+#include "avl_tree.hpp"
+#include "bplus_tree.hpp"
+#include "bs_tree.hpp"
+#include "epoch_reclaimer.hpp"
+#include "frozen_index.hpp"
+#include "rb_tree.hpp"
+#include "skip_list.hpp"
+#include "timing_wheel.hpp"
+
+// Benchmark of the ordered containers against std::multiset. The trees keep
+// equivalent elements, so the standard multiset is the fair counterpart.
+// std::unordered_multiset is the hash baseline, operations that need order
+// are not run for it.
+//
+// usage: benchmark [--min-size N] [--max-size N] [--keys int|string|all]
+//                  [--json FILE] [--threads N] [--timers N]
+// Sizes go from min to max by factors of ten, 1000 to 1000000 by default.
+// --threads runs the concurrent sets instead, from 1 to N threads over
+// max size keys. --timers runs the timer queues with N timers. Numbers are
+// only meaningful for an optimized build.
+
+namespace {
+
+std::uint64_t comparisons = 0;
+std::size_t allocatedBytes = 0;
+volatile std::uint64_t sink;
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) noexcept
+    {}
+
+    T* allocate(std::size_t n)
+    {
+        allocatedBytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* ptr, std::size_t n) noexcept
+    {
+        allocatedBytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>&) const noexcept
+    {
+        return true;
+    }
+};
+
+struct CountingLess {
+    template <typename Key>
+    bool operator()(const Key& a, const Key& b) const
+    {
+        ++comparisons;
+        return a < b;
+    }
+};
+
+// Strings are short enough for the small string buffer, so every
+// container stores them inline and the memory figures stay comparable.
+template <typename Key>
+auto MakeKey(std::uint64_t value) -> Key
+{
+    if constexpr (std::is_same_v<Key, std::string>) {
+        char buffer[16];
+        std::snprintf(buffer, sizeof(buffer), "k%011llu", (unsigned long long)value);
+        return buffer;
+    } else {
+        return value;
+    }
+}
+
+auto Touch(std::uint64_t key) -> std::uint64_t
+{
+    return key;
+}
+
+auto Touch(const std::string& key) -> std::uint64_t
+{
+    return key.back();
+}
+
+struct AVLTreeKind {
+    static constexpr const char* name = "AVLTree";
+    using Node = container_test::intrusive::AVLTreeNode<>;
+    template <typename T, typename Comp>
+    using Tree = container_test::intrusive::AVLTree<T, Comp>;
+};
+
+struct RBTreeKind {
+    static constexpr const char* name = "RBTree";
+    using Node = container_test::intrusive::RBTreeNode<>;
+    template <typename T, typename Comp>
+    using Tree = container_test::intrusive::RBTree<T, Comp>;
+};
+
+template <typename Key, typename Kind>
+class TreeBench {
+    struct Elem : Kind::Node {
+        explicit Elem(const Key& key) :
+            key(key)
+        {}
+
+        Key key;
+    };
+
+    struct Comp {
+        bool operator()(const Elem& a, const Elem& b) const
+        {
+            return CountingLess()(a.key, b.key);
+        }
+        bool operator()(const Key& a, const Elem& b) const
+        {
+            return CountingLess()(a, b.key);
+        }
+        bool operator()(const Elem& a, const Key& b) const
+        {
+            return CountingLess()(a.key, b);
+        }
+    };
+public:
+    static constexpr const char* name = Kind::name;
+
+    // Element storage is allocated up front, as intrusive containers are
+    // used.
+    explicit TreeBench(std::size_t capacity)
+    {
+        elems.reserve(capacity);
+    }
+
+    void Insert(const Key& key)
+    {
+        tree.Insert(elems.emplace_back(key));
+    }
+
+    bool Find(const Key& key)
+    {
+        return tree.Find(key) != tree.End();
+    }
+
+    auto Scan(const Key& key, std::size_t length) -> std::uint64_t
+    {
+        std::uint64_t sum = 0;
+        auto it = tree.LowerBound(key);
+        for (std::size_t i = 0; i != length && it != tree.End(); ++i, ++it) {
+            sum += Touch(it->key);
+        }
+        return sum;
+    }
+
+    auto Iterate() -> std::uint64_t
+    {
+        std::uint64_t sum = 0;
+        for (auto& elem : tree) {
+            sum += Touch(elem.key);
+        }
+        return sum;
+    }
+
+    auto Erase(const Key& key) -> std::size_t
+    {
+        return tree.Erase(key);
+    }
+
+    auto EraseRange(const Key& key, std::size_t length) -> std::size_t
+    {
+        auto first = tree.LowerBound(key);
+        auto last = first;
+        std::size_t count = 0;
+        for (; count != length && last != tree.End(); ++count) {
+            ++last;
+        }
+        tree.Erase(first, last);
+        return count;
+    }
+
+    // The element of erased is reused for inserted.
+    void Churn(const Key& erased, const Key& inserted)
+    {
+        auto it = tree.Find(erased);
+        auto& elem = *it;
+        tree.Erase(it);
+        elem.key = inserted;
+        tree.Insert(elem);
+    }
+private:
+    std::vector<Elem, CountingAllocator<Elem>> elems;
+    typename Kind::template Tree<Elem, Comp> tree;
+};
+
+// BSTree is a splay tree, its lookups restructure the tree and return
+// element pointers instead of iterators.
+template <typename Key>
+class SplayTreeBench {
+    struct Elem : container_test::intrusive::BSTreeNode<> {
+        explicit Elem(const Key& key) :
+            key(key)
+        {}
+
+        Key key;
+    };
+
+    struct Comp {
+        bool operator()(const Elem& a, const Elem& b) const
+        {
+            return CountingLess()(a.key, b.key);
+        }
+        bool operator()(const Key& a, const Elem& b) const
+        {
+            return CountingLess()(a, b.key);
+        }
+        bool operator()(const Elem& a, const Key& b) const
+        {
+            return CountingLess()(a.key, b);
+        }
+    };
+
+    using Tree = container_test::intrusive::BSTree<Elem, Comp>;
+public:
+    static constexpr const char* name = "BSTree (splay)";
+
+    explicit SplayTreeBench(std::size_t capacity)
+    {
+        elems.reserve(capacity);
+    }
+
+    void Insert(const Key& key)
+    {
+        tree.Insert(&elems.emplace_back(key));
+    }
+
+    bool Find(const Key& key)
+    {
+        return tree.Find(key) != nullptr;
+    }
+
+    auto Scan(const Key& key, std::size_t length) -> std::uint64_t
+    {
+        std::uint64_t sum = 0;
+        auto it = Bound(key);
+        for (std::size_t i = 0; i != length && it != tree.End(); ++i, ++it) {
+            sum += Touch(it->key);
+        }
+        return sum;
+    }
+
+    auto Iterate() -> std::uint64_t
+    {
+        std::uint64_t sum = 0;
+        for (auto& elem : tree) {
+            sum += Touch(elem.key);
+        }
+        return sum;
+    }
+
+    auto Erase(const Key& key) -> std::size_t
+    {
+        return tree.Erase(key);
+    }
+
+    auto EraseRange(const Key& key, std::size_t length) -> std::size_t
+    {
+        auto it = Bound(key);
+        std::size_t count = 0;
+        for (; count != length && it != tree.End(); ++count) {
+            it = tree.Erase(it);
+        }
+        return count;
+    }
+
+    void Churn(const Key& erased, const Key& inserted)
+    {
+        auto elem = tree.Extract(erased);
+        elem->key = inserted;
+        tree.Insert(elem);
+    }
+private:
+    auto Bound(const Key& key) -> typename Tree::Iterator
+    {
+        auto elem = tree.LowerBound(key);
+        return elem != nullptr ? tree.IteratorTo(*elem) : tree.End();
+    }
+
+    std::vector<Elem, CountingAllocator<Elem>> elems;
+    Tree tree;
+};
+
+// Integer keys are compared by std::less, as the vector search in the
+// nodes requires, so their comparisons are not counted.
+template <typename Key>
+class BPlusTreeBench {
+    struct Empty {};
+
+    using Less = std::conditional_t<
+        std::is_integral_v<Key>, std::less<Key>, CountingLess
+    >;
+    using Tree = container_test::BPlusTree<
+        Key, Empty, Less, 256, CountingAllocator<Empty>
+    >;
+public:
+    static constexpr const char* name = "BPlusTree";
+
+    explicit BPlusTreeBench(std::size_t)
+    {}
+
+    void Insert(const Key& key)
+    {
+        tree.Insert(key, {});
+    }
+
+    bool Find(const Key& key)
+    {
+        return tree.Find(key) != tree.End();
+    }
+
+    auto Scan(const Key& key, std::size_t length) -> std::uint64_t
+    {
+        std::uint64_t sum = 0;
+        auto it = tree.LowerBound(key);
+        for (std::size_t i = 0; i != length && it != tree.End(); ++i, ++it) {
+            sum += Touch(it->key);
+        }
+        return sum;
+    }
+
+    auto Iterate() -> std::uint64_t
+    {
+        std::uint64_t sum = 0;
+        for (auto [key, value] : tree) {
+            sum += Touch(key);
+        }
+        return sum;
+    }
+
+    auto Erase(const Key& key) -> std::size_t
+    {
+        return tree.Erase(key);
+    }
+
+    auto EraseRange(const Key& key, std::size_t length) -> std::size_t
+    {
+        auto it = tree.LowerBound(key);
+        std::size_t count = 0;
+        for (; count != length && it != tree.End(); ++count) {
+            it = tree.Erase(it);
+        }
+        return count;
+    }
+
+    void Churn(const Key& erased, const Key& inserted)
+    {
+        tree.Erase(tree.Find(erased));
+        tree.Insert(inserted, {});
+    }
+private:
+    Tree tree;
+};
+
+// ArtTree keeps unique keys, duplicate inserts of the zipf workload leave
+// the element in place. It compares bytes of keys, not keys.
+template <typename Key>
+class ArtBench {
+    struct Empty {};
+
+    using Tree = container_test::ArtTree<
+        Key, Empty, container_test::ArtKeyTraits<Key>, CountingAllocator<Empty>
+    >;
+public:
+    static constexpr const char* name = "ArtTree";
+
+    explicit ArtBench(std::size_t)
+    {}
+
+    void Insert(const Key& key)
+    {
+        tree.Insert(key, {});
+    }
+
+    bool Find(const Key& key)
+    {
+        return tree.Find(key) != tree.End();
+    }
+
+    auto Scan(const Key& key, std::size_t length) -> std::uint64_t
+    {
+        std::uint64_t sum = 0;
+        auto it = tree.LowerBound(key);
+        for (std::size_t i = 0; i != length && it != tree.End(); ++i, ++it) {
+            sum += Touch(it->key);
+        }
+        return sum;
+    }
+
+    auto Iterate() -> std::uint64_t
+    {
+        std::uint64_t sum = 0;
+        for (auto& [key, value] : tree) {
+            sum += Touch(key);
+        }
+        return sum;
+    }
+
+    auto Erase(const Key& key) -> std::size_t
+    {
+        return tree.Erase(key);
+    }
+
+    auto EraseRange(const Key& key, std::size_t length) -> std::size_t
+    {
+        auto it = tree.LowerBound(key);
+        std::size_t count = 0;
+        for (; count != length && it != tree.End(); ++count) {
+            it = tree.Erase(it);
+        }
+        return count;
+    }
+
+    void Churn(const Key& erased, const Key& inserted)
+    {
+        tree.Erase(tree.Find(erased));
+        tree.Insert(inserted, {});
+    }
+private:
+    Tree tree;
+};
+
+template <typename Key>
+class MultisetBench {
+public:
+    static constexpr const char* name = "std::multiset";
+
+    explicit MultisetBench(std::size_t)
+    {}
+
+    void Insert(const Key& key)
+    {
+        set.insert(key);
+    }
+
+    bool Find(const Key& key)
+    {
+        return set.find(key) != set.end();
+    }
+
+    auto Scan(const Key& key, std::size_t length) -> std::uint64_t
+    {
+        std::uint64_t sum = 0;
+        auto it = set.lower_bound(key);
+        for (std::size_t i = 0; i != length && it != set.end(); ++i, ++it) {
+            sum += Touch(*it);
+        }
+        return sum;
+    }
+
+    auto Iterate() -> std::uint64_t
+    {
+        std::uint64_t sum = 0;
+        for (auto& key : set) {
+            sum += Touch(key);
+        }
+        return sum;
+    }
+
+    auto Erase(const Key& key) -> std::size_t
+    {
+        return set.erase(key);
+    }
+
+    auto EraseRange(const Key& key, std::size_t length) -> std::size_t
+    {
+        auto first = set.lower_bound(key);
+        auto last = first;
+        std::size_t count = 0;
+        for (; count != length && last != set.end(); ++count) {
+            ++last;
+        }
+        set.erase(first, last);
+        return count;
+    }
+
+    void Churn(const Key& erased, const Key& inserted)
+    {
+        set.erase(set.find(erased));
+        set.insert(inserted);
+    }
+private:
+    std::multiset<Key, CountingLess, CountingAllocator<Key>> set;
+};
+
+// The in-tree HashTable has a fixed capacity, so the standard one is used.
+template <typename Key>
+class HashBench {
+public:
+    static constexpr const char* name = "unordered_mset";
+
+    explicit HashBench(std::size_t capacity)
+    {
+        set.reserve(capacity);
+    }
+
+    void Insert(const Key& key)
+    {
+        set.insert(key);
+    }
+
+    bool Find(const Key& key)
+    {
+        return set.find(key) != set.end();
+    }
+
+    auto Iterate() -> std::uint64_t
+    {
+        std::uint64_t sum = 0;
+        for (auto& key : set) {
+            sum += Touch(key);
+        }
+        return sum;
+    }
+
+    auto Erase(const Key& key) -> std::size_t
+    {
+        return set.erase(key);
+    }
+
+    void Churn(const Key& erased, const Key& inserted)
+    {
+        set.erase(set.find(erased));
+        set.insert(inserted);
+    }
+private:
+    std::unordered_multiset<
+        Key, std::hash<Key>, std::equal_to<Key>, CountingAllocator<Key>
+    > set;
+};
+
+// Concurrent sets of integer keys for --threads. Elements are allocated on
+// insertion and freed once erased, by either of them.
+class LockedTreeBench {
+    struct Elem : container_test::intrusive::AVLTreeNode<> {
+        explicit Elem(std::uint64_t key) :
+            key(key)
+        {}
+
+        std::uint64_t key;
+    };
+
+    struct Comp {
+        bool operator()(const Elem& a, const Elem& b) const
+        {
+            return a.key < b.key;
+        }
+        bool operator()(std::uint64_t a, const Elem& b) const
+        {
+            return a < b.key;
+        }
+        bool operator()(const Elem& a, std::uint64_t b) const
+        {
+            return a.key < b;
+        }
+    };
+public:
+    static constexpr const char* name = "AVLTree+mutex";
+
+    ~LockedTreeBench()
+    {
+        while (!tree.Empty()) {
+            auto& elem = *tree.Begin();
+            tree.Erase(tree.Begin());
+            delete &elem;
+        }
+    }
+
+    void Insert(std::uint64_t key)
+    {
+        auto elem = new Elem(key);
+        {
+            std::lock_guard lock(mutex);
+            if (tree.Find(key) == tree.End()) {
+                tree.Insert(*elem);
+                return;
+            }
+        }
+        delete elem;
+    }
+
+    void Erase(std::uint64_t key)
+    {
+        Elem* elem = nullptr;
+        {
+            std::lock_guard lock(mutex);
+            auto it = tree.Find(key);
+            if (it == tree.End()) {
+                return;
+            }
+            elem = &*it;
+            tree.Erase(it);
+        }
+        delete elem;
+    }
+
+    bool Find(std::uint64_t key)
+    {
+        std::lock_guard lock(mutex);
+        return tree.Find(key) != tree.End();
+    }
+private:
+    std::mutex mutex;
+    container_test::intrusive::AVLTree<Elem, Comp> tree;
+};
+
+class SkipListBench {
+    struct Elem : container_test::intrusive::SkipListNode<> {
+        explicit Elem(std::uint64_t key) :
+            key(key)
+        {}
+
+        std::uint64_t key;
+    };
+
+    struct Comp {
+        bool operator()(const Elem& a, const Elem& b) const
+        {
+            return a.key < b.key;
+        }
+        bool operator()(std::uint64_t a, const Elem& b) const
+        {
+            return a < b.key;
+        }
+        bool operator()(const Elem& a, std::uint64_t b) const
+        {
+            return a.key < b;
+        }
+    };
+
+    struct Reclaim {
+        void operator()(Elem& elem) const
+        {
+            delete &elem;
+        }
+    };
+
+    using Reclaimer = container_test::EpochReclaimer<Elem, Reclaim>;
+public:
+    static constexpr const char* name = "SkipList";
+
+    SkipListBench() :
+        list(reclaimer)
+    {}
+
+    ~SkipListBench()
+    {
+        std::vector<Elem*> elems;
+        for (auto& elem : list) {
+            elems.push_back(&elem);
+        }
+        for (auto elem : elems) {
+            delete elem;
+        }
+    }
+
+    void Insert(std::uint64_t key)
+    {
+        auto elem = new Elem(key);
+        if (!list.Insert(*elem)) {
+            delete elem;
+        }
+    }
+
+    void Erase(std::uint64_t key)
+    {
+        list.Erase(key);
+    }
+
+    bool Find(std::uint64_t key)
+    {
+        return list.Contains(key);
+    }
+private:
+    Reclaimer reclaimer;
+    container_test::intrusive::SkipList<Elem, Comp, Reclaimer> list;
+};
+
+// Timer queues for --timers, timers are numbered and preallocated.
+class TimingWheelBench {
+    struct Timer : container_test::intrusive::TimingWheelNode<> {};
+public:
+    static constexpr const char* name = "TimingWheel";
+
+    explicit TimingWheelBench(std::size_t count) :
+        timers(count)
+    {}
+
+    void Arm(std::size_t timer, std::uint64_t due)
+    {
+        wheel.Arm(timers[timer], due);
+    }
+
+    void Cancel(std::size_t timer)
+    {
+        wheel.Cancel(timers[timer]);
+    }
+
+    auto Expire(std::uint64_t until) -> std::size_t
+    {
+        std::size_t count = 0;
+        wheel.Advance(until, [&](Timer&) { ++count; });
+        return count;
+    }
+private:
+    std::vector<Timer> timers;
+    container_test::intrusive::TimingWheel<Timer> wheel;
+};
+
+class TreeTimerBench {
+    struct Timer : container_test::intrusive::AVLTreeNode<> {
+        std::uint64_t due;
+    };
+
+    struct Comp {
+        bool operator()(const Timer& a, const Timer& b) const
+        {
+            return a.due < b.due;
+        }
+    };
+public:
+    static constexpr const char* name = "AVLTree";
+
+    explicit TreeTimerBench(std::size_t count) :
+        timers(count)
+    {}
+
+    void Arm(std::size_t timer, std::uint64_t due)
+    {
+        timers[timer].due = due;
+        tree.Insert(timers[timer]);
+    }
+
+    void Cancel(std::size_t timer)
+    {
+        tree.Erase(tree.IteratorTo(timers[timer]));
+    }
+
+    auto Expire(std::uint64_t until) -> std::size_t
+    {
+        std::size_t count = 0;
+        while (!tree.Empty() && tree.Begin()->due <= until) {
+            tree.Erase(tree.Begin());
+            ++count;
+        }
+        return count;
+    }
+private:
+    std::vector<Timer> timers;
+    container_test::intrusive::AVLTree<Timer, Comp> tree;
+};
+
+enum Operation {
+    InsertRandom,
+    InsertSequential,
+    InsertZipf,
+    Find,
+    FindZipf,
+    LowerBoundScan,
+    Iterate,
+    Erase,
+    Churn,
+    EraseRange,
+    OperationCount
+};
+
+const char* const operationNames[] = {
+    "insert_random",
+    "insert_sequential",
+    "insert_zipf",
+    "find",
+    "find_zipf",
+    "lower_bound_scan",
+    "iterate",
+    "erase",
+    "churn",
+    "range_erase",
+};
+
+constexpr std::size_t ScanLength = 16;
+constexpr std::size_t RangeLength = 64;
+
+// Keys are even numbers, odd ones are used for missing keys.
+template <typename Key>
+struct Workload {
+    std::vector<Key> random;
+    std::vector<Key> sequential;
+    std::vector<Key> zipf;
+    std::vector<Key> lookups;
+    std::vector<Key> misses;
+};
+
+// Continuous approximation of the inverse Zipf distribution, ranks are
+// scattered over the key space so that hot keys are not neighbours.
+class ZipfGenerator {
+public:
+    ZipfGenerator(std::size_t n, double skew) :
+        n(n),
+        exponent(1 - skew),
+        scale(std::pow(double(n), exponent) - 1)
+    {}
+
+    template <typename Random>
+    auto operator()(Random& random) -> std::uint64_t
+    {
+        double u = std::uniform_real_distribution<double>()(random);
+        auto rank = std::uint64_t(std::pow(scale * u + 1, 1 / exponent)) - 1;
+        rank = std::min<std::uint64_t>(rank, n - 1);
+        return Scatter(rank) % n;
+    }
+private:
+    static auto Scatter(std::uint64_t x) -> std::uint64_t
+    {
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+        return x ^ (x >> 31);
+    }
+
+    std::size_t n;
+    double exponent;
+    double scale;
+};
+
+template <typename Key>
+auto MakeWorkload(std::size_t n) -> Workload<Key>
+{
+    std::mt19937_64 random(n);
+    std::vector<std::uint64_t> values(n);
+    for (std::size_t i = 0; i != n; ++i) {
+        values[i] = 2 * i;
+    }
+    Workload<Key> workload;
+    auto fill = [&](std::vector<Key>& keys, auto value) {
+        keys.reserve(n);
+        for (std::size_t i = 0; i != n; ++i) {
+            keys.push_back(MakeKey<Key>(value(i)));
+        }
+    };
+    fill(workload.sequential, [&](std::size_t i) { return values[i]; });
+    std::shuffle(values.begin(), values.end(), random);
+    fill(workload.random, [&](std::size_t i) { return values[i]; });
+    std::shuffle(values.begin(), values.end(), random);
+    fill(workload.lookups, [&](std::size_t i) { return values[i]; });
+    fill(workload.misses, [&](std::size_t i) { return values[i] + 1; });
+    ZipfGenerator zipf(n, 0.99);
+    fill(workload.zipf, [&](std::size_t) { return 2 * zipf(random); });
+    return workload;
+}
+
+struct Stat {
+    double nanoseconds = 0;
+    std::uint64_t comparisons = 0;
+    std::uint64_t operations = 0;
+    std::size_t bytes = 0;
+    std::size_t elements = 0;
+};
+
+struct Result {
+    const char* container;
+    const char* key;
+    const char* operation;
+    std::size_t size;
+    double nsPerOp;
+    double bytesPerElement;
+    double comparisonsPerOp;
+};
+
+void Report(std::vector<Result>& results, const Result& result)
+{
+    results.push_back(result);
+    std::printf(
+        "%-16s %-7s %-18s %10zu %10.1f %8.1f %8.1f\n",
+        result.container, result.key, result.operation, result.size,
+        result.nsPerOp, result.bytesPerElement, result.comparisonsPerOp
+    );
+}
+
+// f returns the number of operations done.
+template <typename F>
+void Measure(Stat& stat, F&& f)
+{
+    auto startComparisons = comparisons;
+    auto start = std::chrono::steady_clock::now();
+    auto operations = f();
+    auto finish = std::chrono::steady_clock::now();
+    stat.nanoseconds += std::chrono::duration<double, std::nano>(finish - start).count();
+    stat.comparisons += comparisons - startComparisons;
+    stat.operations += operations;
+}
+
+template <typename Bench, typename Key>
+auto Build(Stat& stat, const std::vector<Key>& keys) -> std::unique_ptr<Bench>
+{
+    auto startBytes = allocatedBytes;
+    auto bench = std::make_unique<Bench>(keys.size());
+    Measure(stat, [&] {
+        for (auto& key : keys) {
+            bench->Insert(key);
+        }
+        return keys.size();
+    });
+    stat.bytes += allocatedBytes - startBytes;
+    stat.elements += keys.size();
+    return bench;
+}
+
+template <typename Bench, typename Key>
+concept OrderedBench = requires (Bench& bench, const Key& key) {
+    bench.Scan(key, ScanLength);
+    bench.EraseRange(key, RangeLength);
+};
+
+template <typename Bench, typename Key>
+void RunContainer(
+    const Workload<Key>& workload, const char* keyName,
+    std::vector<Result>& results
+) {
+    auto n = workload.random.size();
+    auto repetitions = std::max<std::size_t>(1, (std::size_t(1) << 20) / n);
+    Stat stats[OperationCount];
+    for (std::size_t rep = 0; rep != repetitions; ++rep) {
+        Build<Bench>(stats[InsertSequential], workload.sequential);
+        Build<Bench>(stats[InsertZipf], workload.zipf);
+        auto bench = Build<Bench>(stats[InsertRandom], workload.random);
+        std::uint64_t sum = 0;
+        Measure(stats[Find], [&] {
+            for (auto& key : workload.lookups) {
+                sum += bench->Find(key);
+            }
+            return n;
+        });
+        // Skewed lookups, where self-adjusting trees are expected to win.
+        Measure(stats[FindZipf], [&] {
+            for (auto& key : workload.zipf) {
+                sum += bench->Find(key);
+            }
+            return n;
+        });
+        if constexpr (OrderedBench<Bench, Key>) {
+            Measure(stats[LowerBoundScan], [&] {
+                for (auto& key : workload.misses) {
+                    sum += bench->Scan(key, ScanLength);
+                }
+                return n;
+            });
+        }
+        Measure(stats[Iterate], [&] {
+            sum += bench->Iterate();
+            return n;
+        });
+        Measure(stats[Erase], [&] {
+            for (auto& key : workload.lookups) {
+                sum += bench->Erase(key);
+            }
+            return n;
+        });
+        bench.reset();
+        Stat unused;
+        bench = Build<Bench>(unused, workload.random);
+        // Steady state mix, every key is erased and a new one inserted.
+        Measure(stats[Churn], [&] {
+            for (std::size_t i = 0; i != n; ++i) {
+                bench->Churn(workload.lookups[i], workload.misses[n - 1 - i]);
+            }
+            return n;
+        });
+        if constexpr (OrderedBench<Bench, Key>) {
+            Measure(stats[EraseRange], [&] {
+                std::size_t count = n / RangeLength;
+                for (std::size_t i = 0; i != count; ++i) {
+                    sum += bench->EraseRange(workload.misses[i], RangeLength);
+                }
+                return count;
+            });
+        }
+        sink = sum;
+    }
+    auto& built = stats[InsertRandom];
+    for (int op = 0; op != OperationCount; ++op) {
+        auto& stat = stats[op];
+        if (stat.operations == 0) {
+            continue;
+        }
+        auto& memory = stat.elements != 0 ? stat : built;
+        auto operations = double(std::max<std::uint64_t>(1, stat.operations));
+        Report(results, {
+            Bench::name,
+            keyName,
+            operationNames[op],
+            n,
+            stat.nanoseconds / operations,
+            double(memory.bytes) / double(memory.elements),
+            double(stat.comparisons) / operations
+        });
+    }
+}
+
+// FrozenIndex is read only, it is built once over the sorted keys and only
+// lookups are measured. Its memory is the key copy and the element pointer.
+template <typename Key>
+void RunFrozen(
+    const Workload<Key>& workload, const char* keyName,
+    std::vector<Result>& results
+) {
+    struct Elem {
+        Key key;
+    };
+    struct KeyOf {
+        auto operator()(const Elem& elem) const -> const Key&
+        {
+            return elem.key;
+        }
+    };
+    auto n = workload.sequential.size();
+    std::vector<Elem> elems;
+    elems.reserve(n);
+    for (auto& key : workload.sequential) {
+        elems.push_back({ key });
+    }
+    container_test::FrozenIndex<Elem, Key, KeyOf, CountingLess> index(elems);
+    auto repetitions = std::max<std::size_t>(1, (std::size_t(1) << 20) / n);
+    Stat stats[2];
+    std::uint64_t sum = 0;
+    for (std::size_t rep = 0; rep != repetitions; ++rep) {
+        Measure(stats[0], [&] {
+            for (auto& key : workload.lookups) {
+                sum += index.Find(key) != nullptr;
+            }
+            return n;
+        });
+        Measure(stats[1], [&] {
+            for (auto& key : workload.zipf) {
+                sum += index.Find(key) != nullptr;
+            }
+            return n;
+        });
+    }
+    sink = sum;
+    const Operation operations[] = { Find, FindZipf };
+    for (int i = 0; i != 2; ++i) {
+        auto count = double(std::max<std::uint64_t>(1, stats[i].operations));
+        Report(results, {
+            "FrozenIndex",
+            keyName,
+            operationNames[operations[i]],
+            n,
+            stats[i].nanoseconds / count,
+            double(sizeof(Key) + sizeof(Elem*)),
+            double(stats[i].comparisons) / count
+        });
+    }
+}
+
+template <typename Key>
+void RunKey(
+    const char* keyName, std::size_t minSize, std::size_t maxSize,
+    std::vector<Result>& results
+) {
+    for (auto n = minSize; n <= maxSize; n *= 10) {
+        auto workload = MakeWorkload<Key>(n);
+        RunContainer<TreeBench<Key, AVLTreeKind>>(workload, keyName, results);
+        RunContainer<TreeBench<Key, RBTreeKind>>(workload, keyName, results);
+        RunContainer<SplayTreeBench<Key>>(workload, keyName, results);
+        RunContainer<BPlusTreeBench<Key>>(workload, keyName, results);
+        RunContainer<ArtBench<Key>>(workload, keyName, results);
+        RunContainer<MultisetBench<Key>>(workload, keyName, results);
+        RunContainer<HashBench<Key>>(workload, keyName, results);
+        RunFrozen<Key>(workload, keyName, results);
+    }
+}
+
+// Every thread runs the same number of operations, 80% lookups and 10% of
+// inserts and erasures each, over random keys of a set kept half full.
+template <typename Bench>
+void RunConcurrent(std::size_t size, std::size_t threadCount)
+{
+    constexpr std::size_t OperationsPerThread = std::size_t(1) << 20;
+    Bench bench;
+    for (std::size_t key = 0; key < size; key += 2) {
+        bench.Insert(key);
+    }
+    std::atomic<std::uint64_t> found = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t != threadCount; ++t) {
+        threads.emplace_back([&, t] {
+            std::mt19937_64 random(t + 1);
+            std::uint64_t sum = 0;
+            for (std::size_t i = 0; i != OperationsPerThread; ++i) {
+                auto value = random();
+                auto key = (value >> 8) % size;
+                auto operation = value % 10;
+                if (operation == 0) {
+                    bench.Insert(key);
+                } else if (operation == 1) {
+                    bench.Erase(key);
+                } else {
+                    sum += bench.Find(key);
+                }
+            }
+            found += sum;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto finish = std::chrono::steady_clock::now();
+    auto seconds = std::chrono::duration<double>(finish - start).count();
+    sink = found;
+    std::printf(
+        "%-16s %8zu %10zu %10.2f\n", Bench::name, threadCount, size,
+        double(OperationsPerThread * threadCount) / seconds / 1e6
+    );
+}
+
+void RunThreads(std::size_t size, std::size_t maxThreads)
+{
+    std::printf("%-16s %8s %10s %10s\n", "container", "threads", "size", "Mops/s");
+    for (std::size_t threads = 1;; threads = std::min(2 * threads, maxThreads)) {
+        RunConcurrent<LockedTreeBench>(size, threads);
+        RunConcurrent<SkipListBench>(size, threads);
+        if (threads == maxThreads) {
+            break;
+        }
+    }
+}
+
+// Every timer is armed with a random deadline within 2^24 ticks, every
+// other one is cancelled and the rest expire.
+template <typename Bench>
+void RunTimerQueue(std::size_t count)
+{
+    constexpr std::uint64_t Horizon = std::uint64_t(1) << 24;
+    std::mt19937_64 random(1);
+    std::vector<std::uint64_t> deadlines(count);
+    for (auto& deadline : deadlines) {
+        deadline = random() % Horizon;
+    }
+    Bench bench(count);
+    Stat arm, cancel, expire;
+    Measure(arm, [&] {
+        for (std::size_t i = 0; i != count; ++i) {
+            bench.Arm(i, deadlines[i]);
+        }
+        return count;
+    });
+    Measure(cancel, [&] {
+        for (std::size_t i = 0; i < count; i += 2) {
+            bench.Cancel(i);
+        }
+        return count / 2;
+    });
+    Measure(expire, [&] {
+        return bench.Expire(Horizon);
+    });
+    const std::pair<const char*, Stat*> rows[] = {
+        { "arm", &arm }, { "cancel", &cancel }, { "expire", &expire }
+    };
+    for (auto [operation, stat] : rows) {
+        std::printf(
+            "%-16s %-18s %10zu %10.1f\n", Bench::name, operation, count,
+            stat->nanoseconds / double(std::max<std::uint64_t>(1, stat->operations))
+        );
+    }
+}
+
+void RunTimers(std::size_t count)
+{
+    std::printf("%-16s %-18s %10s %10s\n", "container", "operation", "timers", "ns/op");
+    RunTimerQueue<TimingWheelBench>(count);
+    RunTimerQueue<TreeTimerBench>(count);
+}
+
+bool WriteJson(const char* path, const std::vector<Result>& results)
+{
+    std::ofstream out(path);
+    out << "[\n";
+    for (std::size_t i = 0; i != results.size(); ++i) {
+        auto& result = results[i];
+        out << "  {\"container\": \"" << result.container
+            << "\", \"key\": \"" << result.key
+            << "\", \"operation\": \"" << result.operation
+            << "\", \"size\": " << result.size
+            << ", \"ns_per_op\": " << result.nsPerOp
+            << ", \"bytes_per_element\": " << result.bytesPerElement
+            << ", \"comparisons_per_op\": " << result.comparisonsPerOp
+            << (i + 1 != results.size() ? "},\n" : "}\n");
+    }
+    out << "]\n";
+    return bool(out);
+}
+
+void PrintUsage(std::FILE* out)
+{
+    std::fprintf(
+        out,
+        "usage: benchmark [--min-size N] [--max-size N] [--keys int|string|all]\n"
+        "                 [--json FILE] [--threads N] [--timers N]\n"
+    );
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t minSize = 1000;
+    std::size_t maxSize = 1000000;
+    const char* keys = "all";
+    const char* jsonPath = nullptr;
+    std::size_t threads = 0;
+    std::size_t timers = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0) {
+            PrintUsage(stdout);
+            return EXIT_SUCCESS;
+        }
+        const char* options[] = {
+            "--min-size", "--max-size", "--keys", "--json", "--threads", "--timers"
+        };
+        auto known = std::find_if(std::begin(options), std::end(options), [&](const char* option) {
+            return std::strcmp(argv[i], option) == 0;
+        });
+        if (known == std::end(options)) {
+            std::fprintf(stderr, "unknown option %s\n", argv[i]);
+            PrintUsage(stderr);
+            return EXIT_FAILURE;
+        }
+        auto value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (value == nullptr) {
+            std::fprintf(stderr, "missing value of %s\n", argv[i]);
+            PrintUsage(stderr);
+            return EXIT_FAILURE;
+        }
+        if (std::strcmp(argv[i], "--min-size") == 0) {
+            minSize = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--max-size") == 0) {
+            maxSize = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--keys") == 0) {
+            keys = value;
+            if (std::strcmp(keys, "int") != 0 && std::strcmp(keys, "string") != 0
+                && std::strcmp(keys, "all") != 0) {
+                std::fprintf(stderr, "unknown keys %s\n", keys);
+                PrintUsage(stderr);
+                return EXIT_FAILURE;
+            }
+        } else if (std::strcmp(argv[i], "--json") == 0) {
+            jsonPath = value;
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            threads = std::strtoull(value, nullptr, 10);
+        } else {
+            timers = std::strtoull(value, nullptr, 10);
+        }
+        ++i;
+    }
+    if (minSize == 0) {
+        std::fprintf(stderr, "sizes have to be positive\n");
+        return EXIT_FAILURE;
+    }
+    if (threads != 0) {
+        RunThreads(maxSize, threads);
+        return EXIT_SUCCESS;
+    }
+    if (timers != 0) {
+        RunTimers(timers);
+        return EXIT_SUCCESS;
+    }
+    // Only the key runs go over the range of sizes.
+    if (minSize > maxSize) {
+        std::fprintf(stderr, "--min-size is greater than --max-size\n");
+        PrintUsage(stderr);
+        return EXIT_FAILURE;
+    }
+    std::printf(
+        "%-16s %-7s %-18s %10s %10s %8s %8s\n",
+        "container", "key", "operation", "size", "ns/op", "B/elem", "cmp/op"
+    );
+    std::vector<Result> results;
+    bool all = std::strcmp(keys, "all") == 0;
+    if (all || std::strcmp(keys, "int") == 0) {
+        RunKey<std::uint64_t>("int", minSize, maxSize, results);
+    }
+    if (all || std::strcmp(keys, "string") == 0) {
+        RunKey<std::string>("string", minSize, maxSize, results);
+    }
+    if (jsonPath != nullptr && !WriteJson(jsonPath, results)) {
+        std::fprintf(stderr, "cannot write %s\n", jsonPath);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
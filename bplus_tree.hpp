@@ -0,0 +1,958 @@
+#ifndef BPLUS_TREE_H
+#define BPLUS_TREE_H
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#define AddressOf (::std::addressof)
+
+namespace container_test {
+
+namespace bplus_tree_detail {
+
+// Keys searched with vector compares, their free slots are filled with
+// the maximum value so that whole nodes can be compared at once.
+template <typename K, typename Less>
+concept SimdKey =
+    std::integral<K> && !std::same_as<K, bool> &&
+    (sizeof(K) == 4 || sizeof(K) == 8) &&
+    (std::same_as<Less, std::less<K>> || std::same_as<Less, std::less<>>);
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+// Sum of the lanes of compare masks subtracted from zero.
+template <bool is64>
+auto SumLanes(__m128i sum) noexcept -> std::size_t
+{
+    if constexpr (!is64) {
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+    } else {
+        sum = _mm_add_epi64(sum, _mm_unpackhi_epi64(sum, sum));
+    }
+    return std::size_t(_mm_cvtsi128_si32(sum));
+}
+#endif
+
+// Number of the first slots keys that are less than key, or not greater
+// if upper. Slots is a multiple of the vector width.
+template <bool upper, std::size_t Slots, typename K>
+auto CountKeys(const K* keys, K key) noexcept -> std::size_t
+{
+    [[maybe_unused]] constexpr bool is64 = sizeof(K) == 8;
+    std::size_t count = 0;
+#if defined(__AVX2__)
+    constexpr std::size_t lanes = 32 / sizeof(K);
+    static_assert(Slots % lanes == 0);
+    auto flip = std::is_signed_v<K> ? _mm256_setzero_si256() :
+        is64 ? _mm256_set1_epi64x(INT64_MIN) : _mm256_set1_epi32(INT32_MIN);
+    auto k = is64 ? _mm256_set1_epi64x(std::int64_t(key)) :
+        _mm256_set1_epi32(std::int32_t(key));
+    k = _mm256_xor_si256(k, flip);
+    auto sum = _mm256_setzero_si256();
+    for (std::size_t i = 0; i != Slots; i += lanes) {
+        auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+        v = _mm256_xor_si256(v, flip);
+        auto a = upper ? v : k;
+        auto b = upper ? k : v;
+        sum = is64 ?
+            _mm256_sub_epi64(sum, _mm256_cmpgt_epi64(a, b)) :
+            _mm256_sub_epi32(sum, _mm256_cmpgt_epi32(a, b));
+    }
+    auto low = _mm256_castsi256_si128(sum);
+    auto high = _mm256_extracti128_si256(sum, 1);
+    count = SumLanes<is64>(
+        is64 ? _mm_add_epi64(low, high) : _mm_add_epi32(low, high)
+    );
+    return upper ? Slots - count : count;
+#elif defined(__SSE2__) || defined(_M_X64)
+    constexpr std::size_t lanes = 16 / sizeof(K);
+    static_assert(Slots % lanes == 0);
+    // 64 bit compares come with SSE4.2, emulating them loses to the scalar
+    // loop.
+#if !defined(__SSE4_2__)
+    if constexpr (!is64)
+#endif
+    {
+        auto flip = std::is_signed_v<K> ? _mm_setzero_si128() :
+            is64 ? _mm_set1_epi64x(INT64_MIN) : _mm_set1_epi32(INT32_MIN);
+        auto k = is64 ? _mm_set1_epi64x(std::int64_t(key)) :
+            _mm_set1_epi32(std::int32_t(key));
+        k = _mm_xor_si128(k, flip);
+        auto sum = _mm_setzero_si128();
+        for (std::size_t i = 0; i != Slots; i += lanes) {
+            auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+            v = _mm_xor_si128(v, flip);
+            auto a = upper ? v : k;
+            auto b = upper ? k : v;
+#if defined(__SSE4_2__)
+            if constexpr (is64) {
+                sum = _mm_sub_epi64(sum, _mm_cmpgt_epi64(a, b));
+                continue;
+            }
+#endif
+            sum = _mm_sub_epi32(sum, _mm_cmpgt_epi32(a, b));
+        }
+        count = SumLanes<is64>(sum);
+        return upper ? Slots - count : count;
+    }
+#endif
+#if !defined(__AVX2__)
+    // Branchless, compilers vectorize it when they are allowed to.
+    for (std::size_t i = 0; i != Slots; ++i) {
+        count += upper ? !(key < keys[i]) : keys[i] < key;
+    }
+    return count;
+#endif
+}
+
+}
+
+// B+tree ordered map. Elements are kept in arrays of about NodeSize bytes
+// in the leaves, which are linked for scans, the inner nodes hold only
+// separator keys. So a lookup costs a cache miss or two per level of a
+// tree that is a few levels high, and an element costs its key and value
+// plus a share of the node overhead. Integer keys compared by std::less
+// are searched within a node by vector compares of all its keys.
+// Like AVLTree it keeps equivalent keys, in the order of insertion.
+// Unlike it, any modification invalidates all the iterators.
+template <
+    typename K,
+    typename V,
+    typename Less = std::less<K>,
+    std::size_t NodeSize = 256,
+    typename Allocator = std::allocator<V>
+>
+requires std::default_initializable<K> && std::default_initializable<V>
+class BPlusTree {
+    static constexpr bool Simd = bplus_tree_detail::SimdKey<K, Less>;
+    static constexpr std::size_t Lanes = Simd ? 32 / sizeof(K) : 1;
+    static constexpr std::size_t CacheLine = 64;
+
+    static constexpr auto RoundUp(std::size_t n) -> std::size_t
+    {
+        return (n + Lanes - 1) / Lanes * Lanes;
+    }
+
+    // Largest capacity that keeps the node within NodeSize, given the
+    // size of every element and of the fixed part.
+    static constexpr auto Capacity(
+        std::size_t element, std::size_t fixed
+    ) -> std::size_t {
+        std::size_t capacity = 4;
+        while (
+            RoundUp(capacity + 1) * sizeof(K) +
+            (capacity + 1) * element + fixed <= NodeSize
+        ) {
+            ++capacity;
+        }
+        return capacity;
+    }
+
+    struct Node {
+        std::size_t count;
+    };
+public:
+    static constexpr std::size_t LeafCapacity =
+        Capacity(sizeof(V), sizeof(Node) + 2 * sizeof(void*));
+    static constexpr std::size_t InnerCapacity =
+        Capacity(sizeof(void*), sizeof(Node) + sizeof(void*));
+private:
+    static constexpr std::size_t LeafMin = LeafCapacity / 2;
+    static constexpr std::size_t InnerMin = InnerCapacity / 2;
+    // Enough for any size_t count of elements, a level multiplies it by
+    // at least three.
+    static constexpr std::size_t MaxHeight = 48;
+
+    struct alignas(CacheLine) Leaf : Node {
+        K keys[RoundUp(LeafCapacity)];
+        V values[LeafCapacity];
+        Leaf* prev;
+        Leaf* next;
+    };
+
+    struct alignas(CacheLine) Inner : Node {
+        K keys[RoundUp(InnerCapacity)];
+        Node* children[InnerCapacity + 1];
+    };
+
+    struct Step {
+        Inner* node;
+        std::size_t index;
+    };
+
+    using LeafAllocator =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<Leaf>;
+    using InnerAllocator =
+        typename std::allocator_traits<Allocator>::template rebind_alloc<Inner>;
+public:
+    template <typename VV>
+    class IteratorImpl {
+        friend class BPlusTree;
+        template <typename>
+        friend class IteratorImpl;
+        IteratorImpl(Leaf* leaf, std::size_t index) noexcept :
+            leaf(leaf),
+            index(index)
+        {}
+    public:
+        struct Reference {
+            const K& key;
+            VV& value;
+        };
+
+        struct Pointer {
+            auto operator->() noexcept -> Reference*
+            {
+                return AddressOf(reference);
+            }
+
+            Reference reference;
+        };
+
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = Reference;
+        using difference_type = std::ptrdiff_t;
+        using reference = Reference;
+        using pointer = Pointer;
+
+        IteratorImpl() noexcept :
+            leaf(nullptr),
+            index(0)
+        {}
+
+        template <typename U>
+        requires std::same_as<VV, const U>
+        IteratorImpl(const IteratorImpl<U>& oth) noexcept :
+            leaf(oth.leaf),
+            index(oth.index)
+        {}
+
+        auto operator++() noexcept -> IteratorImpl&
+        {
+            if (++index == leaf->count && leaf->next != nullptr) {
+                leaf = leaf->next;
+                index = 0;
+            }
+            return *this;
+        }
+
+        auto operator--() noexcept -> IteratorImpl&
+        {
+            if (index == 0) {
+                leaf = leaf->prev;
+                index = leaf->count;
+            }
+            --index;
+            return *this;
+        }
+
+        auto operator++(int) noexcept -> IteratorImpl
+        {
+            auto it = *this;
+            ++*this;
+            return it;
+        }
+
+        auto operator--(int) noexcept -> IteratorImpl
+        {
+            auto it = *this;
+            --*this;
+            return it;
+        }
+
+        auto operator*() const noexcept -> Reference
+        {
+            return { leaf->keys[index], leaf->values[index] };
+        }
+
+        auto operator->() const noexcept -> Pointer
+        {
+            return { **this };
+        }
+
+        bool operator==(const IteratorImpl& oth) const noexcept
+        {
+            return leaf == oth.leaf && index == oth.index;
+        }
+    private:
+        Leaf* leaf;
+        std::size_t index;
+    };
+
+    using Iterator = IteratorImpl<V>;
+    using ConstIterator = IteratorImpl<const V>;
+
+    BPlusTree() noexcept(noexcept(Allocator())) :
+        BPlusTree(Allocator())
+    {}
+
+    explicit BPlusTree(const Allocator& allocator) noexcept :
+        root(nullptr),
+        head(nullptr),
+        tail(nullptr),
+        height(0),
+        size(0),
+        allocator(allocator)
+    {}
+
+    BPlusTree(BPlusTree&& oth) noexcept :
+        root(std::exchange(oth.root, nullptr)),
+        head(std::exchange(oth.head, nullptr)),
+        tail(std::exchange(oth.tail, nullptr)),
+        height(std::exchange(oth.height, 0)),
+        size(std::exchange(oth.size, 0)),
+        allocator(oth.allocator)
+    {}
+
+    auto operator=(BPlusTree&& oth) noexcept -> BPlusTree&
+    {
+        if (this != AddressOf(oth)) {
+            Clear();
+            std::swap(root, oth.root);
+            std::swap(head, oth.head);
+            std::swap(tail, oth.tail);
+            std::swap(height, oth.height);
+            std::swap(size, oth.size);
+        }
+        return *this;
+    }
+
+    ~BPlusTree()
+    {
+        Clear();
+    }
+
+    // Inserts after the elements with equivalent keys.
+    auto Insert(K key, V value) -> Iterator
+    {
+        if (root == nullptr) {
+            root = head = tail = NewLeaf();
+            height = 1;
+        }
+        Step path[MaxHeight];
+        auto leaf = Descend<true>(key, path);
+        auto index = Rank<true, LeafCapacity>(leaf->keys, leaf->count, key);
+        ++size;
+        if (leaf->count != LeafCapacity) {
+            InsertAt(leaf, index, std::move(key), std::move(value));
+            return { leaf, index };
+        }
+        // Appending to the end leaves the node full, so that ascending
+        // insertions fill the leaves completely.
+        auto split = index == LeafCapacity && leaf->next == nullptr ?
+            LeafCapacity : (LeafCapacity + 1) / 2;
+        auto right = NewLeaf();
+        Iterator result = { right, index - split };
+        if (index >= split) {
+            MoveElements(leaf, split, index, right, 0);
+            right->keys[index - split] = std::move(key);
+            right->values[index - split] = std::move(value);
+            MoveElements(leaf, index, LeafCapacity, right, index - split + 1);
+            Truncate(leaf, split);
+        } else {
+            MoveElements(leaf, split - 1, LeafCapacity, right, 0);
+            Truncate(leaf, split - 1);
+            InsertAt(leaf, index, std::move(key), std::move(value));
+            result = { leaf, index };
+        }
+        right->count = LeafCapacity + 1 - split;
+        right->prev = leaf;
+        right->next = leaf->next;
+        (leaf->next != nullptr ? leaf->next->prev : tail) = right;
+        leaf->next = right;
+        InsertChild(path, height - 1, right->keys[0], right);
+        return result;
+    }
+
+    // Replaces the content with the elements of [first, last), pairs of a
+    // key and a value sorted by the key. Leaves and inner nodes are filled
+    // completely, but the last ones of a level.
+    template <typename InputIt>
+    void BulkLoad(InputIt first, InputIt last)
+    {
+        Clear();
+        std::vector<Node*> level;
+        std::vector<K> lowKeys;
+        Leaf* leaf = nullptr;
+        for (; first != last; ++first) {
+            auto&& [key, value] = *first;
+            if (leaf == nullptr || leaf->count == LeafCapacity) {
+                auto next = NewLeaf();
+                next->prev = leaf;
+                (leaf != nullptr ? leaf->next : head) = next;
+                leaf = next;
+                level.push_back(leaf);
+                lowKeys.push_back(key);
+            }
+            leaf->keys[leaf->count] = key;
+            leaf->values[leaf->count] = value;
+            ++leaf->count;
+            ++size;
+        }
+        if (leaf == nullptr) {
+            return;
+        }
+        tail = leaf;
+        height = 1;
+        if (auto prev = leaf->prev; prev != nullptr && leaf->count < LeafMin) {
+            auto moved = (prev->count + leaf->count) / 2 - leaf->count;
+            ShiftRight(leaf, 0, moved);
+            MoveElements(prev, prev->count - moved, prev->count, leaf, 0);
+            leaf->count += moved;
+            Truncate(prev, prev->count - moved);
+            lowKeys.back() = leaf->keys[0];
+        }
+        while (level.size() > 1) {
+            std::vector<Node*> upper;
+            std::vector<K> upperKeys;
+            for (std::size_t i = 0; i != level.size(); ++i) {
+                auto inner = upper.empty() ? nullptr :
+                    static_cast<Inner*>(upper.back());
+                if (inner == nullptr || inner->count == InnerCapacity) {
+                    upper.push_back(inner = NewInner());
+                    upperKeys.push_back(lowKeys[i]);
+                    inner->children[0] = level[i];
+                    continue;
+                }
+                inner->keys[inner->count] = lowKeys[i];
+                inner->children[++inner->count] = level[i];
+            }
+            auto count = upper.size();
+            auto inner = static_cast<Inner*>(upper.back());
+            if (count > 1 && inner->count < InnerMin) {
+                auto prev = static_cast<Inner*>(upper[count - 2]);
+                auto moved = (prev->count + inner->count) / 2 - inner->count;
+                auto separator = upperKeys.back();
+                upperKeys.back() = prev->keys[prev->count - moved];
+                MoveToRight(prev, inner, std::move(separator), moved);
+            }
+            level = std::move(upper);
+            lowKeys = std::move(upperKeys);
+            ++height;
+        }
+        root = level[0];
+    }
+
+    auto Erase(Iterator it) -> Iterator
+    {
+        Step path[MaxHeight];
+        auto leaf = it.leaf;
+        auto index = it.index;
+        // Equivalent keys may spread over several leaves, the path is
+        // walked right up to the erased one.
+        auto current = Descend<false>(leaf->keys[index], path);
+        while (current != leaf) {
+            current = NextLeaf(path);
+        }
+        --size;
+        EraseAt(leaf, index);
+        if (height == 1) {
+            if (leaf->count == 0) {
+                FreeLeaf(leaf);
+                root = head = tail = nullptr;
+                height = 0;
+                return End();
+            }
+            return Normalize(leaf, index);
+        }
+        if (leaf->count >= LeafMin) {
+            return Normalize(leaf, index);
+        }
+        auto [parent, child] = path[height - 2];
+        auto left = child != 0 ?
+            static_cast<Leaf*>(parent->children[child - 1]) : nullptr;
+        auto right = child != parent->count ?
+            static_cast<Leaf*>(parent->children[child + 1]) : nullptr;
+        if (right != nullptr && right->count > LeafMin) {
+            MoveElements(right, 0, 1, leaf, leaf->count);
+            ++leaf->count;
+            EraseAt(right, 0);
+            parent->keys[child] = right->keys[0];
+            return Normalize(leaf, index);
+        }
+        if (left != nullptr && left->count > LeafMin) {
+            ShiftRight(leaf, 0, 1);
+            MoveElements(left, left->count - 1, left->count, leaf, 0);
+            ++leaf->count;
+            Truncate(left, left->count - 1);
+            parent->keys[child - 1] = leaf->keys[0];
+            return Normalize(leaf, index + 1);
+        }
+        if (right == nullptr) {
+            right = leaf;
+            leaf = left;
+            index += left->count;
+            --child;
+        }
+        MoveElements(right, 0, right->count, leaf, leaf->count);
+        leaf->count += right->count;
+        leaf->next = right->next;
+        (right->next != nullptr ? right->next->prev : tail) = leaf;
+        FreeLeaf(right);
+        EraseChild(path, height - 2, child);
+        return Normalize(leaf, index);
+    }
+
+    // Erases all the elements with keys equivalent to key.
+    auto Erase(const K& key) -> std::size_t
+    {
+        Less less;
+        std::size_t count = 0;
+        for (auto it = Find(key); it != End() && !less(key, it->key); ++count) {
+            it = Erase(it);
+        }
+        return count;
+    }
+
+    auto Find(const K& key) -> Iterator
+    {
+        Less less;
+        auto it = LowerBound(key);
+        return it != End() && !less(key, it->key) ? it : End();
+    }
+
+    auto Find(const K& key) const -> ConstIterator
+    {
+        return Mutable().Find(key);
+    }
+
+    auto LowerBound(const K& key) -> Iterator
+    {
+        return Bound<false>(key);
+    }
+
+    auto LowerBound(const K& key) const -> ConstIterator
+    {
+        return Mutable().LowerBound(key);
+    }
+
+    auto UpperBound(const K& key) -> Iterator
+    {
+        return Bound<true>(key);
+    }
+
+    auto UpperBound(const K& key) const -> ConstIterator
+    {
+        return Mutable().UpperBound(key);
+    }
+
+    auto Begin() noexcept -> Iterator
+    {
+        return { head, 0 };
+    }
+
+    auto Begin() const noexcept -> ConstIterator
+    {
+        return Mutable().Begin();
+    }
+
+    friend auto begin(BPlusTree& tree) noexcept -> Iterator
+    {
+        return tree.Begin();
+    }
+
+    friend auto begin(const BPlusTree& tree) noexcept -> ConstIterator
+    {
+        return tree.Begin();
+    }
+
+    auto End() noexcept -> Iterator
+    {
+        return { tail, tail != nullptr ? tail->count : 0 };
+    }
+
+    auto End() const noexcept -> ConstIterator
+    {
+        return Mutable().End();
+    }
+
+    friend auto end(BPlusTree& tree) noexcept -> Iterator
+    {
+        return tree.End();
+    }
+
+    friend auto end(const BPlusTree& tree) noexcept -> ConstIterator
+    {
+        return tree.End();
+    }
+
+    bool Empty() const noexcept
+    {
+        return size == 0;
+    }
+
+    auto Size() const noexcept -> std::size_t
+    {
+        return size;
+    }
+
+    void Clear() noexcept
+    {
+        if (root != nullptr) {
+            FreeSubtree(root, height);
+        }
+        root = head = tail = nullptr;
+        height = 0;
+        size = 0;
+    }
+private:
+    auto Mutable() const noexcept -> BPlusTree&
+    {
+        return const_cast<BPlusTree&>(*this);
+    }
+
+    static auto Pad() -> K
+    {
+        if constexpr (Simd) {
+            return std::numeric_limits<K>::max();
+        } else {
+            return K();
+        }
+    }
+
+    // Index of the first of count keys that is not less than key, or
+    // greater than it if upper.
+    template <bool upper, std::size_t Capacity>
+    static auto Rank(
+        const K* keys, std::size_t count, const K& key
+    ) -> std::size_t {
+        if constexpr (Simd) {
+            auto rank = bplus_tree_detail::CountKeys<upper, RoundUp(Capacity)>(
+                keys, key
+            );
+            return std::min(rank, count);
+        } else if constexpr (upper) {
+            return std::upper_bound(keys, keys + count, key, Less()) - keys;
+        } else {
+            return std::lower_bound(keys, keys + count, key, Less()) - keys;
+        }
+    }
+
+    // Leaf that holds the bound of key, unless it is the first element of
+    // the next leaf, path receives the inner nodes passed.
+    template <bool upper>
+    auto Descend(const K& key, Step* path) const -> Leaf*
+    {
+        auto node = root;
+        for (std::size_t level = 0; level + 1 < height; ++level) {
+            auto inner = static_cast<Inner*>(node);
+            auto index = Rank<upper, InnerCapacity>(
+                inner->keys, inner->count, key
+            );
+            path[level] = { inner, index };
+            node = inner->children[index];
+        }
+        return static_cast<Leaf*>(node);
+    }
+
+    template <bool upper>
+    auto Bound(const K& key) -> Iterator
+    {
+        if (root == nullptr) {
+            return End();
+        }
+        Step path[MaxHeight];
+        auto leaf = Descend<upper>(key, path);
+        return Normalize(
+            leaf, Rank<upper, LeafCapacity>(leaf->keys, leaf->count, key)
+        );
+    }
+
+    static auto Normalize(Leaf* leaf, std::size_t index) noexcept -> Iterator
+    {
+        if (index == leaf->count && leaf->next != nullptr) {
+            return { leaf->next, 0 };
+        }
+        return { leaf, index };
+    }
+
+    // Advances path to the next leaf and returns it.
+    auto NextLeaf(Step* path) const -> Leaf*
+    {
+        auto level = height - 1;
+        while (path[level - 1].index == path[level - 1].node->count) {
+            --level;
+        }
+        ++path[level - 1].index;
+        for (; level != height - 1; ++level) {
+            auto [inner, index] = path[level - 1];
+            path[level] = { static_cast<Inner*>(inner->children[index]), 0 };
+        }
+        auto [inner, index] = path[level - 1];
+        return static_cast<Leaf*>(inner->children[index]);
+    }
+
+    static void MoveElements(
+        Leaf* from, std::size_t begin, std::size_t end,
+        Leaf* to, std::size_t dest
+    ) {
+        std::move(from->keys + begin, from->keys + end, to->keys + dest);
+        std::move(from->values + begin, from->values + end, to->values + dest);
+    }
+
+    static void ShiftRight(Leaf* leaf, std::size_t index, std::size_t shift)
+    {
+        auto count = leaf->count;
+        std::move_backward(
+            leaf->keys + index, leaf->keys + count, leaf->keys + count + shift
+        );
+        std::move_backward(
+            leaf->values + index, leaf->values + count,
+            leaf->values + count + shift
+        );
+    }
+
+    // Drops the elements from count on, their slots get the free value.
+    static void Truncate(Leaf* leaf, std::size_t count)
+    {
+        std::fill(leaf->keys + count, leaf->keys + leaf->count, Pad());
+        std::fill(leaf->values + count, leaf->values + leaf->count, V());
+        leaf->count = count;
+    }
+
+    static void InsertAt(Leaf* leaf, std::size_t index, K&& key, V&& value)
+    {
+        ShiftRight(leaf, index, 1);
+        leaf->keys[index] = std::move(key);
+        leaf->values[index] = std::move(value);
+        ++leaf->count;
+    }
+
+    static void EraseAt(Leaf* leaf, std::size_t index)
+    {
+        MoveElements(leaf, index + 1, leaf->count, leaf, index);
+        Truncate(leaf, leaf->count - 1);
+    }
+
+    // Moves the last count children of left to the front of right, the
+    // separator between them is rotated through the keys.
+    static void MoveToRight(
+        Inner* left, Inner* right, K separator, std::size_t count
+    ) {
+        auto n = right->count;
+        std::move_backward(right->keys, right->keys + n, right->keys + n + count);
+        std::move_backward(
+            right->children, right->children + n + 1,
+            right->children + n + 1 + count
+        );
+        right->keys[count - 1] = std::move(separator);
+        auto from = left->count - count;
+        std::move(left->keys + from + 1, left->keys + left->count, right->keys);
+        std::copy(
+            left->children + from + 1, left->children + left->count + 1,
+            right->children
+        );
+        std::fill(left->keys + from, left->keys + left->count, Pad());
+        left->count = from;
+        right->count = n + count;
+    }
+
+    // Inserts key and child after it at the given level of path, the full
+    // nodes are split up to the root.
+    void InsertChild(Step* path, std::size_t level, K key, Node* child)
+    {
+        while (level != 0) {
+            auto [inner, index] = path[--level];
+            if (inner->count != InnerCapacity) {
+                auto n = inner->count;
+                std::move_backward(
+                    inner->keys + index, inner->keys + n,
+                    inner->keys + n + 1
+                );
+                std::move_backward(
+                    inner->children + index + 1, inner->children + n + 1,
+                    inner->children + n + 2
+                );
+                inner->keys[index] = std::move(key);
+                inner->children[index + 1] = child;
+                ++inner->count;
+                return;
+            }
+            K keys[InnerCapacity + 1];
+            Node* children[InnerCapacity + 2];
+            std::move(inner->keys, inner->keys + index, keys);
+            keys[index] = std::move(key);
+            std::move(
+                inner->keys + index, inner->keys + InnerCapacity,
+                keys + index + 1
+            );
+            std::copy(inner->children, inner->children + index + 1, children);
+            children[index + 1] = child;
+            std::copy(
+                inner->children + index + 1,
+                inner->children + InnerCapacity + 1, children + index + 2
+            );
+            constexpr auto split = (InnerCapacity + 1) / 2;
+            auto right = NewInner();
+            std::move(keys, keys + split, inner->keys);
+            std::fill(inner->keys + split, inner->keys + InnerCapacity, Pad());
+            std::copy(children, children + split + 1, inner->children);
+            inner->count = split;
+            std::move(keys + split + 1, keys + InnerCapacity + 1, right->keys);
+            std::copy(
+                children + split + 1, children + InnerCapacity + 2,
+                right->children
+            );
+            right->count = InnerCapacity - split;
+            key = std::move(keys[split]);
+            child = right;
+        }
+        auto newRoot = NewInner();
+        newRoot->keys[0] = std::move(key);
+        newRoot->children[0] = root;
+        newRoot->children[1] = child;
+        newRoot->count = 1;
+        root = newRoot;
+        ++height;
+    }
+
+    // Removes the child at index + 1 and the key before it from the inner
+    // node at the given level of path, then refills the underflowing nodes
+    // up to the root.
+    void EraseChild(Step* path, std::size_t level, std::size_t index)
+    {
+        auto inner = path[level].node;
+        for (;;) {
+            auto n = inner->count;
+            std::move(inner->keys + index + 1, inner->keys + n, inner->keys + index);
+            inner->keys[n - 1] = Pad();
+            std::copy(
+                inner->children + index + 2, inner->children + n + 1,
+                inner->children + index + 1
+            );
+            --inner->count;
+            if (level == 0) {
+                if (inner->count == 0) {
+                    root = inner->children[0];
+                    --height;
+                    FreeInner(inner);
+                }
+                return;
+            }
+            if (inner->count >= InnerMin) {
+                return;
+            }
+            auto [parent, child] = path[--level];
+            auto left = child != 0 ?
+                static_cast<Inner*>(parent->children[child - 1]) : nullptr;
+            auto right = child != parent->count ?
+                static_cast<Inner*>(parent->children[child + 1]) : nullptr;
+            if (right != nullptr && right->count > InnerMin) {
+                auto m = inner->count;
+                inner->keys[m] = std::move(parent->keys[child]);
+                inner->children[m + 1] = right->children[0];
+                inner->count = m + 1;
+                parent->keys[child] = std::move(right->keys[0]);
+                auto r = right->count;
+                std::move(right->keys + 1, right->keys + r, right->keys);
+                right->keys[r - 1] = Pad();
+                std::copy(
+                    right->children + 1, right->children + r + 1,
+                    right->children
+                );
+                right->count = r - 1;
+                return;
+            }
+            if (left != nullptr && left->count > InnerMin) {
+                auto separator = std::move(parent->keys[child - 1]);
+                parent->keys[child - 1] = std::move(left->keys[left->count - 1]);
+                MoveToRight(left, inner, std::move(separator), 1);
+                return;
+            }
+            if (right == nullptr) {
+                right = inner;
+                inner = left;
+                --child;
+            }
+            auto m = inner->count;
+            inner->keys[m] = std::move(parent->keys[child]);
+            std::move(right->keys, right->keys + right->count, inner->keys + m + 1);
+            std::copy(
+                right->children, right->children + right->count + 1,
+                inner->children + m + 1
+            );
+            inner->count = m + 1 + right->count;
+            FreeInner(right);
+            inner = parent;
+            index = child;
+        }
+    }
+
+    auto NewLeaf() -> Leaf*
+    {
+        using Tr = std::allocator_traits<LeafAllocator>;
+        LeafAllocator alloc(allocator);
+        auto leaf = Tr::allocate(alloc, 1);
+        Tr::construct(alloc, leaf);
+        std::fill(std::begin(leaf->keys), std::end(leaf->keys), Pad());
+        leaf->count = 0;
+        leaf->prev = nullptr;
+        leaf->next = nullptr;
+        return leaf;
+    }
+
+    auto NewInner() -> Inner*
+    {
+        using Tr = std::allocator_traits<InnerAllocator>;
+        InnerAllocator alloc(allocator);
+        auto inner = Tr::allocate(alloc, 1);
+        Tr::construct(alloc, inner);
+        std::fill(std::begin(inner->keys), std::end(inner->keys), Pad());
+        inner->count = 0;
+        return inner;
+    }
+
+    void FreeLeaf(Leaf* leaf) noexcept
+    {
+        using Tr = std::allocator_traits<LeafAllocator>;
+        LeafAllocator alloc(allocator);
+        Tr::destroy(alloc, leaf);
+        Tr::deallocate(alloc, leaf, 1);
+    }
+
+    void FreeInner(Inner* inner) noexcept
+    {
+        using Tr = std::allocator_traits<InnerAllocator>;
+        InnerAllocator alloc(allocator);
+        Tr::destroy(alloc, inner);
+        Tr::deallocate(alloc, inner, 1);
+    }
+
+    void FreeSubtree(Node* node, std::size_t levels) noexcept
+    {
+        if (levels == 1) {
+            FreeLeaf(static_cast<Leaf*>(node));
+            return;
+        }
+        auto inner = static_cast<Inner*>(node);
+        for (std::size_t i = 0; i <= inner->count; ++i) {
+            FreeSubtree(inner->children[i], levels - 1);
+        }
+        FreeInner(inner);
+    }
+
+    Node* root;
+    Leaf* head;
+    Leaf* tail;
+    std::size_t height;
+    std::size_t size;
+    [[no_unique_address]] Allocator allocator;
+};
+
+}
+
+#undef AddressOf
+
+#endif // BPLUS_TREE_H
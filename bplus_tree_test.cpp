@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "bplus_tree.hpp"
+#include "test.hpp"
+
+using container_test::BPlusTree;
+using container_test::test::Check;
+
+// Built once per instruction set, see CMakeLists.txt, so that every path
+// of CountKeys the target supports is taken. Builds for an instruction set
+// the machine lacks are skipped.
+
+namespace {
+
+constexpr int Skipped = 77;
+
+// Keys spread around zero for signed types and around the sign bit for
+// unsigned ones, where the vector compares flip it, with both extremes.
+template <typename K>
+auto MakeKey(unsigned r, unsigned count) -> K
+{
+    using Limits = std::numeric_limits<K>;
+    if (r == 0) {
+        return Limits::min();
+    }
+    if (r + 1 == count) {
+        return Limits::max();
+    }
+    K middle = std::is_signed_v<K> ? K(0) : K(K(1) << (sizeof(K) * 8 - 1));
+    return K(middle + K(r) - K(count / 2));
+}
+
+// Vector counts of every prefix of sorted keys, padded like a node, match
+// a plain count for keys in, between and beyond them.
+template <typename K>
+void TestCountKeys(unsigned seed)
+{
+    constexpr std::size_t Slots = 16;
+    std::mt19937 random(seed);
+    for (int round = 0; round != 2000; ++round) {
+        auto count = random() % (Slots + 1);
+        K keys[Slots];
+        for (std::size_t i = 0; i != Slots; ++i) {
+            keys[i] = i < count ? MakeKey<K>(random() % 64, 64) : std::numeric_limits<K>::max();
+        }
+        std::sort(keys, keys + count);
+        for (unsigned r = 0; r != 64; ++r) {
+            auto key = MakeKey<K>(r, 64);
+            std::size_t less = 0;
+            std::size_t notGreater = 0;
+            for (auto each : keys) {
+                less += each < key;
+                notGreater += !(key < each);
+            }
+            using container_test::bplus_tree_detail::CountKeys;
+            Check(CountKeys<false, Slots>(keys, key) == less);
+            Check(CountKeys<true, Slots>(keys, key) == notGreater);
+        }
+    }
+}
+
+template <typename Tree, typename Expected>
+void CheckEqual(Tree& tree, const Expected& expected)
+{
+    Check(tree.Size() == expected.size() && tree.Empty() == expected.empty());
+    auto entry = expected.begin();
+    for (auto [key, value] : tree) {
+        Check(entry != expected.end() && entry->first == key && entry->second == value);
+        ++entry;
+    }
+    Check(entry == expected.end());
+    auto it = tree.End();
+    for (auto rentry = expected.rbegin(); rentry != expected.rend(); ++rentry) {
+        --it;
+        Check(it->key == rentry->first && it->value == rentry->second);
+    }
+    Check(it == tree.Begin());
+}
+
+template <typename Tree, typename Expected>
+bool Same(Tree& tree, typename Tree::Iterator it, const Expected& expected, typename Expected::iterator entry)
+{
+    if (it == tree.End() || entry == expected.end()) {
+        return (it == tree.End()) == (entry == expected.end());
+    }
+    return it->key == entry->first && it->value == entry->second;
+}
+
+// Random operations against a multimap, values are insertion numbers so
+// the order of equivalent keys is checked as well.
+template <typename K, typename Less, std::size_t NodeSize>
+void TestRandom(unsigned seed, unsigned keyCount)
+{
+    using Tree = BPlusTree<K, long, Less, NodeSize>;
+    using Expected = std::multimap<K, long, Less>;
+    std::mt19937 random(seed);
+    Tree tree;
+    Expected expected;
+    long seq = 0;
+    for (int step = 0; step != 30000; ++step) {
+        auto key = MakeKey<K>(random() % keyCount, keyCount);
+        switch (random() % 7) {
+        case 0: case 1: case 2: {
+            auto it = tree.Insert(key, seq);
+            auto entry = expected.insert({ key, seq });
+            Check(Same(tree, it, expected, entry));
+            ++seq;
+            break;
+        }
+        case 3:
+            if (auto it = tree.LowerBound(key); it != tree.End()) {
+                auto entry = expected.lower_bound(key);
+                Check(Same(tree, it, expected, entry));
+                Check(Same(tree, tree.Erase(it), expected, expected.erase(entry)));
+            }
+            break;
+        case 4:
+            Check(tree.Erase(key) == expected.erase(key));
+            break;
+        default:
+            Check(Same(tree, tree.LowerBound(key), expected, expected.lower_bound(key)));
+            Check(Same(tree, tree.UpperBound(key), expected, expected.upper_bound(key)));
+            auto found = expected.find(key);
+            if (found != expected.end()) {
+                found = expected.lower_bound(key);
+            }
+            Check(Same(tree, tree.Find(key), expected, found));
+        }
+        if (step % 64 == 0) {
+            CheckEqual(tree, expected);
+        }
+    }
+    CheckEqual(tree, expected);
+    while (!tree.Empty()) {
+        auto it = tree.Begin();
+        for (auto skip = random() % tree.Size(); skip != 0; --skip) {
+            ++it;
+        }
+        auto entry = expected.find(it->key);
+        while (entry->second != it->value) {
+            ++entry;
+        }
+        Check(Same(tree, tree.Erase(it), expected, expected.erase(entry)));
+    }
+    CheckEqual(tree, expected);
+}
+
+// Bulk loads of sizes around multiples of the leaf capacity, including
+// the underfull last leaf, and modifications of the loaded tree.
+template <typename K, std::size_t NodeSize>
+void TestBulkLoad(unsigned seed)
+{
+    using Tree = BPlusTree<K, long, std::less<K>, NodeSize>;
+    using Expected = std::multimap<K, long>;
+    std::mt19937 random(seed);
+    auto capacity = Tree::LeafCapacity;
+    for (std::size_t size = 0; size <= capacity * capacity * 3; size += 1 + size / 8) {
+        std::vector<std::pair<K, long>> sorted;
+        Expected expected;
+        for (std::size_t i = 0; i != size; ++i) {
+            auto key = MakeKey<K>(random() % 200, 200);
+            sorted.push_back({ key, long(i) });
+        }
+        std::stable_sort(sorted.begin(), sorted.end(), [](auto& a, auto& b) {
+            return a.first < b.first;
+        });
+        for (auto& entry : sorted) {
+            expected.insert(entry);
+        }
+        Tree tree;
+        tree.Insert(MakeKey<K>(1, 200), -1);
+        tree.BulkLoad(sorted.begin(), sorted.end());
+        CheckEqual(tree, expected);
+        for (long i = 0; i != long(size); ++i) {
+            auto key = MakeKey<K>(random() % 200, 200);
+            if (i % 2 == 0) {
+                tree.Insert(key, long(size) + i);
+                expected.insert({ key, long(size) + i });
+            } else {
+                Check(tree.Erase(key) == expected.erase(key));
+            }
+        }
+        CheckEqual(tree, expected);
+    }
+}
+
+}
+
+int main(int, char*[])
+{
+#if defined(__GNUC__) && defined(__AVX2__)
+    if (!__builtin_cpu_supports("avx2")) {
+        return Skipped;
+    }
+#elif defined(__GNUC__) && defined(__SSE4_2__)
+    if (!__builtin_cpu_supports("sse4.2")) {
+        return Skipped;
+    }
+#endif
+    TestCountKeys<std::int32_t>(1);
+    TestCountKeys<std::uint32_t>(2);
+    TestCountKeys<std::int64_t>(3);
+    TestCountKeys<std::uint64_t>(4);
+    TestRandom<std::int32_t, std::less<std::int32_t>, 128>(1, 100);
+    TestRandom<std::uint32_t, std::less<>, 256>(2, 10000);
+    TestRandom<std::int64_t, std::less<std::int64_t>, 256>(3, 40);
+    TestRandom<std::uint64_t, std::less<std::uint64_t>, 128>(4, 100000);
+    // Not searched by vector compares.
+    TestRandom<std::int32_t, std::greater<std::int32_t>, 128>(5, 1000);
+    TestBulkLoad<std::int32_t, 128>(1);
+    TestBulkLoad<std::uint64_t, 256>(2);
+    return 0;
+}
@@ -4,6 +4,8 @@
 #include <cstddef>
 #include <utility>
 #include <stdexcept>
+#include "comparator.hpp"
+#include "instrumentation.hpp"
 #include "node.hpp"
 #include "bs_tree_node.hpp"
 
@@ -11,20 +13,16 @@
 
 namespace container_test::intrusive {
 
-namespace detail {
-
-template <typename Comp, typename Key>
-concept Comparator = requires (const Key t1, const Key t2, Comp c)
-{
-    { c(t1, t2) } -> std::same_as<bool>;
-};
-
-}
-
+// Self-adjusting (splay) binary search tree. Insert, Find, LowerBound,
+// UpperBound and Erase move the accessed node to the root, so recently used
+// keys are found in a few steps. Operations take amortized O(log n), a
+// single one may take O(n). Lookups modify the tree, even a shared tree
+// that is only searched needs exclusive access.
 template <
     typename T,
     detail::Comparator<T> Comp,
-        typename CastPolicyGen = BaseClassCastPolicy<BSTreeNode<>, T>
+    typename CastPolicyGen = BaseClassCastPolicy<BSTreeNode<>, T>,
+    typename InstrumentationGen = NullInstrumentation
 >
 class BSTree : detail::ContainerNodeRequirments<T, CastPolicyGen> {
 public:
@@ -32,38 +30,86 @@ public:
     using NodeType = typename CastPolicyGen::NodeType;
     using NodeTraits = BSTreeNodeTraits<NodeType>;
     using TraitsHelper = BSTreeNodeTraitsHelper<NodeType>;
+    using Less = typename ComparatorTraits<Comp>::Less;
+    using ThreeWay = typename ComparatorTraits<Comp>::ThreeWay;
+    using Instrumentation = InstrumentationGen;
     BSTree() : root(nullptr)
     {}
 
     BSTree(BSTree&& oth) :
-        root(oth.root)
+        root(std::exchange(oth.root, nullptr))
     {}
 
+    // In order iteration, it does not splay.
+    class Iterator : public detail::BasicIterator<Iterator, T> {
+        friend class BSTree;
+        Iterator(NodeType* current) noexcept :
+            current(current)
+        {}
+    public:
+        Iterator() noexcept :
+            current(nullptr)
+        {}
+
+        auto operator++() noexcept -> Iterator&
+        {
+            current = Successor(current);
+            return *this;
+        }
+
+        T* operator->() const noexcept
+        {
+            return CastPolicy::FromNode(current);
+        }
+
+        bool operator==(const Iterator& oth) const noexcept
+        {
+            return current == oth.current;
+        }
+    private:
+        NodeType* current;
+    };
+
+    // Inserts elem after the equivalent elements.
     void Insert(T* elem)
     {
         using cp = CastPolicy;
-        using H = TraitsHelper;
-        auto current = H(root);
-        Comp comp;
-
-        auto node = H(cp::ToNode(elem));
-        node.Children(0) = nullptr;
-        node.Children(1) = nullptr;
-
-        auto t = comp(*cp::FromNode(current), *elem);
-        while (current.Children(t) != nullptr) {
-            current = current.Children(t);
-            t = comp(*cp::FromNode(current), *elem);
+        using Tr = NodeTraits;
+        auto node = cp::ToNode(elem);
+        Tr::SetChild(*node, 0, nullptr);
+        Tr::SetChild(*node, 1, nullptr);
+        Tr::SetParent(*node, nullptr);
+        if (root == nullptr) {
+            root = node;
+            return;
+        }
+        Less comp;
+        auto current = root;
+        for (std::size_t depth = 1;; ++depth) {
+            bool right = !comp(*elem, *cp::FromNode(current));
+            auto child = Tr::GetChild(*current, right);
+            if (child == nullptr) {
+                instrumentation.OnSearch(depth);
+                Tr::SetChild(*current, right, node);
+                Tr::SetParent(*node, current);
+                break;
+            }
+            current = child;
         }
-        current.Children(t) = node;
-        return;
+        Splay(node);
     }
 
+    // Unlinks an element equivalent to key, returns nullptr if there is
+    // none.
     template <typename KeyType = T>
-    T* Extract(KeyType& key)
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    T* Extract(const KeyType& key)
     {
-        using cp = CastPolicy;
-        auto r = FindInternal(key);
+        auto elem = Find(key);
+        if (elem != nullptr) {
+            Erase(*elem);
+        }
+        return elem;
     }
 
     T* Find(const T& key) {
@@ -71,74 +117,241 @@ public:
     }
 
     template <typename KeyType = T>
-    requires(requires (const T& t, const KeyType& k, Comp comp) {
-        comp(k, t);
-        comp(t, k);
-    })
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
     T* Find(const KeyType& key)
     {
         using cp = CastPolicy;
-        auto r = FindInternal(key);
-        return cp::FromNode(r.node);
+        using Tr = NodeTraits;
+        if (root == nullptr) {
+            return nullptr;
+        }
+        ThreeWay comp;
+        auto current = root;
+        for (std::size_t depth = 1;; ++depth) {
+            auto order = comp(key, *cp::FromNode(current));
+            auto child = order == 0 ?
+                nullptr : Tr::GetChild(*current, order > 0);
+            if (child == nullptr) {
+                instrumentation.OnSearch(depth);
+                Splay(current);
+                return order == 0 ? cp::FromNode(current) : nullptr;
+            }
+            current = child;
+        }
+    }
+
+    // First element not less than key, nullptr if there is none.
+    template <typename KeyType>
+    T* LowerBound(const KeyType& key)
+    {
+        using cp = CastPolicy;
+        Less comp;
+        return Bound([&](NodeType* node) {
+            return comp(*cp::FromNode(node), key);
+        });
     }
 
-    bool Empty()
+    // First element greater than key, nullptr if there is none.
+    template <typename KeyType>
+    T* UpperBound(const KeyType& key)
     {
-        return root == nullptr;
+        using cp = CastPolicy;
+        Less comp;
+        return Bound([&](NodeType* node) {
+            return !comp(key, *cp::FromNode(node));
+        });
     }
-private:
-    struct NodeReference {
-        NodeType* node;
-        NodeType* parent;
-    };
 
-    template <typename KeyType = T>
-    auto FindInternal(const KeyType& key) -> NodeReference
+    void Erase(T& elem)
     {
         using cp = CastPolicy;
         using Tr = NodeTraits;
-        Comp comp;
+        auto node = cp::ToNode(AddressOf(elem));
+        Splay(node);
+        auto left = Tr::GetChild(*node, 0);
+        auto right = Tr::GetChild(*node, 1);
+        root = left;
+        if (left == nullptr) {
+            root = right;
+            if (right != nullptr) {
+                Tr::SetParent(*right, nullptr);
+            }
+            return;
+        }
+        Tr::SetParent(*left, nullptr);
+        auto last = left;
+        while (auto child = Tr::GetChild(*last, 1)) {
+            last = child;
+        }
+        Splay(last);
+        Tr::SetChild(*last, 1, right);
+        if (right != nullptr) {
+            Tr::SetParent(*right, last);
+        }
+    }
 
-        NodeReference r = { root, nullptr };
-        while (r.node != nullptr) {
-            auto cptr = cp::FromNode(r.node);
-            auto less = comp(*cptr, key);
-            if (!(less || comp(key, *cptr))) {
-                break;
+    Iterator Erase(Iterator it)
+    {
+        auto node = it++.current;
+        Erase(*CastPolicy::FromNode(node));
+        return it;
+    }
+
+    // Erases all the elements equivalent to key.
+    template <typename KeyType>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    std::size_t Erase(const KeyType& key)
+    {
+        std::size_t count = 0;
+        while (Extract(key) != nullptr) {
+            ++count;
+        }
+        return count;
+    }
+
+    Iterator Begin()
+    {
+        using Tr = NodeTraits;
+        auto node = root;
+        if (node != nullptr) {
+            while (auto child = Tr::GetChild(*node, 0)) {
+                node = child;
             }
-            r.parent = r.node;
-            r.node = Tr::GetChild(*r.node, less);
         }
-        return r;
+        return node;
+    }
+
+    friend Iterator begin(BSTree& tree)
+    {
+        return tree.Begin();
+    }
+
+    Iterator End()
+    {
+        return nullptr;
+    }
+
+    friend Iterator end(BSTree& tree)
+    {
+        return tree.End();
+    }
+
+    auto IteratorTo(T& elem) -> Iterator
+    {
+        using cp = CastPolicy;
+        return cp::ToNode(AddressOf(elem));
+    }
+
+    bool Empty()
+    {
+        return root == nullptr;
+    }
+
+    void Clear()
+    {
+        root = nullptr;
     }
 
-    static auto FindReplacement(NodeType* node) -> NodeReference
+    // Descents are reported as searches, splay rotations as rotations and
+    // the length of splayed paths as rebalances.
+    auto GetInstrumentation() noexcept -> Instrumentation&
+    {
+        return instrumentation;
+    }
+private:
+    template <typename F>
+    T* Bound(F goRight)
     {
         using cp = CastPolicy;
         using Tr = NodeTraits;
-        NodeReference r = { Tr::GetChild(*node, 1), node };
-        if (r.node == nullptr) {
-            r.node = Tr::GetChild(*node, 0);
-            return r;
+        if (root == nullptr) {
+            return nullptr;
+        }
+        NodeType* result = nullptr;
+        auto current = root;
+        for (std::size_t depth = 1;; ++depth) {
+            bool right = goRight(current);
+            if (!right) {
+                result = current;
+            }
+            auto child = Tr::GetChild(*current, right);
+            if (child == nullptr) {
+                instrumentation.OnSearch(depth);
+                Splay(result ? result : current);
+                return result ? cp::FromNode(result) : nullptr;
+            }
+            current = child;
+        }
+    }
+
+    static bool Side(NodeType* node)
+    {
+        using Tr = NodeTraits;
+        return Tr::GetChild(*Tr::GetParent(*node), 1) == node;
+    }
+
+    // Lifts node above its parent.
+    void Rotate(NodeType* node)
+    {
+        using Tr = NodeTraits;
+        instrumentation.OnRotation(false);
+        auto parent = Tr::GetParent(*node);
+        auto grand = Tr::GetParent(*parent);
+        bool right = Side(node);
+        auto inner = Tr::GetChild(*node, !right);
+        Tr::SetChild(*parent, right, inner);
+        if (inner != nullptr) {
+            Tr::SetParent(*inner, parent);
+        }
+        if (grand != nullptr) {
+            Tr::SetChild(*grand, Side(parent), node);
+        } else {
+            root = node;
         }
-        while (auto child = Tr::GetChild(*r.node, 0)) {
-            r.parent = r.node;
-            r.node = child;
+        Tr::SetParent(*node, grand);
+        Tr::SetChild(*node, !right, parent);
+        Tr::SetParent(*parent, node);
+    }
+
+    void Splay(NodeType* node)
+    {
+        using Tr = NodeTraits;
+        std::size_t length = 0;
+        while (auto parent = Tr::GetParent(*node)) {
+            ++length;
+            if (Tr::GetParent(*parent) == nullptr) {
+                Rotate(node);
+            } else if (Side(node) == Side(parent)) {
+                Rotate(parent);
+                Rotate(node);
+            } else {
+                Rotate(node);
+                Rotate(node);
+            }
         }
-        return r;
+        instrumentation.OnRebalance(length);
     }
 
-    bool Erase(NodeReference ref) {
+    static auto Successor(NodeType* node) -> NodeType*
+    {
         using Tr = NodeTraits;
-        auto child0 = Tr::GetChild(*ref.node, 0);
-        auto child1 = Tr::GetChild(*ref.node, 1);
-        if (child0 != nullptr && child1 != nullptr) {
-            return false;
+        if (auto child = Tr::GetChild(*node, 1)) {
+            while (auto next = Tr::GetChild(*child, 0)) {
+                child = next;
+            }
+            return child;
+        }
+        while (auto parent = Tr::GetParent(*node)) {
+            if (Tr::GetChild(*parent, 0) == node) {
+                return parent;
+            }
+            node = parent;
         }
-        auto childId = Tr::GetChild(*ref.parent, 1);
+        return nullptr;
     }
 
     NodeType* root;
+    [[no_unique_address]] Instrumentation instrumentation;
 };
 
 }
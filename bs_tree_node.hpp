@@ -12,7 +12,6 @@ template <>
 struct BSTreeNode<void> {
     BSTreeNode* parent;
     BSTreeNode* children[2];
-    int balance;
     BSTreeNode() {};
 };
 
@@ -24,9 +23,17 @@ struct BSTreeNodeTraits;
 
 template <typename T>
 struct BSTreeNodeTraits<BSTreeNode<T>> {
+    static auto GetParent(BSTreeNode<T>& node) -> BSTreeNode<T>*
+    {
+        return static_cast<BSTreeNode<T>*>(node.parent);
+    }
+    static void SetParent(BSTreeNode<T>& node, BSTreeNode<T>* parent)
+    {
+        node.parent = parent;
+    }
     static auto GetChild(BSTreeNode<T>& node, bool right) -> BSTreeNode<T>*
     {
-        return node.children[right];
+        return static_cast<BSTreeNode<T>*>(node.children[right]);
     }
     static void SetChild(BSTreeNode<T>& node, bool right, BSTreeNode<T>* child)
     {
@@ -0,0 +1,181 @@
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "bs_tree.hpp"
+#include "test.hpp"
+
+using namespace container_test::intrusive;
+using container_test::test::Check;
+
+namespace {
+
+struct Elem : BSTreeNode<> {
+    int key;
+    long seq;
+    std::size_t index;
+};
+
+struct Comp {
+    auto operator()(const Elem& a, const Elem& b) const
+    {
+        return a.key <=> b.key;
+    }
+    auto operator()(const Elem& a, int b) const
+    {
+        return a.key <=> b;
+    }
+};
+
+using Tree = BSTree<Elem, Comp>;
+using Tr = Tree::NodeTraits;
+using cp = Tree::CastPolicy;
+// Equivalent elements stay in the order of insertion, seq tells it.
+using Expected = std::set<std::pair<int, long>>;
+
+auto Entry(const Elem& elem) -> std::pair<int, long>
+{
+    return { elem.key, elem.seq };
+}
+
+// Iteration gives the elements of expected in order, every link is matched
+// by the parent link of the child and there is a single root.
+void CheckTree(Tree& tree, const Expected& expected)
+{
+    Check(tree.Empty() == expected.empty());
+    auto entry = expected.begin();
+    std::size_t roots = 0;
+    for (auto& elem : tree) {
+        Check(entry != expected.end() && Entry(elem) == *entry);
+        ++entry;
+        auto node = cp::ToNode(&elem);
+        for (bool right : { false, true }) {
+            auto child = Tr::GetChild(*node, right);
+            Check(child == nullptr || Tr::GetParent(*child) == node);
+        }
+        roots += Tr::GetParent(*node) == nullptr;
+    }
+    Check(entry == expected.end());
+    Check(roots == (expected.empty() ? 0 : 1));
+}
+
+void CheckLookups(Tree& tree, const Expected& expected, int key)
+{
+    auto lower = tree.LowerBound(key);
+    auto expectedLower = expected.lower_bound({ key, -1 });
+    Check(lower == nullptr
+        ? expectedLower == expected.end()
+        : expectedLower != expected.end() && Entry(*lower) == *expectedLower);
+    auto upper = tree.UpperBound(key);
+    auto expectedUpper = expected.lower_bound({ key + 1, -1 });
+    Check(upper == nullptr
+        ? expectedUpper == expected.end()
+        : expectedUpper != expected.end() && Entry(*upper) == *expectedUpper);
+    auto found = tree.Find(key);
+    Check((found != nullptr) == (expectedLower != expectedUpper));
+    Check(found == nullptr || (expected.count(Entry(*found)) != 0 && found->key == key));
+}
+
+// Random operations against a set of (key, seq), a small key range keeps
+// runs of equivalent elements. Lookups splay, so they are interleaved with
+// the modifications.
+void TestRandom(unsigned seed, std::size_t elemCount, int keyCount)
+{
+    std::mt19937 random(seed);
+    std::vector<Elem> elems(elemCount);
+    std::vector<bool> linked(elemCount);
+    for (std::size_t i = 0; i != elemCount; ++i) {
+        elems[i].index = i;
+    }
+    Tree tree;
+    Expected expected;
+    long seq = 0;
+    auto unlink = [&](Elem& elem) {
+        Check(linked[elem.index] && expected.erase(Entry(elem)) == 1);
+        linked[elem.index] = false;
+    };
+    for (int step = 0; step != 40000; ++step) {
+        auto& elem = elems[random() % elemCount];
+        auto key = int(random() % unsigned(keyCount));
+        switch (random() % 7) {
+        case 0: case 1:
+            if (!linked[elem.index]) {
+                elem.key = key;
+                elem.seq = seq++;
+                tree.Insert(&elem);
+                expected.insert(Entry(elem));
+                linked[elem.index] = true;
+            }
+            break;
+        case 2:
+            if (linked[elem.index]) {
+                unlink(elem);
+                tree.Erase(elem);
+            }
+            break;
+        case 3:
+            if (auto lower = tree.LowerBound(key)) {
+                auto it = tree.IteratorTo(*lower);
+                auto next = it;
+                ++next;
+                unlink(*lower);
+                Check(tree.Erase(it) == next);
+            }
+            break;
+        case 4: {
+            auto count = std::size_t(std::distance(
+                expected.lower_bound({ key, -1 }), expected.lower_bound({ key + 1, -1 })
+            ));
+            for (auto& each : elems) {
+                if (linked[each.index] && each.key == key) {
+                    unlink(each);
+                }
+            }
+            Check(tree.Erase(key) == count);
+            break;
+        }
+        case 5:
+            if (auto extracted = tree.Extract(key)) {
+                Check(extracted->key == key);
+                unlink(*extracted);
+            } else {
+                Check(expected.lower_bound({ key, -1 }) == expected.lower_bound({ key + 1, -1 }));
+            }
+            break;
+        default:
+            for (int probe = -1; probe <= keyCount; probe += 1 + keyCount / 16) {
+                CheckLookups(tree, expected, probe);
+            }
+        }
+        CheckTree(tree, expected);
+    }
+    tree.Clear();
+    CheckTree(tree, {});
+}
+
+// The operations of an empty tree, which has no root to splay.
+void TestEmpty()
+{
+    Tree tree;
+    Check(tree.Find(0) == nullptr && tree.Extract(0) == nullptr);
+    Check(tree.LowerBound(0) == nullptr && tree.UpperBound(0) == nullptr);
+    Check(tree.Erase(0) == 0 && tree.Begin() == tree.End());
+    Elem elem;
+    elem.key = 1;
+    tree.Insert(&elem);
+    Check(tree.Extract(1) == &elem && tree.Empty());
+}
+
+}
+
+int main(int, char*[])
+{
+    TestEmpty();
+    TestRandom(1, 300, 100);
+    TestRandom(2, 300, 10);
+    TestRandom(3, 1000, 100000);
+    return 0;
+}
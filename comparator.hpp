@@ -0,0 +1,102 @@
+#ifndef COMPARATOR_H
+#define COMPARATOR_H
+
+#include <compare>
+#include <concepts>
+#include <type_traits>
+
+namespace container_test::intrusive {
+
+namespace detail {
+
+template <typename R>
+concept ThreeWayResult = !std::same_as<R, bool> && requires (R r) {
+    { r < 0 } -> std::convertible_to<bool>;
+    { r == 0 } -> std::convertible_to<bool>;
+};
+
+template <typename Comp, typename A, typename B>
+concept ThreeWayInvocable = requires (Comp c, const A& a, const B& b) {
+    { c(a, b) } -> ThreeWayResult;
+};
+
+template <typename Comp, typename A, typename B>
+concept LessInvocable = requires (Comp c, const A& a, const B& b) {
+    { c(a, b) } -> std::same_as<bool>;
+};
+
+template <typename Comp, typename Key>
+concept Comparator =
+    LessInvocable<Comp, Key, Key> || ThreeWayInvocable<Comp, Key, Key>;
+
+}
+
+// Adapters of a comparator returning either bool (less) or a three-way
+// result (<=> like). A three-way comparator may provide only one order of
+// heterogeneous arguments, it is reversed when needed. Either way it takes
+// a single call of Comp to get the adapted result, except ThreeWay over a
+// less comparator which takes up to two.
+template <typename Comp>
+struct ComparatorTraits {
+    struct ThreeWay {
+        template <typename A, typename B>
+        requires detail::ThreeWayInvocable<Comp, A, B>
+        constexpr auto operator()(const A& a, const B& b) const
+        {
+            Comp comp;
+            return comp(a, b);
+        }
+        template <typename A, typename B>
+        requires (
+            !detail::ThreeWayInvocable<Comp, A, B> &&
+            detail::ThreeWayInvocable<Comp, B, A>
+        )
+        constexpr auto operator()(const A& a, const B& b) const
+        {
+            Comp comp;
+            return 0 <=> comp(b, a);
+        }
+        template <typename A, typename B>
+        requires (
+            !detail::ThreeWayInvocable<Comp, A, B> &&
+            !detail::ThreeWayInvocable<Comp, B, A> &&
+            detail::LessInvocable<Comp, A, B> &&
+            detail::LessInvocable<Comp, B, A>
+        )
+        constexpr auto operator()(const A& a, const B& b) const -> std::weak_ordering
+        {
+            Comp comp;
+            if (comp(a, b)) {
+                return std::weak_ordering::less;
+            }
+            if (comp(b, a)) {
+                return std::weak_ordering::greater;
+            }
+            return std::weak_ordering::equivalent;
+        }
+    };
+    struct Less {
+        using is_transparent = void;
+        template <typename A, typename B>
+        requires detail::LessInvocable<Comp, A, B>
+        constexpr bool operator()(const A& a, const B& b) const
+        {
+            Comp comp;
+            return comp(a, b);
+        }
+        template <typename A, typename B>
+        requires (
+            !detail::LessInvocable<Comp, A, B> &&
+            std::invocable<ThreeWay, const A&, const B&>
+        )
+        constexpr bool operator()(const A& a, const B& b) const
+        {
+            ThreeWay comp;
+            return comp(a, b) < 0;
+        }
+    };
+};
+
+}
+
+#endif // COMPARATOR_H
@@ -0,0 +1,164 @@
+#ifndef EPOCH_RECLAIMER_H
+#define EPOCH_RECLAIMER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace container_test {
+
+// Epoch based deferred reclamation for containers read without locks.
+// Readers pin the current epoch while they may hold pointers to elements,
+// the writer retires unlinked elements, they are passed to reclaim once
+// no reader pinned before the unlink is left. Retire and Collect are to
+// be called by a single writer at a time, Retire with a guard by any
+// thread holding it.
+template <typename T, typename Reclaim>
+class EpochReclaimer {
+    struct Retired {
+        std::uint64_t epoch;
+        T* elem;
+    };
+
+    // limbo belongs to the thread pinning the slot.
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> epoch = 0;
+        std::vector<Retired> limbo;
+    };
+public:
+    explicit EpochReclaimer(
+        Reclaim reclaim = Reclaim(), std::size_t slotCount = 64,
+        std::size_t collectThreshold = 64
+    ) :
+        reclaim(std::move(reclaim)),
+        slots(slotCount),
+        collectThreshold(collectThreshold)
+    {}
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    // Expects no reader to be left.
+    ~EpochReclaimer()
+    {
+        for (auto& retired : limbo) {
+            reclaim(*retired.elem);
+        }
+        for (auto& slot : slots) {
+            for (auto& retired : slot.limbo) {
+                reclaim(*retired.elem);
+            }
+        }
+    }
+
+    class Guard {
+        friend class EpochReclaimer;
+        explicit Guard(Slot* slot) :
+            slot(slot)
+        {}
+    public:
+        Guard(Guard&& oth) noexcept :
+            slot(std::exchange(oth.slot, nullptr))
+        {}
+
+        Guard& operator=(Guard&&) = delete;
+
+        ~Guard()
+        {
+            if (slot) {
+                slot->epoch.store(0, std::memory_order_release);
+            }
+        }
+    private:
+        Slot* slot;
+    };
+
+    // Elements reachable while the guard is alive are not reclaimed. A
+    // reader waits for a free slot if there are more readers than slots.
+    auto Pin() -> Guard
+    {
+        auto epoch = globalEpoch.load(std::memory_order_seq_cst);
+        auto index = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        while (true) {
+            auto& slot = slots[index % slots.size()];
+            std::uint64_t expected = 0;
+            if (slot.epoch.compare_exchange_weak(
+                expected, epoch, std::memory_order_acquire,
+                std::memory_order_relaxed
+            )) {
+                // Either Collect sees the slot or the reader sees every
+                // unlink done before it.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                return Guard(&slot);
+            }
+            ++index;
+        }
+    }
+
+    // elem has to be unlinked already.
+    void Retire(T& elem)
+    {
+        limbo.push_back({ globalEpoch.load(std::memory_order_relaxed), &elem });
+        if (limbo.size() >= collectThreshold) {
+            Collect();
+        }
+    }
+
+    // Same as Retire, for writers running concurrently. Elements are kept
+    // with the slot of guard and collected by the threads pinning it later.
+    void Retire(Guard& guard, T& elem)
+    {
+        auto& limbo = guard.slot->limbo;
+        // The unlink may have been done by another thread. Pairs with the
+        // fences of Pin and Collect, so the epoch read is not older than
+        // that of any reader which can still reach elem.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        limbo.push_back({ globalEpoch.load(std::memory_order_relaxed), &elem });
+        if (limbo.size() >= collectThreshold) {
+            Collect(limbo);
+        }
+    }
+
+    // Reclaims elements retired before the oldest pinned epoch.
+    void Collect()
+    {
+        Collect(limbo);
+    }
+private:
+    void Collect(std::vector<Retired>& list)
+    {
+        globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto oldest = UINT64_MAX;
+        for (auto& slot : slots) {
+            auto epoch = slot.epoch.load(std::memory_order_relaxed);
+            if (epoch != 0 && epoch < oldest) {
+                oldest = epoch;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        std::size_t kept = 0;
+        for (auto& retired : list) {
+            if (retired.epoch < oldest) {
+                reclaim(*retired.elem);
+            } else {
+                list[kept++] = retired;
+            }
+        }
+        list.resize(kept);
+    }
+
+    Reclaim reclaim;
+    std::vector<Slot> slots;
+    std::size_t collectThreshold;
+    std::vector<Retired> limbo;
+    alignas(64) std::atomic<std::uint64_t> globalEpoch = 1;
+};
+
+}
+
+#endif // EPOCH_RECLAIMER_H
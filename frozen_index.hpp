@@ -0,0 +1,125 @@
+#ifndef FROZEN_INDEX_H
+#define FROZEN_INDEX_H
+
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "util.hpp"
+
+namespace container_test {
+
+// Read only snapshot of a sorted sequence of elements, e.g. of an AVLTree.
+// Keys are copied into an array in Eytzinger (BFS) order, searches descend
+// it without branches and prefetch the levels ahead, so a lookup costs a
+// single comparison per level and about one cache miss per four levels.
+// The elements are referenced, not copied, and have to outlive the index.
+template <
+    typename T,
+    typename Key,
+    typename KeyOf,
+    typename Less = std::less<Key>
+>
+class FrozenIndex {
+public:
+    FrozenIndex() :
+        keys(1),
+        elems(1, nullptr)
+    {}
+
+    // [first, last) has to be sorted by Less.
+    template <typename InputIt>
+    FrozenIndex(InputIt first, InputIt last)
+    {
+        std::vector<T*> sorted;
+        for (; first != last; ++first) {
+            sorted.push_back(std::addressof(*first));
+        }
+        auto size = sorted.size();
+        keys.resize(size + 1);
+        elems.resize(size + 1, nullptr);
+        std::size_t next = 0;
+        Fill(sorted, next, 1);
+    }
+
+    template <typename Range>
+    requires (!std::same_as<std::remove_cvref_t<Range>, FrozenIndex>)
+    explicit FrozenIndex(Range& sorted) :
+        FrozenIndex(begin(sorted), end(sorted))
+    {}
+
+    auto Size() const noexcept -> std::size_t
+    {
+        return elems.size() - 1;
+    }
+
+    bool Empty() const noexcept
+    {
+        return Size() == 0;
+    }
+
+    // First element not less than key, nullptr if there is none.
+    auto LowerBound(const Key& key) const -> T*
+    {
+        return elems[Search<false>(key)];
+    }
+
+    // First element greater than key, nullptr if there is none.
+    auto UpperBound(const Key& key) const -> T*
+    {
+        return elems[Search<true>(key)];
+    }
+
+    auto Find(const Key& key) const -> T*
+    {
+        Less less;
+        auto index = Search<false>(key);
+        return index != 0 && !less(key, keys[index]) ? elems[index] : nullptr;
+    }
+private:
+    // Keys of a cache line, prefetching that far ahead brings in the
+    // nodes four levels below for 4 byte keys.
+    static constexpr std::size_t PrefetchStride =
+        sizeof(Key) < 64 ? 64 / sizeof(Key) : 1;
+
+    void Fill(const std::vector<T*>& sorted, std::size_t& next, std::size_t k)
+    {
+        if (k >= keys.size()) {
+            return;
+        }
+        Fill(sorted, next, 2 * k);
+        keys[k] = KeyOf{}(*sorted[next]);
+        elems[k] = sorted[next];
+        ++next;
+        Fill(sorted, next, 2 * k + 1);
+    }
+
+    // Index of the first key not less (greater if upper) than key, 0 if
+    // there is none. The descent goes right on every step where the key is
+    // too small, the answer is the last node left by a left step, found by
+    // dropping the trailing right steps and the final left one.
+    template <bool upper>
+    auto Search(const Key& key) const -> std::size_t
+    {
+        Less less;
+        auto data = ptr_cast(keys.data());
+        auto size = keys.size();
+        std::size_t k = 1;
+        while (k < size) {
+            Prefetch(data + k * PrefetchStride * sizeof(Key));
+            bool right = upper ? !less(key, keys[k]) : less(keys[k], key);
+            k = 2 * k + right;
+        }
+        return k >> (std::countr_one(k) + 1);
+    }
+
+    std::vector<Key> keys;
+    std::vector<T*> elems;
+};
+
+}
+
+#endif // FROZEN_INDEX_H
@@ -0,0 +1,85 @@
+#include <compare>
+#include <cstddef>
+#include <vector>
+#include "avl_tree.hpp"
+#include "frozen_index.hpp"
+#include "test.hpp"
+
+using namespace container_test::intrusive;
+using container_test::FrozenIndex;
+using container_test::test::Check;
+
+namespace {
+
+struct Elem : AVLTreeNode<> {
+    int key;
+};
+
+struct Comp {
+    auto operator()(const Elem& a, const Elem& b) const
+    {
+        return a.key <=> b.key;
+    }
+    auto operator()(const Elem& a, int b) const
+    {
+        return a.key <=> b;
+    }
+};
+
+struct KeyOf {
+    auto operator()(const Elem& elem) const -> int
+    {
+        return elem.key;
+    }
+};
+
+using Tree = AVLTree<Elem, Comp>;
+using Index = FrozenIndex<Elem, int, KeyOf>;
+
+auto Pointer(Tree& tree, Tree::Iterator it) -> Elem*
+{
+    return it != tree.End() ? &*it : nullptr;
+}
+
+// Every key up to one past the largest, present or not, gives the same
+// element as the tree. Keys repeat once every step, so runs of equivalent
+// elements are covered as well.
+void TestSize(std::size_t size, int step)
+{
+    std::vector<Elem> elems(size);
+    Tree tree;
+    for (std::size_t i = 0; i != size; ++i) {
+        elems[i].key = int(i / 2) * step;
+        tree.Insert(elems[i]);
+    }
+    Index built(tree);
+    Index index(built);
+    Check(index.Size() == size && index.Empty() == (size == 0));
+    auto last = int(size / 2) * step + 1;
+    for (int key = -1; key <= last; ++key) {
+        Check(index.LowerBound(key) == Pointer(tree, tree.LowerBound(key)));
+        Check(index.UpperBound(key) == Pointer(tree, tree.UpperBound(key)));
+        // The tree finds any of the equivalent elements, the index the
+        // first one.
+        auto found = index.Find(key);
+        Check((found != nullptr) == (tree.Find(key) != tree.End()));
+        Check(found == nullptr || found == index.LowerBound(key));
+    }
+}
+
+}
+
+int main(int, char*[])
+{
+    Index empty;
+    Check(empty.Empty() && empty.LowerBound(0) == nullptr && empty.Find(0) == nullptr);
+    TestSize(0, 2);
+    TestSize(1, 2);
+    for (std::size_t size = 2; size <= (std::size_t(1) << 12); size *= 2) {
+        TestSize(size - 1, 2);
+        TestSize(size, 2);
+        TestSize(size + 1, 2);
+        TestSize(size + 1, 3);
+    }
+    return 0;
+}
@@ -0,0 +1,247 @@
+#ifndef HASH_INDEX_H
+#define HASH_INDEX_H
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "node.hpp"
+#include "slist_node.hpp"
+
+#define AddressOf (::std::addressof)
+
+namespace container_test::intrusive {
+
+// Hash set of unique keys chained through SListNode. Hash is called with
+// elements and with looked up keys, Equal with (key, element). Buckets are
+// doubled once there are as many elements as buckets.
+template <
+    typename T,
+    typename Hash,
+    typename Equal,
+    typename CastPolicyGen = BaseClassCastPolicy<SListNode<>, T>
+>
+class HashIndex : detail::ContainerNodeRequirments<T, CastPolicyGen> {
+public:
+    using CastPolicy = CastPolicyGen;
+    using NodeType = typename CastPolicyGen::NodeType;
+    using NodeTraits = SListNodeTraits<NodeType>;
+
+    class Iterator : public detail::BasicIterator<Iterator, T> {
+        friend class HashIndex;
+        Iterator(const HashIndex* index, std::size_t bucket, NodeType* node) noexcept :
+            index(index),
+            bucket(bucket),
+            node(node)
+        {}
+    public:
+        Iterator() noexcept :
+            index(nullptr),
+            bucket(0),
+            node(nullptr)
+        {}
+
+        auto operator++() noexcept -> Iterator&
+        {
+            node = NodeTraits::GetNext(*node);
+            if (node == nullptr) {
+                *this = index->FirstFrom(bucket + 1);
+            }
+            return *this;
+        }
+
+        T* operator->() const noexcept
+        {
+            return CastPolicy::FromNode(node);
+        }
+
+        bool operator==(const Iterator& oth) const noexcept
+        {
+            return node == oth.node;
+        }
+    private:
+        const HashIndex* index;
+        std::size_t bucket;
+        NodeType* node;
+    };
+
+    HashIndex() = default;
+
+    HashIndex(HashIndex&& oth) noexcept :
+        buckets(std::move(oth.buckets)),
+        size(std::exchange(oth.size, 0)),
+        shift(std::exchange(oth.shift, 64))
+    {
+        oth.buckets.clear();
+    }
+
+    HashIndex& operator=(HashIndex&& oth) noexcept
+    {
+        buckets = std::move(oth.buckets);
+        oth.buckets.clear();
+        size = std::exchange(oth.size, 0);
+        shift = std::exchange(oth.shift, 64);
+        return *this;
+    }
+
+    // Returns false and leaves elem unlinked if there is an element with an
+    // equal key.
+    bool Insert(T& elem)
+    {
+        using Tr = NodeTraits;
+        if (Find(elem) != End()) {
+            return false;
+        }
+        if (size == buckets.size()) {
+            Rehash(size == 0 ? 8 : size * 2);
+        }
+        auto node = CastPolicy::ToNode(AddressOf(elem));
+        auto& bucket = buckets[BucketOf(elem)];
+        Tr::SetNext(*node, bucket);
+        bucket = node;
+        ++size;
+        return true;
+    }
+
+    // elem has to be in the index.
+    void Erase(T& elem) noexcept
+    {
+        using Tr = NodeTraits;
+        auto node = CastPolicy::ToNode(AddressOf(elem));
+        auto& bucket = buckets[BucketOf(elem)];
+        if (bucket == node) {
+            bucket = Tr::GetNext(*node);
+        } else {
+            auto prev = bucket;
+            while (Tr::GetNext(*prev) != node) {
+                prev = Tr::GetNext(*prev);
+            }
+            Tr::SetNext(*prev, Tr::GetNext(*node));
+        }
+        --size;
+    }
+
+    template <typename KeyType>
+    requires std::predicate<Equal, const KeyType&, const T&>
+    auto Erase(const KeyType& key) -> std::size_t
+    {
+        auto it = Find(key);
+        if (it == End()) {
+            return 0;
+        }
+        Erase(*it);
+        return 1;
+    }
+
+    template <typename KeyType>
+    requires std::predicate<Equal, const KeyType&, const T&>
+    auto Find(const KeyType& key) const -> Iterator
+    {
+        using Tr = NodeTraits;
+        if (size == 0) {
+            return End();
+        }
+        Equal eq;
+        auto bucket = BucketOf(key);
+        for (auto node = buckets[bucket]; node != nullptr; node = Tr::GetNext(*node)) {
+            if (eq(key, *CastPolicy::FromNode(node))) {
+                return { this, bucket, node };
+            }
+        }
+        return End();
+    }
+
+    template <typename KeyType>
+    requires std::predicate<Equal, const KeyType&, const T&>
+    bool Contains(const KeyType& key) const
+    {
+        return Find(key) != End();
+    }
+
+    auto Begin() const noexcept -> Iterator
+    {
+        return FirstFrom(0);
+    }
+
+    friend auto begin(const HashIndex& index) noexcept -> Iterator
+    {
+        return index.Begin();
+    }
+
+    auto End() const noexcept -> Iterator
+    {
+        return {};
+    }
+
+    friend auto end(const HashIndex& index) noexcept -> Iterator
+    {
+        return index.End();
+    }
+
+    auto Size() const noexcept -> std::size_t
+    {
+        return size;
+    }
+
+    bool Empty() const noexcept
+    {
+        return size == 0;
+    }
+
+    // Unlinks every element, buckets are kept.
+    void Clear() noexcept
+    {
+        std::fill(buckets.begin(), buckets.end(), nullptr);
+        size = 0;
+    }
+private:
+    // Fibonacci hashing, the top bits of the product index the buckets, so
+    // identity hashes of sequential keys spread as well.
+    template <typename KeyType>
+    auto BucketOf(const KeyType& key) const -> std::size_t
+    {
+        auto hash = std::uint64_t(Hash{}(key)) * 0x9E3779B97F4A7C15ull;
+        return std::size_t(hash >> shift);
+    }
+
+    auto FirstFrom(std::size_t bucket) const noexcept -> Iterator
+    {
+        for (; bucket < buckets.size(); ++bucket) {
+            if (buckets[bucket] != nullptr) {
+                return { this, bucket, buckets[bucket] };
+            }
+        }
+        return End();
+    }
+
+    void Rehash(std::size_t count)
+    {
+        using Tr = NodeTraits;
+        std::vector<NodeType*> old(count, nullptr);
+        old.swap(buckets);
+        shift = 64 - std::countr_zero(count);
+        for (auto node : old) {
+            while (node != nullptr) {
+                auto next = Tr::GetNext(*node);
+                auto& bucket = buckets[BucketOf(*CastPolicy::FromNode(node))];
+                Tr::SetNext(*node, bucket);
+                bucket = node;
+                node = next;
+            }
+        }
+    }
+
+    std::vector<NodeType*> buckets;
+    std::size_t size = 0;
+    unsigned shift = 64;
+};
+
+}
+
+#undef AddressOf
+
+#endif // HASH_INDEX_H
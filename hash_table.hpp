@@ -8,6 +8,7 @@
 #include <utility>
 #include <type_traits>
 #include <tuple>
+#include "instrumentation.hpp"
 
 namespace container_test {
 
@@ -148,12 +149,18 @@ public:
 };
 }
 
-template <typename T, typename Hlp = std::pair<const size_t, T>>
+template <
+    typename T,
+    typename Hlp = std::pair<const size_t, T>,
+    typename InstrumentationGen = NullInstrumentation
+>
 class HashTable : private impl::HashTableStorage<Hlp> {
     using Base = impl::HashTableStorage<Hlp>;
     using ValueType = Hlp;
     using Iterator = typename Base::Iterator;
+    using Instrumentation = InstrumentationGen;
     std::size_t size;
+    [[no_unique_address]] Instrumentation instrumentation;
     static constexpr size_t InitialAllocate = 1024;
 public:
     HashTable() :
@@ -166,13 +173,16 @@ public:
         auto mask = Base::Size() - 1;
         std::size_t pos = hash & mask;
         std::size_t i = pos;
+        std::size_t probes = 0;
         do {
+            ++probes;
             if (Base::Emplace(i, hash, val)) {
                 ++size;
                 break;
             }
             i = (i + 1) & mask;
         } while (i != pos && Base::operator[](i).first != i);
+        instrumentation.OnProbe(probes);
     }
 
     T& operator[](std::size_t hash)
@@ -180,16 +190,20 @@ public:
         auto mask = Base::Size() - 1;
         std::size_t pos = hash & mask;
         std::size_t i = pos;
+        std::size_t probes = 0;
         do {
+            ++probes;
             if (!Base::PosIsOccupied(i)) {
                 break;
             }
             auto& elem = Base::operator[](i);
             if (elem.first == hash) {
+                instrumentation.OnProbe(probes);
                 return elem.second;
             }
             i = (i + 1) & mask;
         } while (i != pos && Base::operator[](i).first != i);
+        instrumentation.OnProbe(probes);
         Base::Emplace(i, std::piecewise_construct, std::make_tuple(hash), std::make_tuple());
         size++;
         return Base::operator[](i).second;
@@ -200,6 +214,10 @@ public:
         return size;
     }
 
+    auto GetInstrumentation() noexcept -> Instrumentation&
+    {
+        return instrumentation;
+    }
 };
 
 }
@@ -0,0 +1,97 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace container_test {
+
+// Instrumentation policies receive events of the containers they are
+// passed to, each container calls the hooks relevant to it:
+//   OnSearch(depth)       AVLTree lookup compared the key to depth nodes
+//   OnRotation(isDouble)  AVLTree single or double rotation
+//   OnRebalance(length)   AVLTree walked length nodes up after a change
+//   OnInsert(), OnErase() List and SList element linked or unlinked
+//   OnProbe(length)       HashTable lookup inspected length slots
+// Containers hold the policy as a member and expose it through
+// GetInstrumentation(). NullInstrumentation is the default, it is empty
+// and its hooks compile to nothing.
+struct NullInstrumentation {
+    constexpr void OnSearch(std::size_t) noexcept {}
+    constexpr void OnRotation(bool) noexcept {}
+    constexpr void OnRebalance(std::size_t) noexcept {}
+    constexpr void OnInsert() noexcept {}
+    constexpr void OnErase() noexcept {}
+    constexpr void OnProbe(std::size_t) noexcept {}
+};
+
+// Counts every event, lengths are also collected in histograms whose last
+// bucket holds all the longer ones. Not thread safe, same as containers.
+struct CountingInstrumentation {
+    static constexpr std::size_t HistogramSize = 64;
+
+    void OnSearch(std::size_t depth) noexcept
+    {
+        ++searches;
+        comparisons += depth;
+        ++searchDepths[Bucket(depth)];
+    }
+
+    void OnRotation(bool isDouble) noexcept
+    {
+        ++(isDouble ? doubleRotations : singleRotations);
+    }
+
+    void OnRebalance(std::size_t length) noexcept
+    {
+        ++rebalances;
+        rebalanceSteps += length;
+        ++rebalanceLengths[Bucket(length)];
+    }
+
+    void OnInsert() noexcept
+    {
+        ++inserts;
+    }
+
+    void OnErase() noexcept
+    {
+        ++erases;
+    }
+
+    void OnProbe(std::size_t length) noexcept
+    {
+        ++probes;
+        probeSteps += length;
+        ++probeLengths[Bucket(length)];
+    }
+
+    void Reset() noexcept
+    {
+        *this = CountingInstrumentation();
+    }
+
+    std::uint64_t searches = 0;
+    std::uint64_t comparisons = 0;
+    std::uint64_t searchDepths[HistogramSize] = {};
+    std::uint64_t singleRotations = 0;
+    std::uint64_t doubleRotations = 0;
+    std::uint64_t rebalances = 0;
+    std::uint64_t rebalanceSteps = 0;
+    std::uint64_t rebalanceLengths[HistogramSize] = {};
+    std::uint64_t inserts = 0;
+    std::uint64_t erases = 0;
+    std::uint64_t probes = 0;
+    std::uint64_t probeSteps = 0;
+    std::uint64_t probeLengths[HistogramSize] = {};
+private:
+    static auto Bucket(std::size_t length) noexcept -> std::size_t
+    {
+        return std::min(length, HistogramSize - 1);
+    }
+};
+
+}
+
+#endif // INSTRUMENTATION_H
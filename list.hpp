@@ -1,6 +1,7 @@
 #ifndef LIST_H
 #define LIST_H
 
+#include "instrumentation.hpp"
 #include "node.hpp"
 #include "list_node.hpp"
 
@@ -8,12 +9,17 @@
 
 namespace container_test::intrusive {
 
-template <typename T, typename CastPolicyGen = BaseClassCastPolicy<ListNode<>, T>>
+template <
+    typename T,
+    typename CastPolicyGen = BaseClassCastPolicy<ListNode<>, T>,
+    typename InstrumentationGen = NullInstrumentation
+>
 class List;
 
-template <typename T, typename CastPolicyGen>
+template <typename T, typename CastPolicyGen, typename InstrumentationGen>
 class List : detail::ContainerNodeRequirments<T, CastPolicyGen> {
     using CastPolicy = CastPolicyGen;
+    using Instrumentation = InstrumentationGen;
     using NodeType = typename CastPolicy::NodeType;
     using NodeTraits = ListNodeTraits<NodeType>;
 public:
@@ -23,13 +29,13 @@ public:
     public:
         Iterator& operator++() noexcept
         {
-            ptr = NodeTraits::GetNext(ptr);
+            ptr = NodeTraits::GetNext(*ptr);
             return *this;
         }
 
         Iterator& operator--() noexcept
         {
-            ptr = NodeTraits::GetPrev(ptr);
+            ptr = NodeTraits::GetPrev(*ptr);
             return *this;
         }
 
@@ -70,6 +76,7 @@ public:
         Tr::SetNext(*elem, next);
         Tr::SetNext(*prev, elem);
         Tr::SetPrev(*next, elem);
+        instrumentation.OnInsert();
         return { elem };
     }
 
@@ -77,10 +84,11 @@ public:
     {
         using Tr = NodeTraits;
         NodeType* elem = it.ptr;
-        NodeType* prev = Tr::GetPrev(elem);
-        NodeType* next = Tr::GetNext(elem);
+        NodeType* prev = Tr::GetPrev(*elem);
+        NodeType* next = Tr::GetNext(*elem);
         Tr::SetNext(*prev, next);
         Tr::SetPrev(*next, prev);
+        instrumentation.OnErase();
     }
 
     void Erase(T& ref)
@@ -126,9 +134,9 @@ public:
         return CastPolicy::ToNode(AddressOf(elem));
     }
 
-    bool Empty() noexcept
+    bool Empty() const noexcept
     {
-        return (Begin() != End());
+        return NodeTraits::GetNext(sentinel) == AddressOf(sentinel);
     }
 
     void Clear() noexcept
@@ -137,6 +145,11 @@ public:
         Tr::SetPrev(sentinel, AddressOf(sentinel));
         Tr::SetNext(sentinel, AddressOf(sentinel));
     }
+
+    auto GetInstrumentation() noexcept -> Instrumentation&
+    {
+        return instrumentation;
+    }
 private:
     void DoMove(List& oth) noexcept {
         if (oth.Empty()) {
@@ -147,9 +160,11 @@ private:
         sentinel = oth.sentinel;
         Tr::SetPrev(*(Begin().ptr), AddressOf(sentinel));
         Tr::SetNext(*((--End()).ptr), AddressOf(sentinel));
+        oth.Clear();
     }
 
     NodeType sentinel;
+    [[no_unique_address]] Instrumentation instrumentation;
 };
 
 }
@@ -1,6 +1,8 @@
 #ifndef LIST_NODE_H
 #define LIST_NODE_H
 
+#include "util.hpp"
+
 namespace container_test::intrusive {
 
 template <typename Tag = void>
@@ -15,6 +17,20 @@ struct ListNode<void> {
 template <typename Tag>
 struct ListNode : ListNode<> {};
 
+// Node with self-relative links, a list of such nodes stays valid when the
+// memory holding the list and its elements is mapped at another address.
+template <typename Tag = void>
+struct ListRelativeNode;
+
+template <>
+struct ListRelativeNode<void> {
+    RelativePtr<ListRelativeNode> prev;
+    RelativePtr<ListRelativeNode> next;
+};
+
+template <typename Tag>
+struct ListRelativeNode : ListRelativeNode<> {};
+
 template <typename T>
 struct ListNodeTraits;
 
@@ -22,14 +38,32 @@ template <typename T>
 struct ListNodeTraits<ListNode<T>> {
     using NodeType = ListNode<T>;
     using SentinelType = ListNode<T>;
-    static auto GetNext(NodeType& node) -> NodeType* {
-        return node.next;
+    static auto GetNext(const NodeType& node) -> NodeType* {
+        return static_cast<NodeType*>(node.next);
+    }
+    static void SetNext(NodeType& node, NodeType* next) {
+        node.next = next;
+    }
+    static auto GetPrev(const NodeType& node) -> NodeType* {
+        return static_cast<NodeType*>(node.prev);
+    }
+    static void SetPrev(NodeType& node, NodeType* prev) {
+        node.prev = prev;
+    }
+};
+
+template <typename T>
+struct ListNodeTraits<ListRelativeNode<T>> {
+    using NodeType = ListRelativeNode<T>;
+    using SentinelType = ListRelativeNode<T>;
+    static auto GetNext(const NodeType& node) -> NodeType* {
+        return static_cast<NodeType*>(node.next.Get());
     }
     static void SetNext(NodeType& node, NodeType* next) {
         node.next = next;
     }
-    static auto GetPrev(NodeType& node) -> NodeType* {
-        return node.prev;
+    static auto GetPrev(const NodeType& node) -> NodeType* {
+        return static_cast<NodeType*>(node.prev.Get());
     }
     static void SetPrev(NodeType& node, NodeType* prev) {
         node.prev = prev;
@@ -0,0 +1,150 @@
+#ifndef MULTI_INDEX_H
+#define MULTI_INDEX_H
+
+#include <concepts>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace container_test::intrusive {
+
+// How MultiIndex links an element into an index and out of it. Insert
+// returns false if the index refuses the element, as unique ones do for
+// duplicate keys. Indexes without Insert(elem), like List, get elements
+// appended. Specialize for containers that need something else.
+template <typename Index>
+struct MultiIndexTraits {
+    template <typename T>
+    static bool Insert(Index& index, T& elem)
+    {
+        if constexpr (requires { { index.Insert(elem) } -> std::same_as<bool>; }) {
+            return index.Insert(elem);
+        } else if constexpr (requires { index.Insert(elem); }) {
+            index.Insert(elem);
+            return true;
+        } else {
+            index.PushBack(elem);
+            return true;
+        }
+    }
+
+    template <typename T>
+    static void Erase(Index& index, T& elem)
+    {
+        index.Erase(elem);
+    }
+};
+
+// Several intrusive indexes over the same elements, for example an AVLTree
+// by key, a HashIndex by id and a List in LRU order. T derives from the
+// node of every index, each with its own tag, so an element is a single
+// allocation owned by the caller. Insert and Erase keep the indexes in
+// step, the indexes themselves are reached with Get for lookups.
+template <typename T, typename ... Indexes>
+class MultiIndex {
+    using IndexTuple = std::tuple<Indexes...>;
+public:
+    static constexpr std::size_t IndexCount = sizeof...(Indexes);
+
+    MultiIndex() = default;
+    MultiIndex(MultiIndex&&) = default;
+    MultiIndex& operator=(MultiIndex&&) = default;
+
+    // Links elem into every index or, if one of them refuses it, into none.
+    // If an index throws, elem is unlinked from the others before the
+    // exception propagates.
+    bool Insert(T& elem)
+    {
+        return InsertFrom<0>(elem);
+    }
+
+    // elem has to be in the indexes.
+    void Erase(T& elem)
+    {
+        EraseUpTo<IndexCount>(elem);
+    }
+
+    // Unlinks elem, calls f(elem) to change its keys and links it back.
+    // Returns false and leaves elem unlinked if an index refuses the new
+    // keys.
+    template <typename F>
+    requires std::invocable<F, T&>
+    bool Modify(T& elem, F&& f)
+    {
+        Erase(elem);
+        std::forward<F>(f)(elem);
+        return Insert(elem);
+    }
+
+    template <std::size_t I>
+    auto Get() noexcept -> std::tuple_element_t<I, IndexTuple>&
+    {
+        return std::get<I>(indexes);
+    }
+
+    template <std::size_t I>
+    auto Get() const noexcept -> const std::tuple_element_t<I, IndexTuple>&
+    {
+        return std::get<I>(indexes);
+    }
+
+    template <typename Index>
+    auto Get() noexcept -> Index&
+    {
+        return std::get<Index>(indexes);
+    }
+
+    template <typename Index>
+    auto Get() const noexcept -> const Index&
+    {
+        return std::get<Index>(indexes);
+    }
+
+    // Unlinks every element, elements stay with the caller.
+    void Clear() noexcept
+    {
+        std::apply([](auto& ... index) { (index.Clear(), ...); }, indexes);
+    }
+private:
+    template <std::size_t I>
+    bool InsertFrom(T& elem)
+    {
+        if constexpr (I == IndexCount) {
+            return true;
+        } else {
+            using Tr = MultiIndexTraits<std::tuple_element_t<I, IndexTuple>>;
+            auto& index = std::get<I>(indexes);
+            bool inserted;
+            try {
+                inserted = Tr::Insert(index, elem);
+            } catch (...) {
+                EraseUpTo<I>(elem);
+                throw;
+            }
+            if (!inserted) {
+                EraseUpTo<I>(elem);
+                return false;
+            }
+            return InsertFrom<I + 1>(elem);
+        }
+    }
+
+    template <std::size_t Count>
+    void EraseUpTo(T& elem)
+    {
+        [&]<std::size_t ... I>(std::index_sequence<I...>) {
+            (
+                MultiIndexTraits<std::tuple_element_t<I, IndexTuple>>::Erase(
+                    std::get<I>(indexes), elem
+                ), ...
+            );
+        }(std::make_index_sequence<Count>());
+    }
+
+    IndexTuple indexes;
+};
+
+}
+
+#endif // MULTI_INDEX_H
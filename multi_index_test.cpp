@@ -0,0 +1,251 @@
+#include <cstddef>
+#include <map>
+#include <new>
+#include <random>
+#include <utility>
+#include <vector>
+#include "avl_tree.hpp"
+#include "hash_index.hpp"
+#include "list.hpp"
+#include "multi_index.hpp"
+#include "test.hpp"
+
+using namespace container_test::intrusive;
+using container_test::test::Check;
+
+namespace {
+
+struct ByKey;
+struct ById;
+struct Lru;
+
+struct Record :
+    AVLTreeNode<ByKey>,
+    SListNode<ById>,
+    ListNode<Lru>
+{
+    int key;
+    int id;
+};
+
+struct KeyComp {
+    auto operator()(const Record& a, const Record& b) const
+    {
+        return a.key <=> b.key;
+    }
+};
+
+struct IdHash {
+    auto operator()(const Record& record) const -> std::size_t
+    {
+        return std::size_t(record.id);
+    }
+    auto operator()(int id) const -> std::size_t
+    {
+        return std::size_t(id);
+    }
+};
+
+struct IdEqual {
+    bool operator()(const Record& a, const Record& b) const
+    {
+        return a.id == b.id;
+    }
+    bool operator()(int id, const Record& b) const
+    {
+        return id == b.id;
+    }
+};
+
+using Tree = AVLTree<Record, KeyComp, BaseClassCastPolicy<AVLTreeNode<ByKey>, Record>>;
+using Hash = HashIndex<Record, IdHash, IdEqual, BaseClassCastPolicy<SListNode<ById>, Record>>;
+using Order = List<Record, BaseClassCastPolicy<ListNode<Lru>, Record>>;
+using Index = MultiIndex<Record, Tree, Hash, Order>;
+
+template <typename Container>
+auto Count(Container& container) -> std::size_t
+{
+    std::size_t count = 0;
+    for (auto& record : container) {
+        static_cast<void>(record);
+        ++count;
+    }
+    return count;
+}
+
+// Every index holds exactly the records of expected, id to key.
+void CheckIndex(Index& index, const std::map<int, int>& expected)
+{
+    auto& hash = index.Get<Hash>();
+    Check(hash.Size() == expected.size());
+    Check(Count(hash) == expected.size());
+    Check(Count(index.Get<Order>()) == expected.size());
+    std::size_t count = 0;
+    int last = 0;
+    for (auto& record : index.Get<Tree>()) {
+        Check(count == 0 || last <= record.key);
+        Check(expected.at(record.id) == record.key);
+        last = record.key;
+        ++count;
+    }
+    Check(count == expected.size());
+    for (auto [id, key] : expected) {
+        auto it = hash.Find(id);
+        Check(it != hash.End() && it->key == key);
+    }
+}
+
+// A duplicate id is refused by the hash index after the tree took it, the
+// tree has to give it back.
+void TestRollback()
+{
+    Index index;
+    Record a, b;
+    a.key = 1;
+    a.id = 7;
+    b.key = 2;
+    b.id = 7;
+    Check(index.Insert(a));
+    Check(!index.Insert(b));
+    CheckIndex(index, { { 7, 1 } });
+    b.id = 8;
+    Check(index.Insert(b));
+    CheckIndex(index, { { 7, 1 }, { 8, 2 } });
+}
+
+// Order that fails to link records with a negative key, as an index
+// running out of memory would.
+struct Throwing : Order {
+    void Insert(Record& record)
+    {
+        if (record.key < 0) {
+            throw std::bad_alloc();
+        }
+        PushBack(record);
+    }
+};
+
+// The tree and the hash index took the record before the last index
+// threw, both have to give it back.
+void TestThrow()
+{
+    MultiIndex<Record, Tree, Hash, Throwing> index;
+    Record a, b;
+    a.key = 1;
+    a.id = 1;
+    b.key = -1;
+    b.id = 2;
+    Check(index.Insert(a));
+    bool thrown = false;
+    try {
+        index.Insert(b);
+    } catch (const std::bad_alloc&) {
+        thrown = true;
+    }
+    Check(thrown);
+    auto& hash = index.Get<Hash>();
+    Check(hash.Size() == 1 && hash.Contains(1) && !hash.Contains(2));
+    Check(Count(index.Get<Tree>()) == 1 && Count(index.Get<Throwing>()) == 1);
+    b.key = 2;
+    Check(index.Insert(b));
+    Check(hash.Size() == 2 && Count(index.Get<Tree>()) == 2);
+}
+
+void TestModify()
+{
+    Index index;
+    Record a, b;
+    a.key = 1;
+    a.id = 1;
+    b.key = 2;
+    b.id = 2;
+    index.Insert(a);
+    index.Insert(b);
+    Check(index.Modify(a, [](Record& record) { record.key = 5; record.id = 3; }));
+    CheckIndex(index, { { 3, 5 }, { 2, 2 } });
+    Check(&*index.Get<Tree>().Begin() == &b);
+    // Taking the id of b leaves a out of every index.
+    Check(!index.Modify(a, [](Record& record) { record.id = 2; }));
+    CheckIndex(index, { { 2, 2 } });
+}
+
+void TestMove()
+{
+    Index index;
+    std::vector<Record> records(100);
+    std::map<int, int> expected;
+    for (std::size_t i = 0; i != records.size(); ++i) {
+        records[i].key = int(i % 10);
+        records[i].id = int(i);
+        index.Insert(records[i]);
+        expected[int(i)] = int(i % 10);
+    }
+    auto moved = std::move(index);
+    CheckIndex(moved, expected);
+    CheckIndex(index, {});
+    Record extra;
+    extra.key = 3;
+    extra.id = 1000;
+    Check(index.Insert(extra));
+    CheckIndex(index, { { 1000, 3 } });
+    CheckIndex(moved, expected);
+
+    auto& hash = moved.Get<Hash>();
+    Hash other = std::move(hash);
+    Check(hash.Empty() && !hash.Contains(5) && other.Contains(5));
+    hash = std::move(other);
+    Check(other.Empty() && hash.Size() == records.size());
+}
+
+// Random inserts, modifications and erasures against a map of id to key.
+void TestRandom()
+{
+    Index index;
+    std::vector<Record> records(2000);
+    std::vector<bool> linked(records.size());
+    std::map<int, int> expected;
+    std::mt19937 random(1);
+    for (int step = 0; step != 100000; ++step) {
+        auto i = random() % records.size();
+        auto& record = records[i];
+        if (!linked[i]) {
+            record.key = int(random() % 1000);
+            record.id = int(random() % 3000);
+            bool unique = expected.count(record.id) == 0;
+            Check(index.Insert(record) == unique);
+            if (unique) {
+                expected[record.id] = record.key;
+                linked[i] = true;
+            }
+        } else if (random() % 3 == 0) {
+            int id = int(random() % 3000);
+            expected.erase(record.id);
+            bool unique = expected.count(id) == 0;
+            Check(index.Modify(record, [&](Record& r) { r.id = id; }) == unique);
+            if (unique) {
+                expected[id] = record.key;
+            } else {
+                linked[i] = false;
+            }
+        } else {
+            index.Erase(record);
+            expected.erase(record.id);
+            linked[i] = false;
+        }
+    }
+    CheckIndex(index, expected);
+    index.Clear();
+    CheckIndex(index, {});
+}
+
+}
+
+int main(int, char*[])
+{
+    TestRollback();
+    TestThrow();
+    TestModify();
+    TestMove();
+    TestRandom();
+    return 0;
+}
@@ -13,11 +13,11 @@ class BasicNode {};
 template <typename NodeTypeArg, typename ItemType>
 struct BaseClassCastPolicy {
     using NodeType = NodeTypeArg;
-    static auto FromNode(NodeType* node) noexcept -> ItemType*
+    static constexpr auto FromNode(NodeType* node) noexcept -> ItemType*
     {
         return static_cast<ItemType*>(node);
     }
-    static auto ToNode(ItemType* item) noexcept -> NodeType*
+    static constexpr auto ToNode(ItemType* item) noexcept -> NodeType*
     {
         return static_cast<NodeType*>(item);
     }
@@ -40,19 +40,19 @@ template <typename T, detail::CastPolicy<T> CP>
 class ContainerNodeRequirments {};
 
 template <typename T>
-T* Deref(T* t) noexcept {
+constexpr T* Deref(T* t) noexcept {
     return t;
 }
 
 template <typename T>
-auto Deref(T&& t) -> decltype((Deref)(t.operator->()))
+constexpr auto Deref(T&& t) -> decltype((Deref)(t.operator->()))
 {
     return (Deref)(t.operator->());
 }
 
 template <typename T, typename ValueType>
 struct BasicIterator {
-    friend T operator++(BasicIterator& iter, int) noexcept
+    friend constexpr T operator++(BasicIterator& iter, int) noexcept
     {
         auto self = iter.Get();
         auto t = *self;
@@ -60,7 +60,7 @@ struct BasicIterator {
         return t;
     }
 
-    friend T operator--(BasicIterator& iter, int) noexcept
+    friend constexpr T operator--(BasicIterator& iter, int) noexcept
     requires(requires(T t) { --t; })
     {
         auto self = iter.Get();
@@ -69,17 +69,17 @@ struct BasicIterator {
         return t;
     }
 
-    auto operator*() const noexcept
+    constexpr auto operator*() const noexcept
         -> ValueType&
     {
         return *((detail::Deref)(*Get()));
     }
 private:
-    T* Get() noexcept
+    constexpr T* Get() noexcept
     {
         return static_cast<T*>(this);
     }
-    auto Get() const noexcept -> const T*
+    constexpr auto Get() const noexcept -> const T*
     {
         return static_cast<const T*>(this);
     }
@@ -107,11 +107,11 @@ struct OffsetCastPolicy {
 template <typename NodeTypeArg>
 struct IdentityCastPolicy {
     using NodeType = NodeTypeArg;
-    static auto FromNode(NodeType* node) noexcept -> NodeType*
+    static constexpr auto FromNode(NodeType* node) noexcept -> NodeType*
     {
         return node;
     }
-    static auto ToNode(NodeType* item) noexcept -> NodeType*
+    static constexpr auto ToNode(NodeType* item) noexcept -> NodeType*
     {
         return item;
     }
@@ -0,0 +1,189 @@
+#ifndef PAIRING_HEAP_H
+#define PAIRING_HEAP_H
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include "comparator.hpp"
+#include "node.hpp"
+#include "pairing_heap_node.hpp"
+
+#define AddressOf (::std::addressof)
+
+namespace container_test::intrusive {
+
+// Min-heap of elements ordered by Comp, the least element is on top. Push,
+// Top and Meld take O(1), Pop, DecreaseKey and Erase amortized O(log n).
+// Pop merges the children of the root in two passes, pairing them left to
+// right and then melding the pairs right to left.
+template <
+    typename T,
+    detail::Comparator<T> Comp,
+    typename CastPolicyGen = BaseClassCastPolicy<PairingHeapNode<>, T>
+>
+class PairingHeap : detail::ContainerNodeRequirments<T, CastPolicyGen> {
+public:
+    using CastPolicy = CastPolicyGen;
+    using NodeType = typename CastPolicyGen::NodeType;
+    using NodeTraits = PairingHeapNodeTraits<NodeType>;
+    using Less = typename ComparatorTraits<Comp>::Less;
+
+    PairingHeap() noexcept :
+        root(nullptr),
+        size(0)
+    {}
+
+    PairingHeap(PairingHeap&& oth) noexcept :
+        root(std::exchange(oth.root, nullptr)),
+        size(std::exchange(oth.size, 0))
+    {}
+
+    PairingHeap& operator=(PairingHeap&& oth) noexcept
+    {
+        root = std::exchange(oth.root, nullptr);
+        size = std::exchange(oth.size, 0);
+        return *this;
+    }
+
+    void Push(T& elem)
+    {
+        using Tr = NodeTraits;
+        auto node = CastPolicy::ToNode(AddressOf(elem));
+        Tr::SetChild(*node, nullptr);
+        root = Link(root, node);
+        ++size;
+    }
+
+    auto Top() const noexcept -> T&
+    {
+        return *CastPolicy::FromNode(root);
+    }
+
+    void Pop()
+    {
+        root = MergePairs(NodeTraits::GetChild(*root));
+        --size;
+    }
+
+    // Moves every element of oth to this heap.
+    void Meld(PairingHeap& oth)
+    {
+        root = Link(root, std::exchange(oth.root, nullptr));
+        size += std::exchange(oth.size, 0);
+    }
+
+    // Restores the order after the key of elem has been decreased.
+    void DecreaseKey(T& elem)
+    {
+        auto node = CastPolicy::ToNode(AddressOf(elem));
+        if (node == root) {
+            return;
+        }
+        Cut(node);
+        root = Link(root, node);
+    }
+
+    // elem has to be in the heap.
+    void Erase(T& elem)
+    {
+        auto node = CastPolicy::ToNode(AddressOf(elem));
+        if (node == root) {
+            Pop();
+            return;
+        }
+        Cut(node);
+        root = Link(root, MergePairs(NodeTraits::GetChild(*node)));
+        --size;
+    }
+
+    auto Size() const noexcept -> std::size_t
+    {
+        return size;
+    }
+
+    bool Empty() const noexcept
+    {
+        return root == nullptr;
+    }
+
+    void Clear() noexcept
+    {
+        root = nullptr;
+        size = 0;
+    }
+private:
+    // Makes the greater root the first child of the lesser one, equivalent
+    // elements keep a as the root.
+    static auto Link(NodeType* a, NodeType* b) -> NodeType*
+    {
+        using Tr = NodeTraits;
+        if (a == nullptr) {
+            return b;
+        }
+        if (b == nullptr) {
+            return a;
+        }
+        Less comp;
+        if (comp(*CastPolicy::FromNode(b), *CastPolicy::FromNode(a))) {
+            std::swap(a, b);
+        }
+        auto child = Tr::GetChild(*a);
+        Tr::SetNext(*b, child);
+        if (child != nullptr) {
+            Tr::SetPrev(*child, b);
+        }
+        Tr::SetPrev(*b, a);
+        Tr::SetChild(*a, b);
+        Tr::SetNext(*a, nullptr);
+        Tr::SetPrev(*a, nullptr);
+        return a;
+    }
+
+    // Detaches the subtree of a non-root node from its parent.
+    static void Cut(NodeType* node)
+    {
+        using Tr = NodeTraits;
+        auto prev = Tr::GetPrev(*node);
+        auto next = Tr::GetNext(*node);
+        if (Tr::GetChild(*prev) == node) {
+            Tr::SetChild(*prev, next);
+        } else {
+            Tr::SetNext(*prev, next);
+        }
+        if (next != nullptr) {
+            Tr::SetPrev(*next, prev);
+        }
+    }
+
+    // Melds a list of sibling subtrees into one, the pairs of the first
+    // pass are stacked through next so the second pass sees them reversed.
+    static auto MergePairs(NodeType* first) -> NodeType*
+    {
+        using Tr = NodeTraits;
+        NodeType* pairs = nullptr;
+        while (first != nullptr) {
+            auto second = Tr::GetNext(*first);
+            auto rest = second != nullptr ? Tr::GetNext(*second) : nullptr;
+            auto pair = Link(first, second);
+            Tr::SetNext(*pair, pairs);
+            pairs = pair;
+            first = rest;
+        }
+        NodeType* result = nullptr;
+        while (pairs != nullptr) {
+            auto next = Tr::GetNext(*pairs);
+            result = Link(pairs, result);
+            pairs = next;
+        }
+        return result;
+    }
+
+    NodeType* root;
+    std::size_t size;
+};
+
+}
+
+#undef AddressOf
+
+#endif // PAIRING_HEAP_H
@@ -0,0 +1,56 @@
+#ifndef PAIRING_HEAP_NODE_H
+#define PAIRING_HEAP_NODE_H
+
+namespace container_test::intrusive {
+
+// Children of a node form a doubly linked list from child through next.
+// prev of the first child points to the parent.
+template <typename Tag = void>
+struct PairingHeapNode;
+
+template <>
+struct PairingHeapNode<void> {
+    PairingHeapNode* child;
+    PairingHeapNode* next;
+    PairingHeapNode* prev;
+    PairingHeapNode() {};
+};
+
+template <typename Tag>
+struct PairingHeapNode : PairingHeapNode<> {};
+
+template <typename T>
+struct PairingHeapNodeTraits;
+
+template <typename T>
+struct PairingHeapNodeTraits<PairingHeapNode<T>> {
+    using NodeType = PairingHeapNode<T>;
+    static auto GetChild(NodeType& node) -> NodeType*
+    {
+        return static_cast<NodeType*>(node.child);
+    }
+    static void SetChild(NodeType& node, NodeType* child)
+    {
+        node.child = child;
+    }
+    static auto GetNext(NodeType& node) -> NodeType*
+    {
+        return static_cast<NodeType*>(node.next);
+    }
+    static void SetNext(NodeType& node, NodeType* next)
+    {
+        node.next = next;
+    }
+    static auto GetPrev(NodeType& node) -> NodeType*
+    {
+        return static_cast<NodeType*>(node.prev);
+    }
+    static void SetPrev(NodeType& node, NodeType* prev)
+    {
+        node.prev = prev;
+    }
+};
+
+}
+
+#endif // PAIRING_HEAP_NODE_H
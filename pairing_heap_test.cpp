@@ -0,0 +1,135 @@
+#include <cstddef>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "pairing_heap.hpp"
+#include "test.hpp"
+
+using container_test::intrusive::PairingHeap;
+using container_test::intrusive::PairingHeapNode;
+using container_test::test::Check;
+
+namespace {
+
+struct Event : PairingHeapNode<> {
+    long key;
+    std::size_t index;
+};
+
+struct Comp {
+    bool operator()(const Event& a, const Event& b) const
+    {
+        return a.key < b.key;
+    }
+};
+
+using Heap = PairingHeap<Event, Comp>;
+using Expected = std::multiset<std::pair<long, std::size_t>>;
+
+void CheckTop(Heap& heap, const Expected& expected)
+{
+    Check(heap.Size() == expected.size());
+    Check(heap.Empty() == expected.empty());
+    if (!expected.empty()) {
+        Check(heap.Top().key == expected.begin()->first);
+    }
+}
+
+// Random operations against a multiset of (key, index).
+void TestRandom(unsigned seed)
+{
+    std::mt19937 random(seed);
+    std::vector<Event> events(3000);
+    std::vector<bool> queued(events.size());
+    Heap heap;
+    Expected expected;
+    for (std::size_t i = 0; i != events.size(); ++i) {
+        events[i].index = i;
+    }
+    auto pop = [&] {
+        auto& top = heap.Top();
+        expected.erase(expected.find({ top.key, top.index }));
+        queued[top.index] = false;
+        heap.Pop();
+    };
+    for (int step = 0; step != 300000; ++step) {
+        auto& event = events[random() % events.size()];
+        switch (random() % 6) {
+        case 0: case 1:
+            if (!queued[event.index]) {
+                event.key = long(random() % 100000);
+                heap.Push(event);
+                expected.insert({ event.key, event.index });
+                queued[event.index] = true;
+            }
+            break;
+        case 2:
+            if (!heap.Empty()) {
+                pop();
+            }
+            break;
+        case 3:
+            if (queued[event.index]) {
+                expected.erase({ event.key, event.index });
+                event.key -= long(random() % 1000);
+                expected.insert({ event.key, event.index });
+                heap.DecreaseKey(event);
+            }
+            break;
+        case 4:
+            if (queued[event.index]) {
+                expected.erase({ event.key, event.index });
+                heap.Erase(event);
+                queued[event.index] = false;
+            }
+            break;
+        default:
+            if (step % 1000 == 0) {
+                Heap first, second;
+                first.Meld(heap);
+                Check(heap.Empty() && heap.Size() == 0);
+                second.Meld(first);
+                heap.Meld(second);
+            }
+        }
+        CheckTop(heap, expected);
+    }
+    while (!heap.Empty()) {
+        pop();
+        CheckTop(heap, expected);
+    }
+    Check(expected.empty());
+}
+
+// Two heaps built apart pop as one after Meld, and a moved heap keeps its
+// elements while the source is left empty.
+void TestMeldAndMove()
+{
+    std::vector<Event> events(100);
+    Heap odd, even;
+    for (std::size_t i = 0; i != events.size(); ++i) {
+        events[i].key = long(events.size() - i);
+        events[i].index = i;
+        (i % 2 != 0 ? odd : even).Push(events[i]);
+    }
+    odd.Meld(even);
+    Check(even.Empty() && odd.Size() == events.size());
+    Heap moved(std::move(odd));
+    Check(odd.Empty());
+    for (long key = 1; key <= long(events.size()); ++key) {
+        Check(moved.Top().key == key);
+        moved.Pop();
+    }
+    Check(moved.Empty());
+}
+
+}
+
+int main(int, char*[])
+{
+    TestRandom(1);
+    TestRandom(2);
+    TestMeldAndMove();
+    return 0;
+}
@@ -0,0 +1,283 @@
+#ifndef PERSISTENT_AVL_TREE_H
+#define PERSISTENT_AVL_TREE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <utility>
+#include "comparator.hpp"
+
+namespace container_test {
+
+// Ordered set of values where copying is an O(1) snapshot. Versions share
+// nodes, an update copies only the nodes on its path that are shared with
+// another version, unshared nodes are updated in place. Nodes are
+// reference counted, a version may be destroyed on any thread while others
+// are used. A single version is not safe to be modified concurrently.
+template <typename T, intrusive::detail::Comparator<T> Comp>
+class PersistentAVLTree {
+    struct Node {
+        T value;
+        Node* children[2];
+        int height;
+        std::atomic<std::size_t> refs;
+    };
+public:
+    using ThreeWay = typename intrusive::ComparatorTraits<Comp>::ThreeWay;
+
+    PersistentAVLTree() :
+        root(nullptr),
+        size(0)
+    {}
+
+    PersistentAVLTree(const PersistentAVLTree& oth) :
+        root(Retain(oth.root)),
+        size(oth.size)
+    {}
+
+    PersistentAVLTree(PersistentAVLTree&& oth) noexcept :
+        root(std::exchange(oth.root, nullptr)),
+        size(std::exchange(oth.size, 0))
+    {}
+
+    PersistentAVLTree& operator=(PersistentAVLTree oth) noexcept
+    {
+        std::swap(root, oth.root);
+        std::swap(size, oth.size);
+        return *this;
+    }
+
+    ~PersistentAVLTree()
+    {
+        Release(root);
+    }
+
+    auto Snapshot() const -> PersistentAVLTree
+    {
+        return *this;
+    }
+
+    // Returns false if an equivalent value is already present.
+    bool Insert(T value)
+    {
+        if (Find(value) != nullptr) {
+            return false;
+        }
+        root = InsertInto(root, value);
+        ++size;
+        return true;
+    }
+
+    template <typename KeyType>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    bool Erase(const KeyType& key)
+    {
+        if (Find(key) == nullptr) {
+            return false;
+        }
+        root = EraseFrom(root, key);
+        --size;
+        return true;
+    }
+
+    template <typename KeyType>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    auto Find(const KeyType& key) const -> const T*
+    {
+        ThreeWay comp;
+        auto node = root;
+        while (node != nullptr) {
+            auto order = comp(key, node->value);
+            if (order == 0) {
+                return &node->value;
+            }
+            node = node->children[order > 0];
+        }
+        return nullptr;
+    }
+
+    // First value not less than key, nullptr if there is none.
+    template <typename KeyType>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    auto LowerBound(const KeyType& key) const -> const T*
+    {
+        ThreeWay comp;
+        const T* result = nullptr;
+        auto node = root;
+        while (node != nullptr) {
+            bool right = comp(key, node->value) > 0;
+            if (!right) {
+                result = &node->value;
+            }
+            node = node->children[right];
+        }
+        return result;
+    }
+
+    // Calls f for every value in order.
+    template <typename F>
+    void ForEach(F&& f) const
+    {
+        Visit(root, f);
+    }
+
+    auto Size() const noexcept -> std::size_t
+    {
+        return size;
+    }
+
+    bool Empty() const noexcept
+    {
+        return root == nullptr;
+    }
+private:
+    static auto Retain(Node* node) -> Node*
+    {
+        if (node != nullptr) {
+            node->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        return node;
+    }
+
+    // Depth of the recursion is bounded by the height of the version.
+    static void Release(Node* node)
+    {
+        if (
+            node == nullptr ||
+            node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1
+        ) {
+            return;
+        }
+        Release(node->children[0]);
+        Release(node->children[1]);
+        delete node;
+    }
+
+    // Takes a reference to node and returns a node that is referenced
+    // only by the caller, a copy if node is shared.
+    static auto Unshare(Node* node) -> Node*
+    {
+        if (node->refs.load(std::memory_order_acquire) == 1) {
+            return node;
+        }
+        auto copy = new Node{
+            node->value,
+            { Retain(node->children[0]), Retain(node->children[1]) },
+            node->height,
+            1
+        };
+        Release(node);
+        return copy;
+    }
+
+    static int Height(Node* node)
+    {
+        return node != nullptr ? node->height : 0;
+    }
+
+    static void UpdateHeight(Node* node)
+    {
+        node->height = std::max(
+            Height(node->children[0]), Height(node->children[1])
+        ) + 1;
+    }
+
+    // Lifts the child opposite to right, node is referenced only by the
+    // caller.
+    static auto Rotate(Node* node, bool right) -> Node*
+    {
+        auto child = Unshare(node->children[!right]);
+        node->children[!right] = child->children[right];
+        child->children[right] = node;
+        UpdateHeight(node);
+        UpdateHeight(child);
+        return child;
+    }
+
+    static auto Rebalance(Node* node) -> Node*
+    {
+        UpdateHeight(node);
+        int balance = Height(node->children[0]) - Height(node->children[1]);
+        if (std::abs(balance) < 2) {
+            return node;
+        }
+        bool right = balance > 0;
+        auto& child = node->children[!right];
+        int childBalance = Height(child->children[0]) - Height(child->children[1]);
+        if ((childBalance > 0) != right && childBalance != 0) {
+            child = Rotate(Unshare(child), !right);
+        }
+        return Rotate(node, right);
+    }
+
+    // Take a reference to node and return one to the updated subtree.
+    static auto InsertInto(Node* node, T& value) -> Node*
+    {
+        if (node == nullptr) {
+            return new Node{ std::move(value), { nullptr, nullptr }, 1, 1 };
+        }
+        ThreeWay comp;
+        bool right = comp(value, node->value) > 0;
+        node = Unshare(node);
+        node->children[right] = InsertInto(node->children[right], value);
+        return Rebalance(node);
+    }
+
+    template <typename KeyType>
+    static auto EraseFrom(Node* node, const KeyType& key) -> Node*
+    {
+        ThreeWay comp;
+        auto order = comp(key, node->value);
+        if (order != 0) {
+            node = Unshare(node);
+            bool right = order > 0;
+            node->children[right] = EraseFrom(node->children[right], key);
+            return Rebalance(node);
+        }
+        for (bool right : { false, true }) {
+            if (node->children[right] == nullptr) {
+                auto rest = Retain(node->children[!right]);
+                Release(node);
+                return rest;
+            }
+        }
+        node = Unshare(node);
+        node->children[1] = EraseMin(node->children[1], node->value);
+        return Rebalance(node);
+    }
+
+    static auto EraseMin(Node* node, T& value) -> Node*
+    {
+        if (node->children[0] == nullptr) {
+            auto rest = Retain(node->children[1]);
+            if (node->refs.load(std::memory_order_acquire) == 1) {
+                value = std::move(node->value);
+            } else {
+                value = node->value;
+            }
+            Release(node);
+            return rest;
+        }
+        node = Unshare(node);
+        node->children[0] = EraseMin(node->children[0], value);
+        return Rebalance(node);
+    }
+
+    template <typename F>
+    static void Visit(const Node* node, F& f)
+    {
+        while (node != nullptr) {
+            Visit(node->children[0], f);
+            f(node->value);
+            node = node->children[1];
+        }
+    }
+
+    Node* root;
+    std::size_t size;
+};
+
+}
+
+#endif // PERSISTENT_AVL_TREE_H
@@ -0,0 +1,154 @@
+#include <compare>
+#include <cstddef>
+#include <random>
+#include <set>
+#include <vector>
+#include "persistent_avl_tree.hpp"
+#include "test.hpp"
+
+using container_test::PersistentAVLTree;
+using container_test::test::Check;
+
+namespace {
+
+// Counts live values, every node holds one, so no live value is left once
+// every version is gone if no node leaked.
+struct Value {
+    static inline long live = 0;
+
+    explicit Value(int key) :
+        key(key)
+    {
+        ++live;
+    }
+
+    Value(const Value& oth) :
+        key(oth.key)
+    {
+        ++live;
+    }
+
+    Value& operator=(const Value&) = default;
+
+    ~Value()
+    {
+        --live;
+    }
+
+    int key;
+};
+
+struct Comp {
+    auto operator()(const Value& a, const Value& b) const
+    {
+        return a.key <=> b.key;
+    }
+    auto operator()(const Value& a, int b) const
+    {
+        return a.key <=> b;
+    }
+};
+
+using Tree = PersistentAVLTree<Value, Comp>;
+
+struct Version {
+    Tree tree;
+    std::set<int> expected;
+};
+
+void CheckVersion(const Version& version)
+{
+    auto& tree = version.tree;
+    Check(tree.Size() == version.expected.size());
+    auto it = version.expected.begin();
+    tree.ForEach([&](const Value& value) {
+        Check(it != version.expected.end() && *it == value.key);
+        ++it;
+    });
+    Check(it == version.expected.end());
+    for (int key = 0; key < 64; key += 7) {
+        auto found = tree.Find(key);
+        Check((found != nullptr) == (version.expected.count(key) != 0));
+        auto lower = tree.LowerBound(key);
+        auto expected = version.expected.lower_bound(key);
+        Check(lower == nullptr
+            ? expected == version.expected.end()
+            : expected != version.expected.end() && lower->key == *expected);
+    }
+}
+
+// Versions are snapshots of each other, every one is updated on its own
+// and has to keep exactly its own contents.
+void TestSnapshots(unsigned seed)
+{
+    std::mt19937 random(seed);
+    {
+        std::vector<Version> versions(1);
+        for (int step = 0; step != 20000; ++step) {
+            auto& version = versions[random() % versions.size()];
+            auto key = int(random() % 64);
+            switch (random() % 8) {
+            case 0:
+                if (versions.size() < 32) {
+                    auto copy = version.tree.Snapshot();
+                    auto expected = version.expected;
+                    versions.push_back({ std::move(copy), std::move(expected) });
+                }
+                break;
+            case 1:
+                if (&version != &versions.back()) {
+                    version = std::move(versions.back());
+                    versions.pop_back();
+                }
+                break;
+            case 2: case 3: case 4:
+                Check(version.tree.Insert(Value(key)) == version.expected.insert(key).second);
+                break;
+            default:
+                Check(version.tree.Erase(key) == (version.expected.erase(key) != 0));
+            }
+            if (step % 100 == 0) {
+                for (auto& each : versions) {
+                    CheckVersion(each);
+                }
+            }
+        }
+        for (auto& version : versions) {
+            CheckVersion(version);
+        }
+    }
+    Check(Value::live == 0);
+}
+
+// The source and a snapshot diverge, neither sees the other's updates.
+void TestDiverge()
+{
+    {
+        Tree source;
+        for (int key = 0; key != 100; ++key) {
+            source.Insert(Value(key));
+        }
+        auto snapshot = source.Snapshot();
+        for (int key = 0; key != 100; key += 2) {
+            source.Erase(key);
+        }
+        source.Insert(Value(1000));
+        snapshot.Insert(Value(-1));
+        snapshot.Erase(51);
+        Check(source.Size() == 51 && snapshot.Size() == 100);
+        Check(source.Find(0) == nullptr && snapshot.Find(0) != nullptr);
+        Check(source.Find(51) != nullptr && snapshot.Find(51) == nullptr);
+        Check(source.Find(-1) == nullptr && snapshot.Find(1000) == nullptr);
+    }
+    Check(Value::live == 0);
+}
+
+}
+
+int main(int, char*[])
+{
+    TestDiverge();
+    TestSnapshots(1);
+    TestSnapshots(2);
+    return 0;
+}
@@ -0,0 +1,243 @@
+#ifndef RANGE_SET_H
+#define RANGE_SET_H
+
+#include <algorithm>
+#include <compare>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include "avl_tree.hpp"
+
+#define AddressOf (::std::addressof)
+
+namespace container_test {
+
+// Set of disjoint half open ranges [begin, end). Inserted ranges merge with
+// the ranges they overlap or touch, erased ones cut the ranges they overlap
+// and split a range they fall inside. Ranges are kept in an AVLTree
+// augmented with gaps, so every operation is O(log n), amortized over the
+// ranges a merge absorbs. Nodes of absorbed and erased ranges are kept in a
+// pool for later insertions instead of being freed, chained through their
+// left child link.
+template <typename Key, typename Allocator = std::allocator<Key>>
+class RangeSet {
+public:
+    struct Range : intrusive::AVLTreeGapNode<Key> {};
+private:
+    struct ByEnd {
+        const Key& key;
+    };
+
+    struct Comp {
+        auto operator()(const Range& a, const Range& b) const
+        {
+            return a.begin <=> b.begin;
+        }
+        auto operator()(const Range& a, const Key& b) const
+        {
+            return a.begin <=> b;
+        }
+        auto operator()(const Range& a, ByEnd b) const
+        {
+            return a.end <=> b.key;
+        }
+    };
+
+    using Tree = intrusive::AVLTree<
+        Range, Comp,
+        intrusive::BaseClassCastPolicy<intrusive::AVLTreeGapNode<Key>, Range>
+    >;
+    using NodeTraits = typename Tree::NodeTraits;
+public:
+    using Iterator = typename Tree::ConstIterator;
+
+    RangeSet() = default;
+
+    explicit RangeSet(const Allocator& allocator) :
+        allocator(allocator)
+    {}
+
+    RangeSet(const RangeSet&) = delete;
+    RangeSet& operator=(const RangeSet&) = delete;
+
+    ~RangeSet()
+    {
+        Clear();
+        while (pool != nullptr) {
+            Delete(*std::exchange(pool, Next(*pool)));
+        }
+    }
+
+    // Adds [begin, end), merged with the ranges it overlaps or touches.
+    void Insert(const Key& begin, const Key& end)
+    {
+        if (!(begin < end)) {
+            return;
+        }
+        auto first = tree.LowerBound(ByEnd{ begin });
+        if (first == tree.End() || end < first->begin) {
+            tree.Insert(New(begin, end));
+            return;
+        }
+        auto& merged = *first++;
+        auto newEnd = std::max(end, merged.end);
+        while (first != tree.End() && !(end < first->begin)) {
+            newEnd = std::max(newEnd, first->end);
+            auto& range = *first;
+            first = tree.Erase(first);
+            Release(range);
+        }
+        merged.begin = std::min(begin, merged.begin);
+        merged.end = newEnd;
+        tree.Refresh(tree.IteratorTo(merged));
+    }
+
+    // Removes [begin, end) from the set.
+    void Erase(const Key& begin, const Key& end)
+    {
+        if (!(begin < end)) {
+            return;
+        }
+        auto first = tree.UpperBound(ByEnd{ begin });
+        if (first == tree.End() || !(first->begin < end)) {
+            return;
+        }
+        if (first->begin < begin) {
+            auto& head = *first;
+            if (end < head.end) {
+                auto& tail = New(end, head.end);
+                head.end = begin;
+                tree.Refresh(first);
+                tree.Insert(tail);
+                return;
+            }
+            head.end = begin;
+            tree.Refresh(first);
+            ++first;
+        }
+        while (first != tree.End() && !(end < first->end)) {
+            auto& range = *first;
+            first = tree.Erase(first);
+            Release(range);
+        }
+        if (first != tree.End() && first->begin < end) {
+            first->begin = end;
+            tree.Refresh(first);
+        }
+    }
+
+    bool Contains(const Key& point) const
+    {
+        auto& tr = Mutable().tree;
+        auto it = tr.UpperBound(ByEnd{ point });
+        return it != tr.End() && !(point < it->begin);
+    }
+
+    // True if [begin, end) is covered by a single range.
+    bool Contains(const Key& begin, const Key& end) const
+    {
+        auto& tr = Mutable().tree;
+        auto it = tr.UpperBound(ByEnd{ begin });
+        return it != tr.End() && !(begin < it->begin) && !(it->end < end);
+    }
+
+    // Start of the first gap of at least length, counting the space before
+    // the first range from Key(). The end of the last range if no gap
+    // between ranges is wide enough.
+    auto FirstGap(const Key& length) const -> Key
+    {
+        auto& tr = Mutable().tree;
+        if (tr.Empty() || !(tr.Begin()->begin - Key() < length)) {
+            return Key();
+        }
+        return tr.FirstGap(length)->end;
+    }
+
+    auto Begin() const -> Iterator
+    {
+        return tree.Begin();
+    }
+
+    friend auto begin(const RangeSet& set) -> Iterator
+    {
+        return set.Begin();
+    }
+
+    auto End() const -> Iterator
+    {
+        return tree.End();
+    }
+
+    friend auto end(const RangeSet& set) -> Iterator
+    {
+        return set.End();
+    }
+
+    bool Empty() const
+    {
+        return tree.Empty();
+    }
+
+    // Nodes are kept for reuse.
+    void Clear()
+    {
+        while (!tree.Empty()) {
+            auto& range = *tree.Begin();
+            tree.Erase(tree.Begin());
+            Release(range);
+        }
+    }
+private:
+    auto Mutable() const -> RangeSet&
+    {
+        return const_cast<RangeSet&>(*this);
+    }
+
+    auto New(const Key& begin, const Key& end) -> Range&
+    {
+        Range* range;
+        if (pool != nullptr) {
+            range = std::exchange(pool, Next(*pool));
+        } else {
+            using A = typename std::allocator_traits<Allocator>::template rebind_alloc<Range>;
+            using Tr = std::allocator_traits<A>;
+            A alloc(allocator);
+            range = Tr::allocate(alloc, 1);
+            Tr::construct(alloc, range);
+        }
+        range->begin = begin;
+        range->end = end;
+        return *range;
+    }
+
+    static auto Next(Range& range) -> Range*
+    {
+        return static_cast<Range*>(NodeTraits::GetChild(range, 0));
+    }
+
+    // range has to be out of the tree.
+    void Release(Range& range)
+    {
+        NodeTraits::SetChild(range, 0, pool);
+        pool = AddressOf(range);
+    }
+
+    void Delete(Range& range)
+    {
+        using A = typename std::allocator_traits<Allocator>::template rebind_alloc<Range>;
+        using Tr = std::allocator_traits<A>;
+        A alloc(allocator);
+        Tr::destroy(alloc, AddressOf(range));
+        Tr::deallocate(alloc, AddressOf(range), 1);
+    }
+
+    Tree tree;
+    Range* pool = nullptr;
+    [[no_unique_address]] Allocator allocator;
+};
+
+}
+
+#undef AddressOf
+
+#endif // RANGE_SET_H
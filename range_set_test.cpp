@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+#include "range_set.hpp"
+#include "test.hpp"
+
+using container_test::RangeSet;
+using container_test::test::Check;
+
+namespace {
+
+// Counts the nodes allocated and not yet freed.
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    explicit CountingAllocator(std::size_t& live) :
+        live(&live)
+    {}
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) :
+        live(other.live)
+    {}
+
+    auto allocate(std::size_t n) -> T*
+    {
+        *live += n;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        *live -= n;
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    std::size_t* live;
+};
+
+using Set = RangeSet<unsigned, CountingAllocator<unsigned>>;
+using Ranges = std::vector<std::pair<unsigned, unsigned>>;
+
+void CheckRanges(const Set& set, const Ranges& expected)
+{
+    auto range = expected.begin();
+    for (auto& each : set) {
+        Check(range != expected.end() && each.begin == range->first && each.end == range->second);
+        ++range;
+    }
+    Check(range == expected.end() && set.Empty() == expected.empty());
+}
+
+// Maximal runs of covered points, the ranges the set has to hold.
+auto Runs(const std::vector<bool>& covered) -> Ranges
+{
+    Ranges runs;
+    for (unsigned i = 0; i != covered.size(); ++i) {
+        if (!covered[i]) {
+            continue;
+        }
+        if (!runs.empty() && runs.back().second == i) {
+            ++runs.back().second;
+        } else {
+            runs.push_back({ i, i + 1 });
+        }
+    }
+    return runs;
+}
+
+void TestInsert()
+{
+    std::size_t live = 0;
+    Set set{ CountingAllocator<unsigned>(live) };
+    set.Insert(10, 20);
+    set.Insert(5, 5);
+    set.Insert(30, 40);
+    set.Insert(50, 60);
+    CheckRanges(set, { { 10, 20 }, { 30, 40 }, { 50, 60 } });
+    // Overlapping the left neighbour, then the right one.
+    set.Insert(15, 25);
+    set.Insert(45, 55);
+    CheckRanges(set, { { 10, 25 }, { 30, 40 }, { 45, 60 } });
+    // Touching on either side.
+    set.Insert(25, 27);
+    set.Insert(43, 45);
+    CheckRanges(set, { { 10, 27 }, { 30, 40 }, { 43, 60 } });
+    // Filling the gaps to both neighbours, overlapping and touching.
+    set.Insert(26, 30);
+    set.Insert(40, 43);
+    CheckRanges(set, { { 10, 60 } });
+    // Covering several ranges and extending both ends.
+    set.Insert(70, 80);
+    set.Insert(90, 100);
+    set.Insert(5, 105);
+    CheckRanges(set, { { 5, 105 } });
+    // Inside an existing range.
+    set.Insert(20, 30);
+    CheckRanges(set, { { 5, 105 } });
+}
+
+void TestErase()
+{
+    std::size_t live = 0;
+    Set set{ CountingAllocator<unsigned>(live) };
+    set.Insert(10, 50);
+    // Splits the range.
+    set.Erase(20, 30);
+    CheckRanges(set, { { 10, 20 }, { 30, 50 } });
+    // Trims the end of one and the start of the next.
+    set.Erase(15, 35);
+    CheckRanges(set, { { 10, 15 }, { 35, 50 } });
+    // Touching without overlap changes nothing.
+    set.Erase(15, 35);
+    set.Erase(0, 10);
+    set.Erase(50, 60);
+    set.Erase(40, 40);
+    CheckRanges(set, { { 10, 15 }, { 35, 50 } });
+    // Exactly a range, then a start and an end.
+    set.Erase(10, 15);
+    set.Erase(35, 37);
+    set.Erase(48, 50);
+    CheckRanges(set, { { 37, 48 } });
+    set.Insert(60, 70);
+    set.Insert(80, 90);
+    // Covering some ranges and cutting the last.
+    set.Erase(0, 85);
+    CheckRanges(set, { { 85, 90 } });
+}
+
+void TestContains()
+{
+    std::size_t live = 0;
+    Set set{ CountingAllocator<unsigned>(live) };
+    Check(!set.Contains(0u) && !set.Contains(0u, 1u));
+    set.Insert(10, 20);
+    set.Insert(30, 40);
+    Check(!set.Contains(9u) && set.Contains(10u) && set.Contains(19u) && !set.Contains(20u));
+    Check(!set.Contains(25u) && set.Contains(30u) && !set.Contains(40u));
+    Check(set.Contains(10u, 20u) && set.Contains(12u, 15u) && set.Contains(30u, 40u));
+    Check(!set.Contains(9u, 15u) && !set.Contains(15u, 21u) && !set.Contains(15u, 35u));
+}
+
+void TestFirstGap()
+{
+    std::size_t live = 0;
+    Set set{ CountingAllocator<unsigned>(live) };
+    Check(set.FirstGap(10) == 0);
+    set.Insert(4, 6);
+    // The space before the first range, exactly as wide and one less.
+    Check(set.FirstGap(4) == 0 && set.FirstGap(5) == 6);
+    set.Insert(0, 2);
+    set.Insert(9, 10);
+    set.Insert(14, 20);
+    set.Insert(25, 30);
+    // Gaps of 2, 3, 4 and 5.
+    Check(set.FirstGap(1) == 2 && set.FirstGap(2) == 2);
+    Check(set.FirstGap(3) == 6 && set.FirstGap(4) == 10 && set.FirstGap(5) == 20);
+    // No gap wide enough, the end of the last range.
+    Check(set.FirstGap(6) == 30);
+    set.Insert(20, 25);
+    Check(set.FirstGap(5) == 30);
+}
+
+// Absorbed, erased and cleared ranges are taken back before allocating,
+// and the pool is freed with the set.
+void TestReuse()
+{
+    std::size_t live = 0;
+    {
+        Set set{ CountingAllocator<unsigned>(live) };
+        for (unsigned i = 0; i != 8; ++i) {
+            set.Insert(i * 10, i * 10 + 5);
+        }
+        Check(live == 8);
+        set.Insert(0, 80);
+        CheckRanges(set, { { 0, 80 } });
+        Check(live == 8);
+        for (unsigned i = 0; i != 7; ++i) {
+            set.Erase(i * 10 + 5, i * 10 + 10);
+        }
+        Check(live == 8);
+        set.Erase(0, 100);
+        set.Insert(0, 1);
+        set.Insert(20, 21);
+        Check(live == 8);
+        set.Clear();
+        Check(set.Empty());
+        for (unsigned i = 0; i != 9; ++i) {
+            set.Insert(i * 3, i * 3 + 1);
+        }
+        Check(live == 9);
+    }
+    Check(live == 0);
+}
+
+// Random insertions and erasures of small ranges against a set of points.
+void TestRandom(unsigned seed)
+{
+    constexpr unsigned Points = 200;
+    std::mt19937 random(seed);
+    std::size_t live = 0;
+    {
+        Set set{ CountingAllocator<unsigned>(live) };
+        std::vector<bool> covered(Points);
+        for (int step = 0; step != 20000; ++step) {
+            auto begin = unsigned(random() % Points);
+            auto end = std::min(Points, begin + unsigned(random() % 12));
+            bool insert = random() % 2 == 0;
+            if (insert) {
+                set.Insert(begin, end);
+            } else {
+                set.Erase(begin, end);
+            }
+            for (auto i = begin; i != end; ++i) {
+                covered[i] = insert;
+            }
+            auto runs = Runs(covered);
+            CheckRanges(set, runs);
+            Check(live >= runs.size());
+            auto point = unsigned(random() % Points);
+            Check(set.Contains(point) == covered[point]);
+            auto width = unsigned(random() % 6);
+            Check(set.FirstGap(width) == [&] {
+                if (runs.empty() || runs.front().first >= width) {
+                    return 0u;
+                }
+                for (std::size_t i = 1; i != runs.size(); ++i) {
+                    if (runs[i].first - runs[i - 1].second >= width) {
+                        return runs[i - 1].second;
+                    }
+                }
+                return runs.back().second;
+            }());
+        }
+    }
+    Check(live == 0);
+}
+
+}
+
+int main(int, char*[])
+{
+    TestInsert();
+    TestErase();
+    TestContains();
+    TestFirstGap();
+    TestReuse();
+    TestRandom(1);
+    TestRandom(2);
+    return 0;
+}
@@ -1,37 +1,7 @@
 #include <set>
 #include <iostream>
-
-template <typename T>
-struct ComparatorTraits {
-    struct ThreeWay {
-        template <typename A, typename B>
-        requires std::invocable<T, const A&, const B&>
-        auto operator()(const A& a, const B& b) const
-        {
-            T comp;
-            return comp(a, b);
-        }
-        template <typename A, typename B>
-        requires (
-            !std::invocable<T, const A&, const B&> &&
-            std::invocable<T, const B&, const A&>
-        )
-        auto operator()(const A& a, const B& b) const
-        {
-            T comp;
-            return 0 <=> comp(b, a);
-        }
-    };
-    struct Less {
-        template <typename A, typename B>
-        requires std::invocable<ThreeWay, const A&, const B&>
-        bool operator()(const A& a, const B& b) const
-        {
-            ThreeWay comp;
-            return comp(a, b) < 0;
-        }
-    };
-};
+#include "comparator.hpp"
+#include "range_set.hpp"
 
 struct Range {
     unsigned begin;
@@ -55,31 +25,10 @@ struct TWComp {
     }
 };
 
-struct Comp {
-    using is_transparent = std::true_type;
-    auto operator()(const Range& a, const Range& b) const
-    {
-        return a.begin < b.begin;
-    }
-    auto operator()(const Range& a, unsigned b) const
-    {
-        return a.begin < b;
-    }
-    auto operator()(const Range& a, Range::ByEnd b) const
-    {
-        return a.end < unsigned(b);
-    }
-    auto operator()(unsigned a, const Range& b) const
-    {
-        return a < b.begin;
-    }
-    auto operator()(Range::ByEnd a, const Range& b) const
-    {
-        return unsigned(a) < b.end;
-    }
-};
-
-using RangeSet = std::set<Range, Comp>;
+using RangeSet = std::set<
+    Range,
+    container_test::intrusive::ComparatorTraits<TWComp>::Less
+>;
 
 int main(int, char*[])
 {
@@ -93,4 +42,16 @@ int main(int, char*[])
     auto end = ranges.upper_bound(Range::ByBegin(60));
     std::cout << begin->begin << " " << begin->end << "\n";
     std::cout << end->begin << " " << end->end << std::endl;
+
+    // Received byte ranges, merged as they arrive.
+    container_test::RangeSet<unsigned> received;
+    received.Insert(0, 10);
+    received.Insert(20, 30);
+    received.Insert(40, 45);
+    received.Insert(10, 20);
+    received.Erase(4, 6);
+    for (auto& range : received) {
+        std::cout << range.begin << " " << range.end << "\n";
+    }
+    std::cout << received.FirstGap(8) << std::endl;
 }
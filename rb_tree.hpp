@@ -0,0 +1,563 @@
+#ifndef RB_TREE_H
+#define RB_TREE_H
+
+#include <cstddef>
+#include <utility>
+#include "comparator.hpp"
+#include "instrumentation.hpp"
+#include "node.hpp"
+#include "rb_tree_node.hpp"
+
+#define AddressOf (::std::addressof)
+
+namespace container_test::intrusive {
+
+// Red-black counterpart of AVLTree with the same interface and threaded
+// layout. Trees are less strictly balanced, but an insertion takes at most
+// two rotations and an erasure at most three, so it suits workloads
+// dominated by modifications.
+template <
+    typename T,
+    detail::Comparator<T> Comp,
+    typename CastPolicyGen = BaseClassCastPolicy<RBTreeNode<>, T>,
+    typename InstrumentationGen = NullInstrumentation
+>
+class RBTree : detail::ContainerNodeRequirments<T, CastPolicyGen> {
+public:
+    using CastPolicy = CastPolicyGen;
+    using NodeType = typename CastPolicyGen::NodeType;
+    using NodeTraits = RBTreeNodeTraits<NodeType>;
+    using Less = typename ComparatorTraits<Comp>::Less;
+    using ThreeWay = typename ComparatorTraits<Comp>::ThreeWay;
+    using Instrumentation = InstrumentationGen;
+
+    constexpr RBTree()
+    {
+        Clear();
+    }
+
+    template <typename V>
+    class IteratorImpl : public detail::BasicIterator<IteratorImpl<V>, V> {
+        friend class RBTree;
+        template <typename>
+        friend class IteratorImpl;
+        constexpr IteratorImpl(NodeType* current) noexcept :
+            current(current)
+        {}
+
+        constexpr auto next(bool right) noexcept -> IteratorImpl&
+        {
+            current = Neighbour(current, right);
+            return *this;
+        }
+    public:
+        constexpr IteratorImpl() noexcept :
+            current(nullptr)
+        {}
+
+        template <typename U>
+        requires std::same_as<V, const U>
+        constexpr IteratorImpl(const IteratorImpl<U>& oth) noexcept :
+            current(oth.current)
+        {}
+
+        constexpr auto operator++() noexcept -> IteratorImpl&
+        {
+            return next(true);
+        }
+
+        constexpr auto operator--() noexcept -> IteratorImpl&
+        {
+            return next(false);
+        }
+
+        constexpr V* operator->() const noexcept
+        {
+            return CastPolicy::FromNode(current);
+        }
+
+        constexpr bool operator==(const IteratorImpl& oth) const noexcept
+        {
+            return current == oth.current;
+        }
+    private:
+        NodeType* current;
+    };
+
+    using Iterator = IteratorImpl<T>;
+    using ConstIterator = IteratorImpl<const T>;
+
+    constexpr RBTree(RBTree&& oth) :
+        RBTree()
+    {
+        using Tr = NodeTraits;
+        if (oth.Empty()) {
+            return;
+        }
+        auto root = Tr::GetChild(oth.sentinel, 0);
+        auto first = Tr::GetChild(oth.sentinel, 1);
+        auto last = (--oth.End()).current;
+        oth.Clear();
+        Tr::SetChild(sentinel, 0, root);
+        Tr::SetChild(sentinel, 1, first);
+        Tr::SetParent(*root, AddressOf(sentinel));
+        Tr::SetChild(*first, 0, AddressOf(sentinel));
+        Tr::SetChild(*last, 1, AddressOf(sentinel));
+    }
+
+    constexpr Iterator Insert(T& elem)
+    {
+        return InsertUnrestricted(UpperBound(elem), elem);
+    }
+
+    // Inserts before hint if the order allows, elsewhere otherwise.
+    constexpr Iterator Insert(Iterator hint, T& elem)
+    {
+        Less comp;
+        if (hint != End() && !comp(elem, *hint)) {
+            return Insert(elem);
+        }
+        if (auto prev = hint; hint != Begin() && comp(elem, *--prev)) {
+            return Insert(elem);
+        }
+        return InsertUnrestricted(hint, elem);
+    }
+
+    constexpr Iterator Erase(Iterator it)
+    {
+        using Tr = NodeTraits;
+        auto node = it++.current;
+        auto parent = Parent(node);
+        bool side = Side(node);
+        auto left = RealChild(node, 0);
+        auto right = RealChild(node, 1);
+        if (Tr::GetChild(sentinel, 1) == node) {
+            Tr::SetChild(sentinel, 1, it.current);
+        }
+        bool removedRed;
+        NodeType* fixParent;
+        bool fixSide;
+        if (left == nullptr || right == nullptr) {
+            // The successor or the predecessor inside the only subtree
+            // has a thread to node, it is moved to the other neighbour.
+            removedRed = Tr::IsRed(*node);
+            fixParent = parent;
+            fixSide = side;
+            auto child = left ? left : right;
+            if (child != nullptr) {
+                bool r = child == right;
+                auto edge = FindNeighbour(node, r);
+                Tr::SetChild(*edge, !r, Tr::GetChild(*node, !r));
+                Tr::SetParent(*child, parent);
+                Tr::SetChild(*parent, side, child);
+            } else {
+                Tr::SetChild(*parent, side, Tr::GetChild(*node, side));
+            }
+        } else {
+            // The successor takes the place and the colour of node, the
+            // tree loses a node at the former place of the successor.
+            auto successor = it.current;
+            removedRed = Tr::IsRed(*successor);
+            auto successorParent = Parent(successor);
+            if (successorParent == node) {
+                fixParent = successor;
+                fixSide = 1;
+            } else {
+                fixParent = successorParent;
+                fixSide = 0;
+                auto inner = RealChild(successor, 1);
+                if (inner != nullptr) {
+                    Tr::SetParent(*inner, successorParent);
+                    Tr::SetChild(*successorParent, 0, inner);
+                } else {
+                    Tr::SetChild(*successorParent, 0, successor);
+                }
+                Tr::SetChild(*successor, 1, right);
+                Tr::SetParent(*right, successor);
+            }
+            Tr::SetChild(*FindNeighbour(node, false), 1, successor);
+            Tr::SetChild(*successor, 0, left);
+            Tr::SetParent(*left, successor);
+            Tr::SetParent(*successor, parent);
+            Tr::SetChild(*parent, side, successor);
+            Tr::SetRed(*successor, Tr::IsRed(*node));
+        }
+        if (!removedRed) {
+            RebalanceTreeE(fixParent, fixSide);
+        }
+        return it;
+    }
+
+    constexpr Iterator Erase(Iterator b, Iterator e)
+    {
+        while (b != e) {
+            b = Erase(b);
+        }
+        return e;
+    }
+
+    constexpr std::size_t Erase(T& elem)
+    {
+        Erase(IteratorTo(elem));
+        return 1;
+    }
+
+    template <typename KeyType>
+    constexpr std::size_t Erase(const KeyType& elem)
+    {
+        std::size_t count = 0;
+        auto e = UpperBound(elem);
+        for (auto it = LowerBound(elem); it != e; ++count) {
+            it = Erase(it);
+        }
+        return count;
+    }
+
+    constexpr Iterator Begin()
+    {
+        return NodeTraits::GetChild(sentinel, 1);
+    }
+
+    constexpr ConstIterator Begin() const
+    {
+        return Mutable().Begin();
+    }
+
+    friend constexpr Iterator begin(RBTree& tree)
+    {
+        return tree.Begin();
+    }
+
+    friend constexpr ConstIterator begin(const RBTree& tree)
+    {
+        return tree.Begin();
+    }
+
+    constexpr Iterator End()
+    {
+        return AddressOf(sentinel);
+    }
+
+    constexpr ConstIterator End() const
+    {
+        return Mutable().End();
+    }
+
+    friend constexpr Iterator end(RBTree& tree)
+    {
+        return tree.End();
+    }
+
+    friend constexpr ConstIterator end(const RBTree& tree)
+    {
+        return tree.End();
+    }
+
+    constexpr auto IteratorTo(T& elem) -> Iterator
+    {
+        using cp = CastPolicy;
+        return cp::ToNode(AddressOf(elem));
+    }
+
+    constexpr auto Find(const T& key) -> Iterator {
+        return Find<T>(key);
+    }
+
+    constexpr auto Find(const T& key) const -> ConstIterator {
+        return Find<T>(key);
+    }
+
+    template <typename KeyType = T>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    constexpr auto Find(const KeyType& key) const -> ConstIterator
+    {
+        return Mutable().Find(key);
+    }
+
+    template <typename KeyType>
+    constexpr auto UpperBound(const KeyType& key) const -> ConstIterator
+    {
+        return Mutable().UpperBound(key);
+    }
+
+    template <typename KeyType>
+    constexpr auto LowerBound(const KeyType& key) const -> ConstIterator
+    {
+        return Mutable().LowerBound(key);
+    }
+
+    template <typename KeyType = T>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    constexpr auto Find(const KeyType& key) -> Iterator
+    {
+        using cp = CastPolicy;
+        auto node = Child(AddressOf(sentinel), 0);
+        if (node == AddressOf(sentinel)) {
+            return AddressOf(sentinel);
+        }
+        for (std::size_t depth = 1;; ++depth) {
+            ThreeWay comp;
+            auto order = comp(key, *cp::FromNode(node));
+            if (order == 0) {
+                instrumentation.OnSearch(depth);
+                return { node };
+            }
+            auto next = RealChild(node, order > 0);
+            if (next == nullptr) {
+                instrumentation.OnSearch(depth);
+                return AddressOf(sentinel);
+            }
+            node = next;
+        }
+    }
+
+    template <typename KeyType>
+    constexpr auto UpperBound(const KeyType& key) -> Iterator
+    {
+        using cp = CastPolicy;
+        Less comp;
+        return Bound([&](NodeType* node) {
+            return !comp(key, *cp::FromNode(node));
+        });
+    }
+
+    template <typename KeyType>
+    constexpr auto LowerBound(const KeyType& key) -> Iterator
+    {
+        using cp = CastPolicy;
+        Less comp;
+        return Bound([&](NodeType* node) {
+            return comp(*cp::FromNode(node), key);
+        });
+    }
+
+    constexpr bool Empty() const
+    {
+        return Begin() == End();
+    }
+
+    constexpr void Clear()
+    {
+        using Tr = NodeTraits;
+        Tr::SetParent(sentinel, nullptr);
+        Tr::SetRed(sentinel, false);
+        Tr::SetChild(sentinel, 0, AddressOf(sentinel));
+        Tr::SetChild(sentinel, 1, AddressOf(sentinel));
+    }
+
+    // Lookups through Find, LowerBound and UpperBound, including the ones
+    // done by Insert, are reported with their depth, modifications with
+    // their rotations and the number of nodes recoloured on the way up.
+    constexpr auto GetInstrumentation() noexcept -> Instrumentation&
+    {
+        return instrumentation;
+    }
+private:
+    constexpr auto Mutable() const -> RBTree&
+    {
+        return const_cast<RBTree&>(*this);
+    }
+
+    static constexpr auto Parent(NodeType* node) -> NodeType*
+    {
+        return NodeTraits::GetParent(*node);
+    }
+
+    static constexpr auto Child(NodeType* node, bool right) -> NodeType*
+    {
+        return NodeTraits::GetChild(*node, right);
+    }
+
+    // nullptr when the slot holds a thread.
+    static constexpr auto RealChild(NodeType* node, bool right) -> NodeType*
+    {
+        auto child = Child(node, right);
+        return Parent(child) == node ? child : nullptr;
+    }
+
+    static constexpr bool IsRed(NodeType* node)
+    {
+        return node != nullptr && NodeTraits::IsRed(*node);
+    }
+
+    // Slot of node in its parent, the root is child 0 of the sentinel.
+    static constexpr bool Side(NodeType* node)
+    {
+        return Child(Parent(node), 0) != node;
+    }
+
+    // First node for which goRight is false.
+    template <typename F>
+    constexpr auto Bound(F goRight) -> Iterator
+    {
+        NodeType* result = AddressOf(sentinel);
+        auto node = Child(AddressOf(sentinel), 0);
+        if (node == AddressOf(sentinel)) {
+            return result;
+        }
+        for (std::size_t depth = 1;; ++depth) {
+            bool right = goRight(node);
+            if (!right) {
+                result = node;
+            }
+            auto next = RealChild(node, right);
+            if (next == nullptr) {
+                instrumentation.OnSearch(depth);
+                return result;
+            }
+            node = next;
+        }
+    }
+
+    constexpr Iterator InsertUnrestricted(Iterator hint, T& elem)
+    {
+        using Tr = NodeTraits;
+        using cp = CastPolicy;
+        auto parent = hint.current;
+        bool right = RealChild(parent, 0) != nullptr;
+        if (right) {
+            parent = FindNeighbour(parent, false);
+        }
+        auto node = cp::ToNode(AddressOf(elem));
+        Tr::SetRed(*node, true);
+        Tr::SetParent(*node, parent);
+        Tr::SetChild(*node, !right, parent);
+        Tr::SetChild(*node, right, Child(parent, right));
+        if (Child(node, 0) == AddressOf(sentinel)) {
+            Tr::SetChild(sentinel, 1, node);
+        }
+        Tr::SetChild(*parent, right, node);
+        RebalanceTreeI(node);
+        return { node };
+    }
+
+    constexpr void RebalanceTreeI(NodeType* node)
+    {
+        using Tr = NodeTraits;
+        std::size_t length = 0;
+        while (true) {
+            ++length;
+            auto parent = Parent(node);
+            if (parent == AddressOf(sentinel)) {
+                Tr::SetRed(*node, false);
+                break;
+            }
+            if (!Tr::IsRed(*parent)) {
+                break;
+            }
+            auto grand = Parent(parent);
+            bool side = Side(parent);
+            auto uncle = RealChild(grand, !side);
+            if (IsRed(uncle)) {
+                Tr::SetRed(*parent, false);
+                Tr::SetRed(*uncle, false);
+                Tr::SetRed(*grand, true);
+                node = grand;
+                continue;
+            }
+            if (Side(node) != side) {
+                Rotate(parent, side);
+                parent = node;
+            }
+            Tr::SetRed(*parent, false);
+            Tr::SetRed(*grand, true);
+            Rotate(grand, !side);
+            break;
+        }
+        instrumentation.OnRebalance(length);
+    }
+
+    // Restores black heights after the subtree in slot side of parent has
+    // lost a black node.
+    constexpr void RebalanceTreeE(NodeType* parent, bool side)
+    {
+        using Tr = NodeTraits;
+        std::size_t length = 0;
+        while (true) {
+            ++length;
+            auto node = RealChild(parent, side);
+            if (IsRed(node)) {
+                Tr::SetRed(*node, false);
+                break;
+            }
+            if (parent == AddressOf(sentinel)) {
+                break;
+            }
+            auto sibling = Child(parent, !side);
+            if (Tr::IsRed(*sibling)) {
+                Tr::SetRed(*sibling, false);
+                Tr::SetRed(*parent, true);
+                Rotate(parent, side);
+                sibling = Child(parent, !side);
+            }
+            auto nearNephew = RealChild(sibling, side);
+            auto farNephew = RealChild(sibling, !side);
+            if (!IsRed(nearNephew) && !IsRed(farNephew)) {
+                Tr::SetRed(*sibling, true);
+                side = Side(parent);
+                parent = Parent(parent);
+                continue;
+            }
+            if (!IsRed(farNephew)) {
+                Tr::SetRed(*nearNephew, false);
+                Tr::SetRed(*sibling, true);
+                Rotate(sibling, !side);
+                farNephew = sibling;
+                sibling = nearNephew;
+            }
+            Tr::SetRed(*sibling, Tr::IsRed(*parent));
+            Tr::SetRed(*parent, false);
+            Tr::SetRed(*farNephew, false);
+            Rotate(parent, side);
+            break;
+        }
+        instrumentation.OnRebalance(length);
+    }
+
+    // Moves node down into slot right of its child on the other side.
+    constexpr void Rotate(NodeType* node, bool right)
+    {
+        using Tr = NodeTraits;
+        instrumentation.OnRotation(false);
+        auto child = Child(node, !right);
+        auto inner = RealChild(child, right);
+        if (inner != nullptr) {
+            Tr::SetChild(*node, !right, inner);
+            Tr::SetParent(*inner, node);
+        } else {
+            Tr::SetChild(*node, !right, child);
+        }
+        auto parent = Parent(node);
+        Tr::SetChild(*parent, Side(node), child);
+        Tr::SetParent(*child, parent);
+        Tr::SetChild(*child, right, node);
+        Tr::SetParent(*node, child);
+    }
+
+    static constexpr NodeType* Neighbour(NodeType* node, bool right)
+    {
+        auto next = Child(node, right);
+        if (Parent(next) != node) {
+            return next;
+        }
+        return FindNeighbour(node, right);
+    }
+
+    static constexpr NodeType* FindNeighbour(NodeType* node, bool right)
+    {
+        auto neighbour = Child(node, right);
+        while (Child(neighbour, !right) != node) {
+            neighbour = Child(neighbour, !right);
+        }
+        return neighbour;
+    }
+
+    NodeType sentinel;
+    [[no_unique_address]] Instrumentation instrumentation;
+};
+
+}
+
+#undef AddressOf
+
+#endif // RB_TREE_H
@@ -0,0 +1,54 @@
+#ifndef RB_TREE_NODE_H
+#define RB_TREE_NODE_H
+
+namespace container_test::intrusive {
+
+template <typename Tag = void>
+struct RBTreeNode;
+
+template <>
+struct RBTreeNode<void> {
+    RBTreeNode* parent;
+    RBTreeNode* children[2];
+    bool red;
+    constexpr RBTreeNode() {};
+};
+
+template <typename Tag>
+struct RBTreeNode : RBTreeNode<> {};
+
+template <typename T>
+struct RBTreeNodeTraits;
+
+template <typename T>
+struct RBTreeNodeTraits<RBTreeNode<T>> {
+    using NodeType = RBTreeNode<T>;
+    static constexpr auto GetParent(NodeType& node) -> NodeType*
+    {
+        return static_cast<NodeType*>(node.parent);
+    }
+    static constexpr void SetParent(NodeType& node, NodeType* parent)
+    {
+        node.parent = parent;
+    }
+    static constexpr auto GetChild(NodeType& node, bool right) -> NodeType*
+    {
+        return static_cast<NodeType*>(node.children[right]);
+    }
+    static constexpr void SetChild(NodeType& node, bool right, NodeType* child)
+    {
+        node.children[right] = child;
+    }
+    static constexpr bool IsRed(NodeType& node)
+    {
+        return node.red;
+    }
+    static constexpr void SetRed(NodeType& node, bool red)
+    {
+        node.red = red;
+    }
+};
+
+}
+
+#endif // RB_TREE_NODE_H
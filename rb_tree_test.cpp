@@ -0,0 +1,185 @@
+#include <compare>
+#include <cstddef>
+#include <random>
+#include <set>
+#include <vector>
+#include "rb_tree.hpp"
+#include "test.hpp"
+
+using namespace container_test::intrusive;
+using container_test::test::Check;
+
+namespace {
+
+struct Elem : RBTreeNode<> {
+    int key;
+    std::size_t index;
+};
+
+struct Comp {
+    auto operator()(const Elem& a, const Elem& b) const
+    {
+        return a.key <=> b.key;
+    }
+    auto operator()(const Elem& a, int b) const
+    {
+        return a.key <=> b;
+    }
+};
+
+using Tree = RBTree<Elem, Comp>;
+using Tr = Tree::NodeTraits;
+using cp = Tree::CastPolicy;
+using Expected = std::multiset<int>;
+
+// Checks colours of the subtree of node, returns its black height. Nodes
+// are collected in order of the links.
+auto Walk(RBTreeNode<>* node, std::vector<RBTreeNode<>*>& nodes) -> int
+{
+    auto child = [node](bool right) -> RBTreeNode<>* {
+        auto child = Tr::GetChild(*node, right);
+        return Tr::GetParent(*child) == node ? child : nullptr;
+    };
+    auto left = child(0);
+    auto right = child(1);
+    for (auto each : { left, right }) {
+        Check(!each || !Tr::IsRed(*node) || !Tr::IsRed(*each));
+    }
+    auto lheight = left ? Walk(left, nodes) : 0;
+    nodes.push_back(node);
+    auto rheight = right ? Walk(right, nodes) : 0;
+    Check(lheight == rheight);
+    return lheight + !Tr::IsRed(*node);
+}
+
+// The root is the node whose parent is the sentinel, the only node without
+// a parent. Iteration follows the threads, in both directions and around
+// the sentinel it has to visit the nodes in the order of the links.
+void CheckTree(Tree& tree, const Expected& expected)
+{
+    std::vector<RBTreeNode<>*> nodes;
+    if (!tree.Empty()) {
+        auto root = cp::ToNode(&*tree.Begin());
+        while (Tr::GetParent(*Tr::GetParent(*root)) != nullptr) {
+            root = Tr::GetParent(*root);
+        }
+        Check(!Tr::IsRed(*root));
+        Walk(root, nodes);
+    }
+    Check(nodes.size() == expected.size());
+    Check(tree.Empty() == expected.empty());
+    auto key = expected.begin();
+    auto it = tree.Begin();
+    for (auto node : nodes) {
+        Check(cp::ToNode(&*it) == node && it->key == *key);
+        ++it;
+        ++key;
+    }
+    Check(it == tree.End());
+    Check(++it == tree.Begin());
+    it = tree.End();
+    for (auto node = nodes.rbegin(); node != nodes.rend(); ++node) {
+        --it;
+        Check(cp::ToNode(&*it) == *node);
+    }
+    Check(it == tree.Begin());
+    Check(--it == tree.End());
+}
+
+void CheckLookups(Tree& tree, const Expected& expected, int key)
+{
+    auto lower = tree.LowerBound(key);
+    auto expectedLower = expected.lower_bound(key);
+    Check((lower == tree.End()) == (expectedLower == expected.end()));
+    Check(lower == tree.End() || lower->key == *expectedLower);
+    auto upper = tree.UpperBound(key);
+    auto expectedUpper = expected.upper_bound(key);
+    Check((upper == tree.End()) == (expectedUpper == expected.end()));
+    Check(upper == tree.End() || upper->key == *expectedUpper);
+    auto found = tree.Find(key);
+    Check((found != tree.End()) == (expected.count(key) != 0));
+    Check(found == tree.End() || found->key == key);
+}
+
+// Random operations against a multiset of keys, a small key range keeps
+// runs of equal keys.
+void TestRandom(unsigned seed, std::size_t elemCount, int keyCount)
+{
+    std::mt19937 random(seed);
+    std::vector<Elem> elems(elemCount);
+    std::vector<bool> linked(elemCount);
+    for (std::size_t i = 0; i != elemCount; ++i) {
+        elems[i].index = i;
+    }
+    Tree tree;
+    Expected expected;
+    auto unlink = [&](Tree::Iterator b, Tree::Iterator e) {
+        for (; b != e; ++b) {
+            expected.erase(expected.find(b->key));
+            linked[b->index] = false;
+        }
+    };
+    for (int step = 0; step != 40000; ++step) {
+        auto& elem = elems[random() % elemCount];
+        auto key = int(random() % unsigned(keyCount));
+        switch (random() % 7) {
+        case 0: case 1:
+            if (!linked[elem.index]) {
+                elem.key = key;
+                if (step % 2 == 0) {
+                    tree.Insert(elem);
+                } else {
+                    tree.Insert(tree.LowerBound(int(random() % unsigned(keyCount))), elem);
+                }
+                expected.insert(key);
+                linked[elem.index] = true;
+            }
+            break;
+        case 2:
+            if (linked[elem.index]) {
+                auto it = tree.IteratorTo(elem);
+                auto next = it;
+                unlink(it, ++next);
+                Check(tree.Erase(elem) == 1);
+            }
+            break;
+        case 3:
+            if (auto it = tree.LowerBound(key); it != tree.End()) {
+                auto next = it;
+                unlink(it, ++next);
+                Check(tree.Erase(it) == next);
+            }
+            break;
+        case 4: {
+            auto count = expected.count(key);
+            unlink(tree.LowerBound(key), tree.UpperBound(key));
+            Check(tree.Erase(key) == count);
+            break;
+        }
+        case 5: {
+            auto b = tree.LowerBound(key);
+            auto e = tree.LowerBound(key + int(random() % 4));
+            unlink(b, e);
+            Check(tree.Erase(b, e) == e);
+            break;
+        }
+        default:
+            for (int probe = -1; probe <= keyCount; probe += 1 + keyCount / 16) {
+                CheckLookups(tree, expected, probe);
+            }
+        }
+        CheckTree(tree, expected);
+    }
+    tree.Clear();
+    CheckTree(tree, {});
+}
+
+}
+
+int main(int, char*[])
+{
+    TestRandom(1, 300, 100);
+    TestRandom(2, 300, 10);
+    TestRandom(3, 1000, 100000);
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <compare>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <set>
+#include <vector>
+#include "avl_tree.hpp"
+#include "list.hpp"
+#include "slist.hpp"
+#include "test.hpp"
+
+using namespace container_test::intrusive;
+using container_test::test::Check;
+
+namespace {
+
+struct Elem : ListRelativeNode<>, SListRelativeNode<>, AVLTreeRelativeNode<> {
+    int key;
+};
+
+struct Comp {
+    auto operator()(const Elem& a, const Elem& b) const
+    {
+        return a.key <=> b.key;
+    }
+    auto operator()(const Elem& a, int b) const
+    {
+        return a.key <=> b;
+    }
+};
+
+constexpr std::size_t Count = 64;
+
+// Containers and their elements in one block of memory, as they would be
+// in a shared or file backed mapping.
+struct Arena {
+    List<Elem, BaseClassCastPolicy<ListRelativeNode<>, Elem>> list;
+    SList<Elem, BaseClassCastPolicy<SListRelativeNode<>, Elem>> slist;
+    AVLTree<Elem, Comp, BaseClassCastPolicy<AVLTreeRelativeNode<>, Elem>> tree;
+    Elem elems[Count];
+};
+
+struct Expected {
+    std::vector<int> list;
+    std::vector<int> slist;
+    std::multiset<int> tree;
+};
+
+void CheckArena(Arena& arena, const Expected& expected)
+{
+    auto key = expected.list.begin();
+    for (auto& elem : arena.list) {
+        Check(key != expected.list.end() && elem.key == *key);
+        ++key;
+    }
+    Check(key == expected.list.end());
+    auto it = arena.list.End();
+    for (auto rkey = expected.list.rbegin(); rkey != expected.list.rend(); ++rkey) {
+        --it;
+        Check(it->key == *rkey);
+    }
+    Check(it == arena.list.Begin());
+    key = expected.slist.begin();
+    for (auto& elem : arena.slist) {
+        Check(key != expected.slist.end() && elem.key == *key);
+        ++key;
+    }
+    Check(key == expected.slist.end());
+    auto tkey = expected.tree.begin();
+    for (auto& elem : arena.tree) {
+        Check(tkey != expected.tree.end() && elem.key == *tkey);
+        ++tkey;
+    }
+    Check(tkey == expected.tree.end());
+    for (int probe = -1; probe <= int(Count); ++probe) {
+        auto found = arena.tree.Find(probe);
+        Check((found != arena.tree.End()) == (expected.tree.count(probe) != 0));
+        auto lower = arena.tree.LowerBound(probe);
+        auto expectedLower = expected.tree.lower_bound(probe);
+        Check((lower == arena.tree.End()) == (expectedLower == expected.tree.end()));
+        Check(lower == arena.tree.End() || lower->key == *expectedLower);
+    }
+}
+
+// Copies the arena to to and wipes from, so no link can still reach the
+// old copy.
+auto Relocate(unsigned char* from, unsigned char* to) -> Arena&
+{
+    std::memcpy(to, from, sizeof(Arena));
+    std::memset(from, 0xa5, sizeof(Arena));
+    return *std::launder(reinterpret_cast<Arena*>(to));
+}
+
+// Every other element is linked, the copy is traversed and modified by
+// unlinking the linked half and linking the rest, then moved back.
+void TestRelocate()
+{
+    alignas(Arena) unsigned char first[sizeof(Arena)];
+    alignas(Arena) unsigned char second[sizeof(Arena)];
+    auto arena = ::new (static_cast<void*>(first)) Arena;
+    Expected expected;
+    for (std::size_t i = 0; i != Count; ++i) {
+        auto& elem = arena->elems[i];
+        elem.key = int(i * 7 % Count);
+        if (i % 2 == 0) {
+            arena->list.PushBack(elem);
+            expected.list.push_back(elem.key);
+            arena->slist.PushFront(elem);
+            expected.slist.insert(expected.slist.begin(), elem.key);
+            arena->tree.Insert(elem);
+            expected.tree.insert(elem.key);
+        }
+    }
+    CheckArena(*arena, expected);
+
+    auto& copy = Relocate(first, second);
+    CheckArena(copy, expected);
+    Expected changed;
+    for (std::size_t i = 0; i != Count; ++i) {
+        auto& elem = copy.elems[i];
+        if (i % 2 == 0) {
+            copy.list.Erase(elem);
+            copy.tree.Erase(elem);
+        } else {
+            copy.list.PushBack(elem);
+            changed.list.push_back(elem.key);
+            copy.slist.PushFront(elem);
+            changed.slist.insert(changed.slist.begin(), elem.key);
+            copy.tree.Insert(elem);
+            changed.tree.insert(elem.key);
+        }
+    }
+    // The even elements are left at the end of the singly linked list.
+    changed.slist.insert(changed.slist.end(), expected.slist.begin(), expected.slist.end());
+    CheckArena(copy, changed);
+    while (copy.slist.Begin()->key != expected.slist.front()) {
+        copy.slist.PopFront();
+        changed.slist.erase(changed.slist.begin());
+    }
+    CheckArena(copy, changed);
+
+    auto& back = Relocate(second, first);
+    CheckArena(back, changed);
+    back.tree.Erase(back.tree.Begin(), back.tree.End());
+    changed.tree.clear();
+    back.list.Clear();
+    changed.list.clear();
+    CheckArena(back, changed);
+}
+
+}
+
+int main(int, char*[])
+{
+    TestRelocate();
+    return 0;
+}
@@ -0,0 +1,186 @@
+#ifndef SEQLOCK_AVL_TREE_H
+#define SEQLOCK_AVL_TREE_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include "avl_tree.hpp"
+
+#define AddressOf (::std::addressof)
+
+namespace container_test::intrusive {
+
+// AVLTree shared by a single writer and any number of readers. The writer
+// makes the sequence odd for the duration of a modification, readers
+// search without locks and retry if the sequence has changed meanwhile.
+// Nodes are expected to have atomic links, see AVLTreeAtomicNode, and
+// element keys must not change while linked. Erased elements are passed
+// to reclaimer.Retire(elem) and must stay readable until it releases
+// them, readers hold reclaimer.Pin() while searching, see EpochReclaimer.
+template <
+    typename T,
+    detail::Comparator<T> Comp,
+    typename Reclaimer,
+    typename CastPolicyGen = BaseClassCastPolicy<AVLTreeAtomicNode<>, T>
+>
+class SeqlockAVLTree {
+public:
+    using Tree = AVLTree<T, Comp, CastPolicyGen>;
+    using CastPolicy = CastPolicyGen;
+    using NodeType = typename Tree::NodeType;
+    using NodeTraits = typename Tree::NodeTraits;
+    using TraitsHelper = typename Tree::TraitsHelper;
+    using Less = typename Tree::Less;
+    using ThreeWay = typename Tree::ThreeWay;
+
+    explicit SeqlockAVLTree(Reclaimer& reclaimer) :
+        reclaimer(reclaimer)
+    {}
+
+    // Writer side, calls have to be serialized by the caller.
+    void Insert(T& elem)
+    {
+        BeginWrite();
+        tree.Insert(elem);
+        EndWrite();
+    }
+
+    void Erase(T& elem)
+    {
+        BeginWrite();
+        tree.Erase(elem);
+        EndWrite();
+        reclaimer.Retire(elem);
+    }
+
+    // Reader side, f is called with the found element while it is still
+    // protected from reclamation. It may have been erased since.
+    template <typename KeyType, typename F>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    bool Find(const KeyType& key, F&& f)
+    {
+        return Read([&] { return FindOptimistic(key); }, f);
+    }
+
+    template <typename KeyType>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    bool Contains(const KeyType& key)
+    {
+        return Find(key, [](T&) {});
+    }
+
+    // Calls f for the first element not less than key if there is one.
+    template <typename KeyType, typename F>
+    bool LowerBound(const KeyType& key, F&& f)
+    {
+        return Read([&] { return LowerBoundOptimistic(key); }, f);
+    }
+private:
+    // Longer paths than the tallest AVL tree addressable may have mean the
+    // reader has seen a modification in progress.
+    static constexpr int MaxSteps = 128;
+
+    void BeginWrite()
+    {
+        auto current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void EndWrite()
+    {
+        auto current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_release);
+    }
+
+    // search returns the found node, the sentinel if there is none or
+    // nullptr if it has given up.
+    template <typename Search, typename F>
+    bool Read(Search&& search, F& f)
+    {
+        using cp = CastPolicy;
+        auto guard = reclaimer.Pin();
+        while (true) {
+            auto begin = sequence.load(std::memory_order_acquire);
+            if (begin & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+            NodeType* found = search();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (found == nullptr || sequence.load(std::memory_order_relaxed) != begin) {
+                continue;
+            }
+            if (found == Sentinel()) {
+                return false;
+            }
+            f(*cp::FromNode(found));
+            return true;
+        }
+    }
+
+    auto Sentinel() -> NodeType*
+    {
+        return AddressOf(tree.sentinel);
+    }
+
+    // Same walks as in AVLTree, but the sentinel is never compared against
+    // and the number of steps is bounded.
+    template <typename KeyType>
+    auto FindOptimistic(const KeyType& key) -> NodeType*
+    {
+        using H = TraitsHelper;
+        using cp = CastPolicy;
+        NodeType* range[2] = { Sentinel(), Sentinel() };
+        auto subtree = H(NodeTraits::GetChild(tree.sentinel, 0));
+        for (int step = 0; step != MaxSteps; ++step) {
+            if (subtree == Sentinel()) {
+                return Sentinel();
+            }
+            ThreeWay comp;
+            auto order = comp(key, *cp::FromNode(subtree));
+            if (order == 0) {
+                return subtree;
+            }
+            bool b = order > 0;
+            if (subtree.Children(b) == range[b]) {
+                return Sentinel();
+            }
+            range[!b] = subtree;
+            subtree = subtree.Children(b);
+        }
+        return nullptr;
+    }
+
+    template <typename KeyType>
+    auto LowerBoundOptimistic(const KeyType& key) -> NodeType*
+    {
+        using H = TraitsHelper;
+        using cp = CastPolicy;
+        NodeType* range[2] = { Sentinel(), Sentinel() };
+        auto subtree = H(NodeTraits::GetChild(tree.sentinel, 0));
+        for (int step = 0; step != MaxSteps; ++step) {
+            if (subtree == Sentinel()) {
+                return range[1];
+            }
+            Less comp;
+            bool a = comp(*cp::FromNode(subtree), key);
+            if (subtree.Children(a) == range[a]) {
+                return a ? +subtree.Children(1) : +subtree;
+            }
+            range[!a] = subtree;
+            subtree = subtree.Children(a);
+        }
+        return nullptr;
+    }
+
+    Tree tree;
+    Reclaimer& reclaimer;
+    alignas(64) std::atomic<unsigned> sequence = 0;
+};
+
+}
+
+#undef AddressOf
+
+#endif // SEQLOCK_AVL_TREE_H
@@ -0,0 +1,144 @@
+#include <atomic>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+#include "epoch_reclaimer.hpp"
+#include "seqlock_avl_tree.hpp"
+#include "test.hpp"
+
+using namespace container_test::intrusive;
+using container_test::EpochReclaimer;
+using container_test::test::Check;
+
+namespace {
+
+constexpr std::uint32_t Live = 0x11ee11ee;
+constexpr std::uint32_t Dead = 0xdeadbeef;
+
+struct Elem : AVLTreeAtomicNode<> {
+    explicit Elem(std::uint64_t key) :
+        key(key),
+        magic(Live)
+    {}
+
+    std::uint64_t key;
+    std::uint32_t magic;
+};
+
+struct Comp {
+    auto operator()(const Elem& a, const Elem& b) const
+    {
+        return a.key <=> b.key;
+    }
+    auto operator()(const Elem& a, std::uint64_t b) const
+    {
+        return a.key <=> b;
+    }
+};
+
+struct Reclaim {
+    void operator()(Elem& elem) const
+    {
+        elem.magic = Dead;
+        delete &elem;
+        ++*reclaimed;
+    }
+
+    std::atomic<std::size_t>* reclaimed;
+};
+
+using Reclaimer = EpochReclaimer<Elem, Reclaim>;
+using Tree = SeqlockAVLTree<Elem, Comp, Reclaimer>;
+
+// Even keys below KeyCount stay in the tree, the writer inserts and erases
+// the odd ones while readers search. A reader always finds the even keys,
+// never sees an element with another key or one already reclaimed, and
+// the lower bound of a key is never past the next even key.
+constexpr std::uint64_t KeyCount = 4096;
+
+void TestReaders(std::size_t readerCount, int writes)
+{
+    std::atomic<std::size_t> reclaimed = 0;
+    std::size_t erased = 0;
+    std::vector<Elem*> stable;
+    {
+        Reclaimer reclaimer(Reclaim{ &reclaimed });
+        Tree tree(reclaimer);
+        for (std::uint64_t key = 0; key < KeyCount; key += 2) {
+            stable.push_back(new Elem(key));
+            tree.Insert(*stable.back());
+        }
+        std::atomic<bool> done = false;
+        std::atomic<bool> failed = false;
+        std::vector<std::thread> readers;
+        for (std::size_t r = 0; r != readerCount; ++r) {
+            readers.emplace_back([&, r] {
+                std::mt19937_64 random(r + 1);
+                while (!done.load(std::memory_order_relaxed)) {
+                    auto key = random() % KeyCount;
+                    bool found = tree.Find(key, [&](Elem& elem) {
+                        if (elem.key != key || elem.magic != Live) {
+                            failed = true;
+                        }
+                    });
+                    if (key % 2 == 0 && !found) {
+                        failed = true;
+                    }
+                    tree.LowerBound(key, [&](Elem& elem) {
+                        if (elem.key < key || elem.key > key + 1 || elem.magic != Live) {
+                            failed = true;
+                        }
+                    });
+                }
+            });
+        }
+        std::mt19937_64 random(0);
+        std::set<std::uint64_t> odd;
+        std::vector<Elem*> linked(KeyCount, nullptr);
+        for (int write = 0; write != writes; ++write) {
+            auto key = (random() % (KeyCount / 2)) * 2 + 1;
+            if (linked[key] == nullptr) {
+                linked[key] = new Elem(key);
+                tree.Insert(*linked[key]);
+                odd.insert(key);
+            } else {
+                tree.Erase(*linked[key]);
+                linked[key] = nullptr;
+                odd.erase(key);
+                ++erased;
+            }
+        }
+        done = true;
+        for (auto& reader : readers) {
+            reader.join();
+        }
+        Check(!failed);
+        for (std::uint64_t key = 0; key < KeyCount; ++key) {
+            Check(tree.Contains(key) == (key % 2 == 0 || odd.count(key) != 0));
+        }
+        for (auto elem : linked) {
+            if (elem != nullptr) {
+                tree.Erase(*elem);
+                ++erased;
+            }
+        }
+        for (auto elem : stable) {
+            tree.Erase(*elem);
+            ++erased;
+        }
+    }
+    Check(reclaimed == erased);
+}
+
+}
+
+int main(int, char*[])
+{
+    TestReaders(1, 20000);
+    TestReaders(4, 200000);
+    return 0;
+}
@@ -0,0 +1,404 @@
+#ifndef SKIP_LIST_H
+#define SKIP_LIST_H
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include "comparator.hpp"
+#include "node.hpp"
+#include "skip_list_node.hpp"
+
+#define AddressOf (::std::addressof)
+
+namespace container_test::intrusive {
+
+// Lock-free ordered set of unique keys, any number of threads may insert,
+// erase and search at the same time. An element is in the set while its
+// lowest link is linked and unmarked, erasure marks the links of the tower
+// top to bottom and searches unlink marked towers they pass. Erased
+// elements are passed to reclaimer.Retire(guard, elem) once unlinked from
+// every level and must stay readable until it releases them, every
+// operation holds reclaimer.Pin() for its duration, see EpochReclaimer.
+// Iteration is weakly consistent, it sees every element present for its
+// whole duration and may or may not see the others.
+template <
+    typename T,
+    detail::Comparator<T> Comp,
+    typename Reclaimer,
+    typename CastPolicyGen = BaseClassCastPolicy<SkipListNode<>, T>
+>
+class SkipList : detail::ContainerNodeRequirments<T, CastPolicyGen> {
+public:
+    using CastPolicy = CastPolicyGen;
+    using NodeType = typename CastPolicyGen::NodeType;
+    using NodeTraits = SkipListNodeTraits<NodeType>;
+    using Less = typename ComparatorTraits<Comp>::Less;
+    using ThreeWay = typename ComparatorTraits<Comp>::ThreeWay;
+    static constexpr std::size_t MaxHeight = NodeTraits::MaxHeight;
+
+    explicit SkipList(Reclaimer& reclaimer) :
+        reclaimer(reclaimer)
+    {
+        using Tr = NodeTraits;
+        for (std::size_t level = 0; level != MaxHeight; ++level) {
+            Tr::Next(head, level).store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // The caller holds reclaimer.Pin() while using the iterator.
+    class Iterator : public detail::BasicIterator<Iterator, T> {
+        friend class SkipList;
+        Iterator(NodeType* current) noexcept :
+            current(current)
+        {}
+    public:
+        Iterator() noexcept :
+            current(nullptr)
+        {}
+
+        auto operator++() noexcept -> Iterator&
+        {
+            current = NextPresent(current);
+            return *this;
+        }
+
+        T* operator->() const noexcept
+        {
+            return CastPolicy::FromNode(current);
+        }
+
+        bool operator==(const Iterator& oth) const noexcept
+        {
+            return current == oth.current;
+        }
+    private:
+        NodeType* current;
+    };
+
+    // Returns false and leaves elem unlinked if there is an element with an
+    // equivalent key.
+    bool Insert(T& elem)
+    {
+        using cp = CastPolicy;
+        using Tr = NodeTraits;
+        auto guard = reclaimer.Pin();
+        auto node = cp::ToNode(AddressOf(elem));
+        auto height = RandomHeight();
+        Tr::SetHeight(*node, height);
+        Tr::State(*node).store(0, std::memory_order_relaxed);
+        NodeType* preds[MaxHeight];
+        NodeType* succs[MaxHeight];
+        while (true) {
+            if (Search(elem, preds, succs)) {
+                return false;
+            }
+            for (std::size_t level = 0; level != height; ++level) {
+                Tr::Next(*node, level).store(
+                    ptr_cast(succs[level]), std::memory_order_relaxed
+                );
+            }
+            auto expected = ptr_cast(succs[0]);
+            if (Tr::Next(*preds[0], 0).compare_exchange_strong(
+                expected, ptr_cast(node),
+                std::memory_order_acq_rel, std::memory_order_relaxed
+            )) {
+                break;
+            }
+        }
+        // The element is in the set, upper levels only speed up searches.
+        // Linking stops once an eraser has marked the tower.
+        for (std::size_t level = 1; level != height; ++level) {
+            if (!LinkLevel(elem, node, level, preds, succs)) {
+                break;
+            }
+        }
+        Finish(guard, node, Inserted);
+        return true;
+    }
+
+    // Erases elem if it is still in the set. elem has to have been
+    // inserted and not reclaimed yet.
+    bool Erase(T& elem)
+    {
+        using cp = CastPolicy;
+        auto guard = reclaimer.Pin();
+        auto node = cp::ToNode(AddressOf(elem));
+        if (!Mark(node)) {
+            return false;
+        }
+        Finish(guard, node, Erased);
+        return true;
+    }
+
+    template <typename KeyType>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    bool Erase(const KeyType& key)
+    {
+        auto guard = reclaimer.Pin();
+        NodeType* preds[MaxHeight];
+        NodeType* succs[MaxHeight];
+        if (!Search(key, preds, succs) || !Mark(succs[0])) {
+            return false;
+        }
+        Finish(guard, succs[0], Erased);
+        return true;
+    }
+
+    // f is called with the found element while it is still protected from
+    // reclamation. It may have been erased since.
+    template <typename KeyType, typename F>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    bool Find(const KeyType& key, F&& f)
+    {
+        using cp = CastPolicy;
+        auto guard = reclaimer.Pin();
+        auto node = LowerBoundNode(key);
+        Less comp;
+        if (node == nullptr || comp(key, *cp::FromNode(node))) {
+            return false;
+        }
+        f(*cp::FromNode(node));
+        return true;
+    }
+
+    template <typename KeyType>
+    requires std::invocable<ThreeWay, const KeyType&, const T&>
+    bool Contains(const KeyType& key)
+    {
+        return Find(key, [](T&) {});
+    }
+
+    // Calls f for the first element not less than key if there is one.
+    template <typename KeyType, typename F>
+    bool LowerBound(const KeyType& key, F&& f)
+    {
+        using cp = CastPolicy;
+        auto guard = reclaimer.Pin();
+        auto node = LowerBoundNode(key);
+        if (node == nullptr) {
+            return false;
+        }
+        f(*cp::FromNode(node));
+        return true;
+    }
+
+    Iterator Begin()
+    {
+        return NextPresent(AddressOf(head));
+    }
+
+    friend Iterator begin(SkipList& list)
+    {
+        return list.Begin();
+    }
+
+    Iterator End()
+    {
+        return nullptr;
+    }
+
+    friend Iterator end(SkipList& list)
+    {
+        return list.End();
+    }
+
+    bool Empty()
+    {
+        auto guard = reclaimer.Pin();
+        return Begin() == End();
+    }
+private:
+    // Bits of the node state, the later of the inserter and the eraser to
+    // set its bit finishes the unlinking and retires the element.
+    static constexpr std::uint8_t Inserted = 1;
+    static constexpr std::uint8_t Erased = 2;
+
+    static auto Pointer(std::uintptr_t link) noexcept -> NodeType*
+    {
+        return ptr_cast<NodeType*>(link & ~std::uintptr_t(1));
+    }
+
+    static bool IsMarked(std::uintptr_t link) noexcept
+    {
+        return link & 1;
+    }
+
+    // Geometric with p = 1/4, two random bits per level.
+    static auto RandomHeight() noexcept -> std::size_t
+    {
+        thread_local std::uint64_t state =
+            std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        auto zeros = std::size_t(std::countr_zero(state | (1ull << 63)));
+        return std::min(zeros / 2 + 1, MaxHeight);
+    }
+
+    // Next element at the lowest level that is not being erased.
+    static auto NextPresent(NodeType* node) noexcept -> NodeType*
+    {
+        using Tr = NodeTraits;
+        auto next = Pointer(Tr::Next(*node, 0).load(std::memory_order_acquire));
+        while (
+            next != nullptr &&
+            IsMarked(Tr::Next(*next, 0).load(std::memory_order_acquire))
+        ) {
+            next = Pointer(Tr::Next(*next, 0).load(std::memory_order_acquire));
+        }
+        return next;
+    }
+
+    // Fills preds and succs with the last node less than key and the next
+    // one on every level, unlinking marked nodes on the way. Returns true
+    // if the lowest successor is equivalent to key.
+    template <typename KeyType>
+    bool Search(const KeyType& key, NodeType** preds, NodeType** succs)
+    {
+        using cp = CastPolicy;
+        using Tr = NodeTraits;
+        Less comp;
+        while (true) {
+            bool restart = false;
+            auto pred = AddressOf(head);
+            NodeType* curr = nullptr;
+            for (auto level = MaxHeight; level-- != 0 && !restart;) {
+                curr = Pointer(Tr::Next(*pred, level).load(std::memory_order_acquire));
+                while (curr != nullptr) {
+                    auto succ = Tr::Next(*curr, level).load(std::memory_order_acquire);
+                    if (IsMarked(succ)) {
+                        auto expected = ptr_cast(curr);
+                        if (!Tr::Next(*pred, level).compare_exchange_strong(
+                            expected, succ & ~std::uintptr_t(1),
+                            std::memory_order_acq_rel, std::memory_order_relaxed
+                        )) {
+                            restart = true;
+                            break;
+                        }
+                        curr = Pointer(succ);
+                        continue;
+                    }
+                    if (!comp(*cp::FromNode(curr), key)) {
+                        break;
+                    }
+                    pred = curr;
+                    curr = Pointer(succ);
+                }
+                preds[level] = pred;
+                succs[level] = curr;
+            }
+            if (!restart) {
+                return curr != nullptr && !comp(key, *cp::FromNode(curr));
+            }
+        }
+    }
+
+    // Same walk without unlinking, marked nodes are stepped over.
+    template <typename KeyType>
+    auto LowerBoundNode(const KeyType& key) -> NodeType*
+    {
+        using cp = CastPolicy;
+        using Tr = NodeTraits;
+        Less comp;
+        auto pred = AddressOf(head);
+        NodeType* curr = nullptr;
+        for (auto level = MaxHeight; level-- != 0;) {
+            curr = Pointer(Tr::Next(*pred, level).load(std::memory_order_acquire));
+            while (curr != nullptr) {
+                auto succ = Tr::Next(*curr, level).load(std::memory_order_acquire);
+                if (!IsMarked(succ)) {
+                    if (!comp(*cp::FromNode(curr), key)) {
+                        break;
+                    }
+                    pred = curr;
+                }
+                curr = Pointer(succ);
+            }
+        }
+        return curr;
+    }
+
+    // Links node at level after preds, returns false if the tower has been
+    // marked meanwhile.
+    bool LinkLevel(
+        T& elem, NodeType* node, std::size_t level,
+        NodeType** preds, NodeType** succs
+    ) {
+        using Tr = NodeTraits;
+        auto& next = Tr::Next(*node, level);
+        while (true) {
+            auto current = next.load(std::memory_order_acquire);
+            if (IsMarked(current)) {
+                return false;
+            }
+            auto succ = ptr_cast(succs[level]);
+            if (current != succ && !next.compare_exchange_strong(
+                current, succ,
+                std::memory_order_acq_rel, std::memory_order_relaxed
+            )) {
+                continue;
+            }
+            auto expected = succ;
+            if (Tr::Next(*preds[level], level).compare_exchange_strong(
+                expected, ptr_cast(node),
+                std::memory_order_acq_rel, std::memory_order_relaxed
+            )) {
+                return true;
+            }
+            Search(elem, preds, succs);
+        }
+    }
+
+    // Marks the links of node from the top, returns true if this call has
+    // marked the lowest one and so erased the element.
+    static bool Mark(NodeType* node)
+    {
+        using Tr = NodeTraits;
+        for (auto level = Tr::GetHeight(*node); level-- != 0;) {
+            auto& next = Tr::Next(*node, level);
+            auto current = next.load(std::memory_order_relaxed);
+            while (!IsMarked(current)) {
+                if (next.compare_exchange_weak(
+                    current, current | 1,
+                    std::memory_order_acq_rel, std::memory_order_relaxed
+                )) {
+                    if (level == 0) {
+                        return true;
+                    }
+                    break;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Both the inserter and the eraser are done with the tower once their
+    // bits are set, one more search unlinks it from every level.
+    template <typename Guard>
+    void Finish(Guard& guard, NodeType* node, std::uint8_t bit)
+    {
+        using cp = CastPolicy;
+        using Tr = NodeTraits;
+        if (Tr::State(*node).fetch_or(bit, std::memory_order_acq_rel) == 0) {
+            return;
+        }
+        auto& elem = *cp::FromNode(node);
+        NodeType* preds[MaxHeight];
+        NodeType* succs[MaxHeight];
+        Search(elem, preds, succs);
+        reclaimer.Retire(guard, elem);
+    }
+
+    NodeType head;
+    Reclaimer& reclaimer;
+};
+
+}
+
+#undef AddressOf
+
+#endif // SKIP_LIST_H
@@ -0,0 +1,55 @@
+#ifndef SKIP_LIST_NODE_H
+#define SKIP_LIST_NODE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace container_test::intrusive {
+
+// Tower of forward links, one per level of SkipList. Links carry a deletion
+// mark in the lowest bit. Towers have a fixed MaxHeight capacity, the used
+// height is chosen on insertion.
+template <std::size_t MaxHeight = 12, typename Tag = void>
+struct SkipListNode;
+
+template <std::size_t MaxHeight>
+struct SkipListNode<MaxHeight, void> {
+    std::atomic<std::uintptr_t> next[MaxHeight];
+    std::atomic<std::uint8_t> state;
+    std::uint8_t height;
+    SkipListNode() {};
+};
+
+template <std::size_t MaxHeight, typename Tag>
+struct SkipListNode : SkipListNode<MaxHeight> {};
+
+template <typename T>
+struct SkipListNodeTraits;
+
+template <std::size_t Height, typename T>
+struct SkipListNodeTraits<SkipListNode<Height, T>> {
+    using NodeType = SkipListNode<Height, T>;
+    static constexpr std::size_t MaxHeight = Height;
+    static auto Next(NodeType& node, std::size_t level)
+        -> std::atomic<std::uintptr_t>&
+    {
+        return node.next[level];
+    }
+    static auto State(NodeType& node) -> std::atomic<std::uint8_t>&
+    {
+        return node.state;
+    }
+    static auto GetHeight(NodeType& node) -> std::size_t
+    {
+        return node.height;
+    }
+    static void SetHeight(NodeType& node, std::size_t height)
+    {
+        node.height = std::uint8_t(height);
+    }
+};
+
+}
+
+#endif // SKIP_LIST_NODE_H
@@ -0,0 +1,145 @@
+#include <atomic>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include "epoch_reclaimer.hpp"
+#include "skip_list.hpp"
+#include "test.hpp"
+
+using namespace container_test::intrusive;
+using container_test::EpochReclaimer;
+using container_test::test::Check;
+
+namespace {
+
+constexpr std::uint32_t Live = 0x11ee11ee;
+constexpr std::uint32_t Dead = 0xdeadbeef;
+
+struct Elem : SkipListNode<> {
+    explicit Elem(std::uint64_t key) :
+        key(key),
+        magic(Live)
+    {}
+
+    std::uint64_t key;
+    std::uint32_t magic;
+};
+
+struct Comp {
+    auto operator()(const Elem& a, const Elem& b) const
+    {
+        return a.key <=> b.key;
+    }
+    auto operator()(const Elem& a, std::uint64_t b) const
+    {
+        return a.key <=> b;
+    }
+};
+
+struct Reclaim {
+    void operator()(Elem& elem) const
+    {
+        elem.magic = Dead;
+        delete &elem;
+        reclaimed->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<std::size_t>* reclaimed;
+};
+
+using Reclaimer = EpochReclaimer<Elem, Reclaim>;
+using List = SkipList<Elem, Comp, Reclaimer>;
+
+// Threads insert, erase and look up random keys of a small range, so the
+// same keys are fought over. Successful inserts and erasures are counted
+// per key, in the end a key is in the list if it has been inserted once
+// more than erased. Every erased element is reclaimed exactly once.
+void TestConcurrent(std::size_t threadCount, std::size_t keyCount, int operations)
+{
+    std::atomic<std::size_t> reclaimed = 0;
+    std::atomic<std::size_t> erased = 0;
+    auto inserts = std::make_unique<std::atomic<long>[]>(keyCount);
+    auto erasures = std::make_unique<std::atomic<long>[]>(keyCount);
+    {
+        Reclaimer reclaimer(Reclaim{ &reclaimed });
+        List list(reclaimer);
+        std::atomic<bool> failed = false;
+        std::vector<std::thread> threads;
+        for (std::size_t t = 0; t != threadCount; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937_64 random(t + 1);
+                for (int i = 0; i != operations; ++i) {
+                    auto value = random();
+                    auto key = (value >> 8) % keyCount;
+                    switch (value % 4) {
+                    case 0: {
+                        auto elem = new Elem(key);
+                        if (list.Insert(*elem)) {
+                            ++inserts[key];
+                        } else {
+                            delete elem;
+                        }
+                        break;
+                    }
+                    case 1:
+                        if (list.Erase(key)) {
+                            ++erasures[key];
+                            ++erased;
+                        }
+                        break;
+                    default:
+                        list.Find(key, [&](Elem& elem) {
+                            if (elem.key != key || elem.magic != Live) {
+                                failed = true;
+                            }
+                        });
+                        list.LowerBound(key, [&](Elem& elem) {
+                            if (elem.key < key || elem.magic != Live) {
+                                failed = true;
+                            }
+                        });
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        Check(!failed);
+        std::vector<Elem*> remaining;
+        {
+            auto guard = reclaimer.Pin();
+            for (auto& elem : list) {
+                Check(remaining.empty() || remaining.back()->key < elem.key);
+                remaining.push_back(&elem);
+            }
+        }
+        std::size_t present = 0;
+        for (std::uint64_t key = 0; key != keyCount; ++key) {
+            auto balance = inserts[key] - erasures[key];
+            Check(balance == 0 || balance == 1);
+            Check(list.Contains(key) == (balance == 1));
+            present += std::size_t(balance);
+        }
+        Check(remaining.size() == present);
+        for (auto elem : remaining) {
+            delete elem;
+        }
+    }
+    Check(reclaimed == erased);
+}
+
+}
+
+int main(int, char*[])
+{
+    TestConcurrent(1, 1024, 200000);
+    TestConcurrent(4, 64, 100000);
+    TestConcurrent(16, 1024, 20000);
+    TestConcurrent(64, 256, 5000);
+    return 0;
+}
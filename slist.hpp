@@ -1,6 +1,7 @@
 #ifndef SLIST_H
 #define SLIST_H
 
+#include "instrumentation.hpp"
 #include "node.hpp"
 #include "slist_node.hpp"
 
@@ -8,12 +9,17 @@
 
 namespace container_test::intrusive {
 
-template <typename T, typename CastPolicyGen = BaseClassCastPolicy<SListNode<>, T>>
+template <
+    typename T,
+    typename CastPolicyGen = BaseClassCastPolicy<SListNode<>, T>,
+    typename InstrumentationGen = NullInstrumentation
+>
 class SList;
 
-template <typename T, typename CastPolicyGen>
+template <typename T, typename CastPolicyGen, typename InstrumentationGen>
 class SList : detail::ContainerNodeRequirments<T, CastPolicyGen> {
     using CastPolicy = CastPolicyGen;
+    using Instrumentation = InstrumentationGen;
     using NodeType = typename CastPolicy::NodeType;
     using NodeTraits = SListNodeTraits<NodeType>;
 public:
@@ -62,6 +68,7 @@ public:
         NodeType* next = Tr::GetNext(*prev);
         Tr::SetNext(*elem, next);
         Tr::SetNext(*prev, elem);
+        instrumentation.OnInsert();
         return { elem };
     }
 
@@ -72,6 +79,7 @@ public:
         NodeType* elem = Tr::GetNext(*prev);
         NodeType* next = Tr::GetNext(*elem);
         Tr::SetNext(*prev, next);
+        instrumentation.OnErase();
     }
 
     void EraseAfter(T& ref)
@@ -132,6 +140,11 @@ public:
     {
         NodeTraits::SetNext(sentinel, AddressOf(sentinel));
     }
+
+    auto GetInstrumentation() noexcept -> Instrumentation&
+    {
+        return instrumentation;
+    }
 private:
     void DoMove(SList& oth)
     {
@@ -150,6 +163,7 @@ private:
     }
 
     NodeType sentinel;
+    [[no_unique_address]] Instrumentation instrumentation;
 };
 
 }
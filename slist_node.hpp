@@ -1,6 +1,8 @@
 #ifndef SLIST_NODE_H
 #define SLIST_NODE_H
 
+#include "util.hpp"
+
 namespace container_test::intrusive {
 
 template <typename Tag = void>
@@ -14,6 +16,18 @@ struct SListNode<void> {
 template <typename Tag>
 struct SListNode : SListNode<> {};
 
+// Node with a self-relative link, see ListRelativeNode.
+template <typename Tag = void>
+struct SListRelativeNode;
+
+template <>
+struct SListRelativeNode<void> {
+    RelativePtr<SListRelativeNode> next;
+};
+
+template <typename Tag>
+struct SListRelativeNode : SListRelativeNode<> {};
+
 template <typename T>
 struct SListNodeTraits;
 
@@ -21,7 +35,18 @@ template <typename T>
 struct SListNodeTraits<SListNode<T>> {
     using NodeType = SListNode<T>;
     static auto GetNext(NodeType& node) -> NodeType* {
-        return node.next;
+        return static_cast<NodeType*>(node.next);
+    }
+    static void SetNext(NodeType& node, NodeType* next) {
+        node.next = next;
+    }
+};
+
+template <typename T>
+struct SListNodeTraits<SListRelativeNode<T>> {
+    using NodeType = SListRelativeNode<T>;
+    static auto GetNext(NodeType& node) -> NodeType* {
+        return static_cast<NodeType*>(node.next.Get());
     }
     static void SetNext(NodeType& node, NodeType* next) {
         node.next = next;
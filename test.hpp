@@ -0,0 +1,27 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <source_location>
+
+namespace container_test::test {
+
+// Checks that stay on in optimized builds, a failure ends the test.
+inline void Check(
+    bool condition,
+    std::source_location location = std::source_location::current()
+) {
+    if (!condition) {
+        std::fprintf(
+            stderr, "%s:%u: check failed in %s\n",
+            location.file_name(), unsigned(location.line()),
+            location.function_name()
+        );
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+}
+
+#endif // TEST_H
@@ -0,0 +1,164 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace container_test {
+
+// Fork-join pool. A thread waiting for a forked task runs queued tasks
+// meanwhile, so tasks may fork further without starving the pool.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threadCount = std::thread::hardware_concurrency())
+    {
+        for (unsigned i = 1; i < threadCount; ++i) {
+            workers.emplace_back([this] { Work(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Runs f and g, possibly in parallel, returns when both are done.
+    template <typename F, typename G>
+    void Invoke(F&& f, G&& g)
+    {
+        BoundTask<std::remove_reference_t<G>> task(g);
+        Push(&task);
+        std::exception_ptr error;
+        try {
+            f();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        Wait(task);
+        if (error == nullptr) {
+            error = task.error;
+        }
+        if (error != nullptr) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    auto Concurrency() const noexcept -> std::size_t
+    {
+        return workers.size() + 1;
+    }
+private:
+    struct Task {
+        explicit Task(void (*run)(Task*)) :
+            run(run)
+        {}
+
+        void (*run)(Task*);
+        std::atomic<bool> done = false;
+        std::exception_ptr error;
+    };
+
+    template <typename F>
+    struct BoundTask : Task {
+        BoundTask(F& f) :
+            Task(&BoundTask::Run),
+            f(f)
+        {}
+
+        static void Run(Task* task)
+        {
+            auto self = static_cast<BoundTask*>(task);
+            try {
+                self->f();
+            } catch (...) {
+                self->error = std::current_exception();
+            }
+        }
+
+        F& f;
+    };
+
+    void Push(Task* task)
+    {
+        {
+            std::lock_guard lock(mutex);
+            tasks.push_back(task);
+        }
+        wakeUp.notify_one();
+    }
+
+    // The owner takes the latest task, it is the cheapest one to run and
+    // most likely its own.
+    auto TryPopBack() -> Task*
+    {
+        std::lock_guard lock(mutex);
+        if (tasks.empty()) {
+            return nullptr;
+        }
+        auto task = tasks.back();
+        tasks.pop_back();
+        return task;
+    }
+
+    static void Execute(Task* task)
+    {
+        task->run(task);
+        task->done.store(true, std::memory_order_release);
+    }
+
+    void Wait(Task& task)
+    {
+        while (!task.done.load(std::memory_order_acquire)) {
+            if (auto other = TryPopBack()) {
+                Execute(other);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Workers take the oldest tasks, these are the biggest ones.
+    void Work()
+    {
+        while (true) {
+            Task* task;
+            {
+                std::unique_lock lock(mutex);
+                wakeUp.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = tasks.front();
+                tasks.pop_front();
+            }
+            Execute(task);
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::deque<Task*> tasks;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+};
+
+}
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,269 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include "list.hpp"
+#include "node.hpp"
+#include "timing_wheel_node.hpp"
+
+#define AddressOf (::std::addressof)
+
+namespace container_test::intrusive {
+
+// Hierarchical timing wheel of Levels levels with 2^SlotBits slots each,
+// every slot is a List. A timer is kept at the level of the highest base
+// 2^SlotBits digit in which its expiry differs from the current tick, in
+// the slot of that digit, so Arm and Cancel are O(1). Timers expiring
+// after the last level wraps wait in an overflow list. Once the current
+// tick reaches the slot of a higher level, its timers cascade to lower
+// levels. Advance finds the next slot to reach from per level occupancy
+// bitmaps and skips the ticks in between.
+template <
+    typename T,
+    typename CastPolicyGen = BaseClassCastPolicy<TimingWheelNode<>, T>,
+    std::size_t Levels = 4,
+    std::size_t SlotBits = 6
+>
+class TimingWheel : detail::ContainerNodeRequirments<T, CastPolicyGen> {
+    static_assert(Levels > 0 && SlotBits > 0 && SlotBits <= 6);
+    static_assert(Levels * SlotBits < 64);
+public:
+    using CastPolicy = CastPolicyGen;
+    using NodeType = typename CastPolicyGen::NodeType;
+    using NodeTraits = TimingWheelNodeTraits<NodeType>;
+    static constexpr std::size_t SlotCount = std::size_t(1) << SlotBits;
+    static constexpr auto Never = std::numeric_limits<std::uint64_t>::max();
+private:
+    struct SlotCastPolicy {
+        using NodeType = typename NodeTraits::ListNodeType;
+        static auto FromNode(NodeType* node) noexcept -> T*
+        {
+            return CastPolicy::FromNode(
+                static_cast<typename TimingWheel::NodeType*>(node)
+            );
+        }
+        static auto ToNode(T* elem) noexcept -> NodeType*
+        {
+            return CastPolicy::ToNode(elem);
+        }
+    };
+
+    using Slot = List<T, SlotCastPolicy>;
+public:
+    explicit TimingWheel(std::uint64_t now = 0) noexcept :
+        now(now),
+        size(0),
+        expiring(false),
+        occupied{}
+    {}
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    // A timer expiring at or before Now() fires on the next Advance. One
+    // armed from the expiry callback expires no earlier than the next tick.
+    void Arm(T& elem, std::uint64_t expiry) noexcept
+    {
+        auto node = CastPolicy::ToNode(AddressOf(elem));
+        NodeTraits::SetExpiry(*node, std::max(expiry, now + expiring));
+        Place(elem);
+        ++size;
+    }
+
+    // elem has to be armed, it may also be cancelled from the expiry
+    // callback before it fires.
+    void Cancel(T& elem) noexcept
+    {
+        auto node = CastPolicy::ToNode(AddressOf(elem));
+        auto expiry = NodeTraits::GetExpiry(*node);
+        auto level = LevelOf(expiry);
+        auto& slot = SlotOf(level, expiry);
+        slot.Erase(elem);
+        if (level != Levels && slot.Empty()) {
+            occupied[level] &= ~(std::uint64_t(1) << Digit(expiry, level));
+        }
+        --size;
+    }
+
+    void Rearm(T& elem, std::uint64_t expiry) noexcept
+    {
+        Cancel(elem);
+        Arm(elem, expiry);
+    }
+
+    // Moves the current tick forward to target and calls f(elem) for every
+    // timer that expires by then, in order of expiry. The timers of a tick
+    // are unlinked at once and handed out one by one, f may arm and cancel
+    // timers. The ones it arms at or before the current tick expire on the
+    // next tick, in this call if that is not after target.
+    template <typename F>
+    requires std::invocable<F&, T&>
+    void Advance(std::uint64_t target, F&& f)
+    {
+        Expire(f);
+        for (auto next = NextSlot(); next <= target; next = NextSlot()) {
+            now = next;
+            Cascade();
+            Expire(f);
+        }
+        now = std::max(now, target);
+    }
+
+    // No timer expires before the returned tick, Never if there are no
+    // timers. It may be the tick of a cascade rather than an expiry.
+    auto NextEvent() const noexcept -> std::uint64_t
+    {
+        if (occupied[0] & (std::uint64_t(1) << Digit(now, 0))) {
+            return now;
+        }
+        return NextSlot();
+    }
+
+    auto Now() const noexcept -> std::uint64_t
+    {
+        return now;
+    }
+
+    auto Size() const noexcept -> std::size_t
+    {
+        return size;
+    }
+
+    bool Empty() const noexcept
+    {
+        return size == 0;
+    }
+private:
+    static auto Digit(std::uint64_t tick, std::size_t level) noexcept -> std::size_t
+    {
+        return std::size_t(tick >> (level * SlotBits)) & (SlotCount - 1);
+    }
+
+    // Level of the slot of a timer expiring at expiry, Levels for the
+    // overflow list. It does not change until the slot is reached.
+    auto LevelOf(std::uint64_t expiry) const noexcept -> std::size_t
+    {
+        auto diff = expiry ^ now;
+        if (diff == 0) {
+            return 0;
+        }
+        return std::min<std::size_t>((std::bit_width(diff) - 1) / SlotBits, Levels);
+    }
+
+    auto SlotOf(std::size_t level, std::uint64_t expiry) noexcept -> Slot&
+    {
+        return level == Levels ? overflow : slots[level][Digit(expiry, level)];
+    }
+
+    void Place(T& elem) noexcept
+    {
+        auto expiry = NodeTraits::GetExpiry(*CastPolicy::ToNode(AddressOf(elem)));
+        auto level = LevelOf(expiry);
+        SlotOf(level, expiry).PushBack(elem);
+        if (level != Levels) {
+            occupied[level] |= std::uint64_t(1) << Digit(expiry, level);
+        }
+    }
+
+    // The first tick after now at which an occupied slot is reached. Slots
+    // of a level are reached before any slot of the levels above it.
+    auto NextSlot() const noexcept -> std::uint64_t
+    {
+        for (std::size_t level = 0; level != Levels; ++level) {
+            auto digit = Digit(now, level);
+            auto ahead = occupied[level] & ~((std::uint64_t(2) << digit) - 1);
+            if (ahead != 0) {
+                auto shift = level * SlotBits;
+                auto base = now >> (shift + SlotBits) << (shift + SlotBits);
+                return base | (std::uint64_t(std::countr_zero(ahead)) << shift);
+            }
+        }
+        constexpr auto shift = Levels * SlotBits;
+        if (overflow.Empty() || (now >> shift) == (Never >> shift)) {
+            return Never;
+        }
+        return ((now >> shift) + 1) << shift;
+    }
+
+    // Moves the timers of the slots reached at now to lower levels. A
+    // timer never lands in a reached slot of another level.
+    void Cascade() noexcept
+    {
+        constexpr auto shift = Levels * SlotBits;
+        if ((now & ((std::uint64_t(1) << shift) - 1)) == 0 && !overflow.Empty()) {
+            Slot batch(std::move(overflow));
+            overflow.Clear();
+            PlaceAll(batch);
+        }
+        for (auto level = Levels; --level != 0;) {
+            if ((now & ((std::uint64_t(1) << (level * SlotBits)) - 1)) != 0) {
+                continue;
+            }
+            Slot batch;
+            if (Take(level, batch)) {
+                PlaceAll(batch);
+            }
+        }
+    }
+
+    template <typename F>
+    void Expire(F& f)
+    {
+        Slot batch;
+        if (!Take(0, batch)) {
+            return;
+        }
+        while (!batch.Empty()) {
+            auto& elem = *batch.Begin();
+            batch.Erase(batch.Begin());
+            --size;
+            expiring = true;
+            f(elem);
+            expiring = false;
+        }
+    }
+
+    // Moves the timers of the slot at the digit of now to batch.
+    bool Take(std::size_t level, Slot& batch) noexcept
+    {
+        auto digit = Digit(now, level);
+        auto bit = std::uint64_t(1) << digit;
+        if ((occupied[level] & bit) == 0) {
+            return false;
+        }
+        occupied[level] &= ~bit;
+        auto& slot = slots[level][digit];
+        batch = std::move(slot);
+        slot.Clear();
+        return true;
+    }
+
+    void PlaceAll(Slot& batch) noexcept
+    {
+        while (!batch.Empty()) {
+            auto& elem = *batch.Begin();
+            batch.Erase(batch.Begin());
+            Place(elem);
+        }
+    }
+
+    std::uint64_t now;
+    std::size_t size;
+    bool expiring;
+    std::uint64_t occupied[Levels];
+    Slot slots[Levels][SlotCount];
+    Slot overflow;
+};
+
+}
+
+#undef AddressOf
+
+#endif // TIMING_WHEEL_H
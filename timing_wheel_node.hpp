@@ -0,0 +1,36 @@
+#ifndef TIMING_WHEEL_NODE_H
+#define TIMING_WHEEL_NODE_H
+
+#include <cstdint>
+#include "list_node.hpp"
+
+namespace container_test::intrusive {
+
+// List node of a TimingWheel slot and the tick the timer expires at. The
+// list node is tagged with the timer node, so an element can be in a
+// TimingWheel and in other lists at once.
+template <typename Tag = void>
+struct TimingWheelNode : ListNode<TimingWheelNode<Tag>> {
+    std::uint64_t expiry;
+};
+
+template <typename T>
+struct TimingWheelNodeTraits;
+
+template <typename T>
+struct TimingWheelNodeTraits<TimingWheelNode<T>> {
+    using NodeType = TimingWheelNode<T>;
+    using ListNodeType = ListNode<NodeType>;
+    static auto GetExpiry(NodeType& node) -> std::uint64_t
+    {
+        return node.expiry;
+    }
+    static void SetExpiry(NodeType& node, std::uint64_t expiry)
+    {
+        node.expiry = expiry;
+    }
+};
+
+}
+
+#endif // TIMING_WHEEL_NODE_H
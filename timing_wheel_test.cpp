@@ -0,0 +1,137 @@
+#include <cstdint>
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "test.hpp"
+#include "timing_wheel.hpp"
+
+using container_test::intrusive::BaseClassCastPolicy;
+using container_test::intrusive::TimingWheel;
+using container_test::intrusive::TimingWheelNode;
+using container_test::test::Check;
+
+namespace {
+
+struct Timer : TimingWheelNode<> {
+    std::size_t index;
+    std::uint64_t due;
+};
+
+// A timer armed from the callback at the current tick fires on the next one.
+void TestArmFromCallback()
+{
+    TimingWheel<Timer> wheel;
+    Timer a, b;
+    wheel.Arm(a, 10);
+    std::vector<Timer*> fired;
+    std::uint64_t firedAt = 0;
+    wheel.Advance(1000, [&](Timer& timer) {
+        fired.push_back(&timer);
+        if (&timer == &a) {
+            wheel.Arm(b, wheel.Now());
+        } else {
+            firedAt = wheel.Now();
+        }
+    });
+    Check(fired.size() == 2 && fired[1] == &b && firedAt == 11);
+    Check(wheel.Empty() && wheel.NextEvent() == wheel.Never);
+
+    // At the target the timer waits for the next call.
+    wheel.Arm(a, 1500);
+    fired.clear();
+    wheel.Advance(1500, [&](Timer& timer) {
+        fired.push_back(&timer);
+        if (&timer == &a) {
+            wheel.Arm(b, 0);
+        }
+    });
+    Check(fired.size() == 1 && wheel.Size() == 1 && wheel.NextEvent() == 1501);
+    wheel.Advance(1501, [&](Timer& timer) { fired.push_back(&timer); });
+    Check(fired.size() == 2 && fired[1] == &b && wheel.Empty());
+}
+
+// Random arms, cancels and advances against a multiset of due ticks.
+template <std::size_t Levels, std::size_t SlotBits>
+void TestRandom(std::uint64_t start, std::uint64_t span, unsigned seed)
+{
+    using Wheel = TimingWheel<
+        Timer, BaseClassCastPolicy<TimingWheelNode<>, Timer>, Levels, SlotBits
+    >;
+    std::mt19937_64 random(seed);
+    Wheel wheel(start);
+    std::vector<Timer> timers(2000);
+    std::vector<bool> armed(timers.size());
+    std::multiset<std::pair<std::uint64_t, std::size_t>> expected;
+    for (std::size_t i = 0; i != timers.size(); ++i) {
+        timers[i].index = i;
+    }
+    auto arm = [&](Timer& timer, std::uint64_t due) {
+        wheel.Arm(timer, due);
+        timer.due = timer.expiry;
+        expected.insert({ timer.due, timer.index });
+        armed[timer.index] = true;
+    };
+    auto cancel = [&](Timer& timer) {
+        wheel.Cancel(timer);
+        expected.erase({ timer.due, timer.index });
+        armed[timer.index] = false;
+    };
+    for (int step = 0; step != 50000; ++step) {
+        auto& timer = timers[random() % timers.size()];
+        auto now = wheel.Now();
+        switch (random() % 8) {
+        case 0: case 1: case 2:
+            if (!armed[timer.index]) {
+                arm(timer, now + random() % span - (random() % 16 == 0 ? 3 : 0));
+            }
+            break;
+        case 3:
+            if (armed[timer.index]) {
+                cancel(timer);
+            }
+            break;
+        case 4:
+            if (armed[timer.index]) {
+                cancel(timer);
+                arm(timer, now + random() % span);
+            }
+            break;
+        default: {
+            auto target = now + random() % (random() % 4 == 0 ? 2 * span : 64);
+            Check(expected.empty()
+                ? wheel.NextEvent() == wheel.Never
+                : wheel.NextEvent() <= expected.begin()->first);
+            std::uint64_t last = 0;
+            wheel.Advance(target, [&](Timer& fired) {
+                Check(fired.due <= target && fired.due >= last);
+                Check(fired.due == expected.begin()->first);
+                Check(std::max(fired.due, now) == wheel.Now());
+                last = fired.due;
+                expected.erase({ fired.due, fired.index });
+                armed[fired.index] = false;
+                if (random() % 8 == 0) {
+                    arm(fired, wheel.Now() + random() % 100);
+                }
+            });
+            Check(wheel.Now() == std::max(now, target));
+            Check(expected.empty() || expected.begin()->first > wheel.Now());
+        }
+        }
+        Check(wheel.Size() == expected.size());
+    }
+}
+
+}
+
+int main(int, char*[])
+{
+    TestArmFromCallback();
+    TestRandom<4, 6>(0, 1000, 1);
+    TestRandom<4, 6>(12345, 100000000, 2);
+    TestRandom<2, 3>(7, 500, 3);
+    TestRandom<3, 2>(~std::uint64_t(0) - 100000000, 5000, 4);
+    TestRandom<1, 6>(0, 300, 5);
+    return 0;
+}
@@ -6,6 +6,10 @@
 #include <type_traits>
 #include <concepts>
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
 namespace container_test {
 
 template <class T>
@@ -72,6 +76,77 @@ auto ApplyOffset(S* src, std::ptrdiff_t diff) -> D*
     return As<D*>(As<unsigned char*>(src) + diff);
 }
 
+// Hints the cache line at ptr to be loaded, ptr may be any address.
+inline void Prefetch(std::uintptr_t ptr) noexcept
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(ptr_cast<const void*>(ptr));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(ptr_cast<const char*>(ptr), _MM_HINT_T0);
+#else
+    (void)ptr;
+#endif
+}
+
+// Self-relative pointer, keeps the distance from its own address to the
+// target, so memory holding both stays valid wherever it is mapped. Copies
+// are encoded against their own address. Targets are aligned, so nullptr
+// is encoded as the distance 1.
+template <typename T>
+class RelativePtr {
+public:
+    RelativePtr() = default;
+
+    RelativePtr(T* ptr) noexcept
+    {
+        Set(ptr);
+    }
+
+    RelativePtr(const RelativePtr& oth) noexcept
+    {
+        Set(oth.Get());
+    }
+
+    RelativePtr& operator=(const RelativePtr& oth) noexcept
+    {
+        Set(oth.Get());
+        return *this;
+    }
+
+    RelativePtr& operator=(T* ptr) noexcept
+    {
+        Set(ptr);
+        return *this;
+    }
+
+    auto Get() const noexcept -> T*
+    {
+        if (offset == Null) {
+            return nullptr;
+        }
+        return ptr_cast<T*>(ptr_cast(this) + offset);
+    }
+
+    operator T*() const noexcept
+    {
+        return Get();
+    }
+
+    T* operator->() const noexcept
+    {
+        return Get();
+    }
+private:
+    static constexpr std::uintptr_t Null = 1;
+
+    void Set(T* ptr) noexcept
+    {
+        offset = ptr == nullptr ? Null : ptr_cast(ptr) - ptr_cast(this);
+    }
+
+    std::uintptr_t offset;
+};
+
 } // namespace container_test
 
 #endif // UTIL_H